@@ -18,10 +18,13 @@
 #include <string.h>
 
 /* utility */
+#include "fcthreadpool.h"
 #include "log.h"
+#include "mem.h"
 
 /* common */
 #include "combat.h"
+#include "effects.h"
 #include "game.h"
 #include "government.h"
 #include "map.h"
@@ -62,7 +65,30 @@
 
 #include "advmilitary.h"
 
-static unsigned int assess_danger(struct ai_type *ait, struct city *pcity);
+/* A call of dai_wants_defender_against() put off by assess_danger(). */
+struct danger_defender_want {
+  struct unit_type *attacker;
+  int want;
+};
+
+/* The danger assessment of one city in a worker thread. */
+struct danger_job {
+  struct city *pcity;
+  struct danger_defender_want *wants;
+  int num_wants;
+  int max_wants;
+};
+
+/* Data given to the worker threads, see dai_assess_danger_cities(). */
+struct danger_jobs {
+  struct ai_type *ait;
+  int *min_move_costs;
+  struct danger_job *jobs;
+};
+
+static unsigned int assess_danger(struct ai_type *ait, struct city *pcity,
+                                  int *min_move_costs,
+                                  struct danger_job *job);
 
 /**************************************************************************
   Choose the best unit the city can build to defend against attacker v.
@@ -328,11 +354,59 @@ static int assess_defense_igwall(struct ai_type *ait, struct city *pcity)
   return assess_defense_backend(ait, pcity, TRUE);
 }
 
+/****************************************************************************
+  Reset the cache of danger_min_move_cost().
+****************************************************************************/
+static void danger_min_move_costs_init(int *min_move_costs)
+{
+  int i;
+
+  for (i = 0; i < UCL_LAST; i++) {
+    min_move_costs[i] = -1;
+  }
+}
+
+/****************************************************************************
+  Lower bound of the move cost of any step of the units of this class,
+  computed once for all the cities assessed with the same cache.
+****************************************************************************/
+static int danger_min_move_cost(int *min_move_costs,
+                                const struct unit_class *pclass)
+{
+  int *pmin_MC = &min_move_costs[uclass_index(pclass)];
+
+  if (0 > *pmin_MC) {
+    *pmin_MC = pft_uclass_min_move_cost(pclass);
+  }
+
+  return *pmin_MC;
+}
+
+/****************************************************************************
+  Returns whether the unit may reach the city in the turns of the reverse
+  map, without iterating the map when it is clearly too far.
+****************************************************************************/
+static bool assess_danger_unit_position(struct pf_reverse_map *pcity_map,
+                                        int *min_move_costs,
+                                        const struct unit *punit,
+                                        struct pf_position *pos)
+{
+  int min_MC = danger_min_move_cost(min_move_costs, unit_class(punit));
+
+  if (!pf_reverse_map_utype_may_reach(pcity_map, unit_type(punit),
+                                      unit_tile(punit), min_MC)) {
+    return FALSE;
+  }
+
+  return pf_reverse_map_unit_position(pcity_map, punit, pos);
+}
+
 /****************************************************************************
   How dangerous and far a unit is for a city?
 ****************************************************************************/
 static unsigned int assess_danger_unit(const struct city *pcity,
                                        struct pf_reverse_map *pcity_map,
+                                       int *min_move_costs,
                                        const struct unit *punit,
                                        int *move_time)
 {
@@ -351,7 +425,7 @@ static unsigned int assess_danger_unit(const struct city *pcity,
                   / punittype->paratroopers_range);
   }
 
-  if (pf_reverse_map_unit_position(pcity_map, punit, &pos)
+  if (assess_danger_unit_position(pcity_map, min_move_costs, punit, &pos)
       && (PF_IMPOSSIBLE_MC == *move_time
           || *move_time > pos.turn)) {
     *move_time = pos.turn;
@@ -359,7 +433,8 @@ static unsigned int assess_danger_unit(const struct city *pcity,
 
   if (unit_transported(punit)
       && (ferry = unit_transport_get(punit))
-      && pf_reverse_map_unit_position(pcity_map, ferry, &pos)) {
+      && assess_danger_unit_position(pcity_map, min_move_costs, ferry,
+                                     &pos)) {
     if ((PF_IMPOSSIBLE_MC == *move_time
          || *move_time > pos.turn)) {
       *move_time = pos.turn;
@@ -386,6 +461,87 @@ static unsigned int assess_danger_unit(const struct city *pcity,
   return danger * 100 / MAX(mod, 1);
 }
 
+/****************************************************************************
+  Raise the tech wants for defenders against the attacker, as
+  dai_wants_defender_against() does. With a job, this is only recorded
+  for dai_assess_danger_cities() to do it later.
+****************************************************************************/
+static void danger_wants_defender_against(struct player *pplayer,
+                                          struct city *pcity,
+                                          struct unit_type *attacker,
+                                          int want, struct danger_job *job)
+{
+  if (NULL == job) {
+    (void) dai_wants_defender_against(pplayer, pcity, attacker, want);
+    return;
+  }
+
+  if (job->num_wants == job->max_wants) {
+    job->max_wants = MAX(2 * job->max_wants, 8);
+    job->wants = fc_realloc(job->wants,
+                            job->max_wants * sizeof(*job->wants));
+  }
+  job->wants[job->num_wants].attacker = attacker;
+  job->wants[job->num_wants].want = want;
+  job->num_wants++;
+}
+
+/****************************************************************************
+  Assess the danger of one city. Run by the worker threads: this must only
+  write the data of the city.
+****************************************************************************/
+static void assess_danger_job(int index, void *data)
+{
+  struct danger_jobs *jobs = data;
+  struct danger_job *job = &jobs->jobs[index];
+
+  (void) assess_danger(jobs->ait, job->pcity, jobs->min_move_costs, job);
+}
+
+/****************************************************************************
+  Assess the danger of all the cities of the player in the worker threads
+  of 'pool'. The tech wants the assessment raises are shared by all the
+  cities, so they are added afterwards, in the order of the cities.
+****************************************************************************/
+static void dai_assess_danger_cities(struct fc_threadpool *pool,
+                                     struct ai_type *ait,
+                                     struct player *pplayer,
+                                     int *min_move_costs)
+{
+  struct danger_jobs jobs;
+  int count = city_list_size(pplayer->cities);
+  int i = 0, j;
+
+  jobs.ait = ait;
+  jobs.min_move_costs = min_move_costs;
+  jobs.jobs = fc_calloc(count, sizeof(*jobs.jobs));
+  city_list_iterate(pplayer->cities, pcity) {
+    jobs.jobs[i++].pcity = pcity;
+  } city_list_iterate_end;
+
+  /* The worker threads only read the cache. Fill it for every class, as
+   * units of any player, even carried ones, may be assessed. */
+  unit_class_iterate(pclass) {
+    (void) danger_min_move_cost(min_move_costs, pclass);
+  } unit_class_iterate_end;
+
+  effect_cache_set_read_only(TRUE);
+  fc_threadpool_run(pool, count, assess_danger_job, &jobs);
+  effect_cache_set_read_only(FALSE);
+
+  for (i = 0; i < count; i++) {
+    struct danger_job *job = &jobs.jobs[i];
+
+    for (j = 0; j < job->num_wants; j++) {
+      (void) dai_wants_defender_against(pplayer, job->pcity,
+                                        job->wants[j].attacker,
+                                        job->wants[j].want);
+    }
+    free(job->wants);
+  }
+  free(jobs.jobs);
+}
+
 /****************************************************************************
   Call assess_danger() for all cities owned by pplayer.
 
@@ -395,9 +551,19 @@ void dai_assess_danger_player(struct ai_type *ait, struct player *pplayer)
 {
   /* Do nothing if game is not running */
   if (S_S_RUNNING == server_state()) {
-    city_list_iterate(pplayer->cities, pcity) {
-      (void) assess_danger(ait, pcity);
-    } city_list_iterate_end;
+    struct fc_threadpool *pool = server_threadpool();
+    int min_move_costs[UCL_LAST];
+
+    TIMING_LOG(AIT_DANGER, TIMER_START);
+    danger_min_move_costs_init(min_move_costs);
+    if (NULL != pool && 1 < city_list_size(pplayer->cities)) {
+      dai_assess_danger_cities(pool, ait, pplayer, min_move_costs);
+    } else {
+      city_list_iterate(pplayer->cities, pcity) {
+        (void) assess_danger(ait, pcity, min_move_costs, NULL);
+      } city_list_iterate_end;
+    }
+    TIMING_LOG(AIT_DANGER, TIMER_STOP);
   }
 }
 
@@ -454,8 +620,13 @@ static void dai_reevaluate_building(struct city *pcity, int *value,
   FIXME: Due to the nature of assess_distance, a city will only be
   afraid of a boat laden with enemies if it stands on the coast (i.e.
   is directly reachable by this boat).
+
+  With a 'job', this only writes the data of the city, see
+  dai_assess_danger_cities().
 ****************************************************************************/
-static unsigned int assess_danger(struct ai_type *ait, struct city *pcity)
+static unsigned int assess_danger(struct ai_type *ait, struct city *pcity,
+                                  int *min_move_costs,
+                                  struct danger_job *job)
 {
   struct player *pplayer = city_owner(pcity);
   struct tile *ptile = city_tile(pcity);
@@ -471,8 +642,6 @@ static unsigned int assess_danger(struct ai_type *ait, struct city *pcity)
   int defense_bonuses[U_LAST];
   bool defender_type_handled[U_LAST];
 
-  TIMING_LOG(AIT_DANGER, TIMER_START);
-
   /* Initialize data. */
   memset(&danger_reduced, 0, sizeof(danger_reduced));
   if (has_handicap(pplayer, H_DANGER)) {
@@ -554,7 +723,7 @@ static unsigned int assess_danger(struct ai_type *ait, struct city *pcity)
       unsigned int vulnerability;
       int defbonus = defense_bonuses[utype_index(unit_type(punit))];
 
-      vulnerability = assess_danger_unit(pcity, pcity_map,
+      vulnerability = assess_danger_unit(pcity, pcity_map, min_move_costs,
                                          punit, &move_time);
 
       if (PF_IMPOSSIBLE_MC == move_time) {
@@ -589,8 +758,8 @@ static unsigned int assess_danger(struct ai_type *ait, struct city *pcity)
         defbonus = (defbonus + 1) / 2;
       }
       vulnerability /= (defbonus + 1);
-      (void) dai_wants_defender_against(pplayer, pcity, unit_type(punit),
-                                        vulnerability / MAX(move_time, 1));
+      danger_wants_defender_against(pplayer, pcity, unit_type(punit),
+                                    vulnerability / MAX(move_time, 1), job);
 
       if (unit_has_type_flag(punit, UTYF_DIPLOMAT) && 2 >= move_time) {
         city_data->diplomat_threat = TRUE;
@@ -664,8 +833,6 @@ static unsigned int assess_danger(struct ai_type *ait, struct city *pcity)
   }
   city_data->urgency = urgency;
 
-  TIMING_LOG(AIT_DANGER, TIMER_STOP);
-
   return urgency;
 }
 
@@ -1403,10 +1570,14 @@ void military_advisor_choose_build(struct ai_type *ait,
   struct tile *ptile = pcity->tile;
   struct unit *virtualunit;
   struct ai_city *city_data = def_ai_city_data(pcity, ait);
+  int min_move_costs[UCL_LAST];
 
   init_choice(choice);
 
-  urgency = assess_danger(ait, pcity);
+  TIMING_LOG(AIT_DANGER, TIMER_START);
+  danger_min_move_costs_init(min_move_costs);
+  urgency = assess_danger(ait, pcity, min_move_costs, NULL);
+  TIMING_LOG(AIT_DANGER, TIMER_STOP);
   /* Changing to quadratic to stop AI from building piles 
    * of small units -- Syela */
   /* It has to be AFTER assess_danger thanks to wallvalue. */
@@ -288,6 +288,7 @@ static struct cityresult *cityresult_fill(struct ai_type *ait,
   fc_assert_ret_val(ptile != NULL, NULL)
 
   pplayer->government = adv->goal.govt.gov;
+  city_refresh_generation_bump();
 
   /* Create a city result and set default values. */
   result = cityresult_new(ptile);
@@ -441,6 +442,7 @@ static struct cityresult *cityresult_fill(struct ai_type *ait,
   result->total = MAX(0, result->total);
 
   pplayer->government = curr_govt;
+  city_refresh_generation_bump();
   if (virtual_city) {
     destroy_city_virtual(pcity);
     tile_set_owner(result->tile, saved_owner, saved_claimer);
@@ -423,7 +423,7 @@ bool dai_unit_goto_constrained(struct ai_type *ait, struct unit *punit,
     return TRUE;
   }
 
-  pfm = pf_map_new(parameter);
+  pfm = pf_map_new_to_tile(parameter, ptile, pft_min_move_cost(parameter));
   path = pf_map_path(pfm, ptile);
 
   if (path) {
@@ -23,6 +23,7 @@
 
 /* common */
 #include "citizens.h"
+#include "effects.h"
 #include "game.h"
 #include "player.h"
 #include "spaceship.h"
@@ -132,6 +133,11 @@ struct player *achievement_plr(struct achievement *ach,
     }
   } players_iterate_end;
 
+  if (player_list_size(achievers) > 0) {
+    /* Achievement requirements of the effects may now be fulfilled. */
+    effect_cache_invalidate();
+  }
+
   if (ach->first != NULL) {
     /* Already have first one credited. */
     return NULL;
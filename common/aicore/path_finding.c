@@ -15,8 +15,11 @@
 #include <fc_config.h>
 #endif
 
+#include <string.h>
+
 /* utility */
 #include "bitvector.h"
+#include "fcthread.h"
 #include "log.h"
 #include "mem.h"
 #include "pqueue.h"
@@ -85,6 +88,7 @@ struct pf_map {
   /* Private data. */
   struct tile *tile;          /* The current position (aka iterator). */
   struct pf_parameter params; /* Initial parameters. */
+  struct pf_node_array *nodes; /* Storage of the lattice of nodes. */
 };
 
 /* Down-cast macro. */
@@ -94,6 +98,162 @@ struct pf_map {
 #define PF_DIR_NONE (-1)
 
 
+/* ============================ Node arrays ============================== */
+
+/* The lattice of nodes of a map is as large as the whole map, but most
+ * searches only reach a small part of it. So instead of allocating and
+ * clearing a new one for every map, the arrays are kept in a pool. Every
+ * map records which nodes it has initialized, and only these are cleared
+ * again when the map is destroyed. An array from the pool is all zeros
+ * then, as the maps expect from a new one. */
+struct pf_node_array {
+  struct pf_node_array *next;   /* Next one in the pool. */
+  void *lattice;
+  size_t node_size;
+  int size;                     /* MAP_INDEX_SIZE when allocated. */
+  int *touched;                 /* Indices of the initialized nodes. */
+  int num_touched;
+  struct pqueue *queue;         /* Indexed by tile, see
+                                 * pf_node_array_queue(). */
+};
+
+static struct {
+  bool active;                  /* Between pf_map_pool_init() and
+                                 * pf_map_pool_free(). */
+  fc_mutex mutex;               /* Maps may be made by other threads. */
+  struct pf_node_array *free_arrays;
+
+  /* Statistics, see pf_map_stats(). */
+  int maps;
+  unsigned long nodes;
+  unsigned long bytes;
+} pf_pool;
+
+/****************************************************************************
+  Free a node array.
+****************************************************************************/
+static void pf_node_array_free(struct pf_node_array *parray)
+{
+  if (NULL != parray->queue) {
+    pq_destroy(parray->queue);
+  }
+  free(parray->lattice);
+  free(parray->touched);
+  free(parray);
+}
+
+/****************************************************************************
+  Give a cleared array of MAP_INDEX_SIZE nodes of 'node_size' bytes to the
+  map, taken from the pool if possible. Returns the lattice.
+****************************************************************************/
+static void *pf_node_array_new(struct pf_map *pfm, size_t node_size)
+{
+  struct pf_node_array *parray = NULL;
+
+  if (pf_pool.active) {
+    struct pf_node_array **pparray = &pf_pool.free_arrays;
+
+    fc_allocate_mutex(&pf_pool.mutex);
+    while (NULL != *pparray) {
+      struct pf_node_array *pfree = *pparray;
+
+      if (pfree->size != MAP_INDEX_SIZE) {
+        /* The map has changed since. */
+        *pparray = pfree->next;
+        pf_node_array_free(pfree);
+      } else if (pfree->node_size == node_size) {
+        *pparray = pfree->next;
+        parray = pfree;
+        break;
+      } else {
+        pparray = &pfree->next;
+      }
+    }
+    pf_pool.maps++;
+    if (NULL == parray) {
+      pf_pool.bytes += MAP_INDEX_SIZE * (node_size + sizeof(int));
+    }
+    fc_release_mutex(&pf_pool.mutex);
+  }
+
+  if (NULL == parray) {
+    parray = fc_malloc(sizeof(*parray));
+    parray->lattice = fc_calloc(MAP_INDEX_SIZE, node_size);
+    parray->node_size = node_size;
+    parray->size = MAP_INDEX_SIZE;
+    parray->touched = fc_malloc(MAP_INDEX_SIZE * sizeof(*parray->touched));
+    parray->queue = NULL;
+  }
+  parray->next = NULL;
+  parray->num_touched = 0;
+
+  pfm->nodes = parray;
+  return parray->lattice;
+}
+
+/****************************************************************************
+  Return an empty priority queue indexed by tile, which is kept with the
+  node array.
+****************************************************************************/
+static struct pqueue *pf_node_array_queue(struct pf_map *pfm)
+{
+  struct pf_node_array *parray = pfm->nodes;
+
+  if (NULL == parray->queue) {
+    parray->queue = pq_create_indexed(INITIAL_QUEUE_SIZE, parray->size);
+    if (pf_pool.active) {
+      fc_allocate_mutex(&pf_pool.mutex);
+      pf_pool.bytes += parray->size * sizeof(int);
+      fc_release_mutex(&pf_pool.mutex);
+    }
+  }
+  return parray->queue;
+}
+
+/****************************************************************************
+  Record that the node at 'index' is going to be modified, when it is
+  still all zeros.
+****************************************************************************/
+static inline void pf_node_array_touch(struct pf_map *pfm, int index)
+{
+  struct pf_node_array *parray = pfm->nodes;
+
+  fc_assert_ret(parray->num_touched < parray->size);
+  parray->touched[parray->num_touched++] = index;
+}
+
+/****************************************************************************
+  Clear the nodes the map has used and put its array back to the pool.
+****************************************************************************/
+static void pf_node_array_destroy(struct pf_map *pfm)
+{
+  struct pf_node_array *parray = pfm->nodes;
+  char *lattice = parray->lattice;
+  int i;
+
+  if (!pf_pool.active) {
+    pf_node_array_free(parray);
+    return;
+  }
+
+  for (i = 0; i < parray->num_touched; i++) {
+    memset(lattice + parray->touched[i] * parray->node_size, 0,
+           parray->node_size);
+  }
+  if (NULL != parray->queue) {
+    pq_clear(parray->queue);
+  }
+
+  fc_allocate_mutex(&pf_pool.mutex);
+  pf_pool.nodes += parray->num_touched;
+  parray->next = pf_pool.free_arrays;
+  pf_pool.free_arrays = parray;
+  fc_release_mutex(&pf_pool.mutex);
+
+  pfm->nodes = NULL;
+}
+
+
 /* ========================== Common functions =========================== */
 
 /****************************************************************************
@@ -239,8 +399,14 @@ struct pf_normal_map {
 
   struct pqueue *queue;     /* Queue of nodes we have reached but not
                              * processed yet (NS_NEW), sorted by their
-                             * total_CC. */
+                             * total_CC. Indexed, each node is in it once
+                             * at most. */
   struct pf_normal_node *lattice; /* Lattice of nodes. */
+
+  struct tile *dest_tile;   /* If set, the queue is sorted by the total_CC
+                             * plus an estimate of the cost to reach this
+                             * tile (A*). See pf_map_new_to_tile(). */
+  int min_MC;               /* Lower bound of the MC of any step. */
 };
 
 /* Up-cast macro. */
@@ -277,6 +443,8 @@ static void pf_normal_node_init(struct pf_normal_map *pfnm,
   /* Else, not a critical problem, but waste of time. */
 #endif
 
+  pf_node_array_touch(PF_MAP(pfnm), node - pfnm->lattice);
+
   /* Establish the "known" status of node. */
   if (params->omniscience) {
     node->node_known_type = TILE_KNOWN_SEEN;
@@ -443,6 +611,49 @@ static int pf_normal_map_adjust_cost(const struct pf_normal_map *pfnm,
   return cost;
 }
 
+/****************************************************************************
+  Lower bound of the MC still needed to go from 'ptile', reached with
+  'cost', to the destination tile of the map. Every step costs at least
+  'min_MC', or all the moves left if there are fewer of them, so this is
+  the cost of doing the remaining steps at that price. The estimate never
+  decreases along a step by more than the step costs, so the first time
+  the destination is processed its cost is the best one.
+****************************************************************************/
+static int pf_normal_map_estimate(const struct pf_normal_map *pfnm,
+                                  const struct tile *ptile, int cost)
+{
+  const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfnm));
+  int min_MC = pfnm->min_MC;
+  int move_rate = pf_move_rate(params);
+  int steps = real_map_distance(ptile, pfnm->dest_tile);
+  int moves_left, steps_now, steps_per_turn, turns;
+
+  if (0 == steps) {
+    return 0;
+  }
+
+  if (NULL != params->get_EC) {
+    /* With extra costs a path with more MC may be better, so the estimate
+     * must not depend on the moves left when reaching 'ptile'. We only
+     * know that any step costs one move fragment at least. */
+    return steps;
+  }
+
+  moves_left = pf_moves_left(params, cost);
+  steps_now = (moves_left + min_MC - 1) / min_MC;
+  if (steps <= steps_now) {
+    return MIN(steps * min_MC, moves_left);
+  }
+
+  /* Spend the moves left of this turn, then full turns. */
+  steps -= steps_now;
+  steps_per_turn = (move_rate + min_MC - 1) / min_MC;
+  turns = (steps - 1) / steps_per_turn;
+
+  return (moves_left + turns * move_rate
+          + MIN((steps - turns * steps_per_turn) * min_MC, move_rate));
+}
+
 /****************************************************************************
   Bare-bones PF iterator. All Freeciv rules logic is hidden in 'get_costs'
   callback (compare to pf_normal_map_iterate function). This function is
@@ -507,22 +718,22 @@ static bool pf_jumbo_map_iterate(struct pf_map *pfm)
     if (priority >= 0) {
       /* We found a better route to 'tile1', record it (the costs are
        * recorded already). Node status step A. to B. */
+      if (NS_UNINIT == node1->status) {
+        pf_node_array_touch(pfm, index1);
+      }
       node1->cost = cost1;
       node1->extra_cost = extra_cost1;
       node1->status = NS_NEW;
       node1->dir_to_here = dir;
-      pq_insert(pfnm->queue, index1, -priority);
+      pq_update(pfnm->queue, index1, -priority);
     }
   } adjc_dir_iterate_end;
 
   /* Get the next node (the index with the highest priority). */
-  do {
-    if (!pq_remove(pfnm->queue, &index)) {
-      /* No more indexes in the priority queue, iteration end. */
-      return FALSE;
-    }
-    /* If the node has already been processed, get the next one. */
-  } while (NS_NEW != pfnm->lattice[index].status);
+  if (!pq_remove(pfnm->queue, &index)) {
+    /* No more indexes in the priority queue, iteration end. */
+    return FALSE;
+  }
 
   /* Change the pf_map iterator. Node status step B. to C. */
   pfm->tile = index_to_tile(index);
@@ -642,19 +853,22 @@ static bool pf_normal_map_iterate(struct pf_map *pfm)
         node1->cost = cost;
         node1->dir_to_here = dir;
         /* As we prefer lower costs, let's reverse the cost of the path. */
-        pq_insert(pfnm->queue, index1, -cost_of_path);
+        if (NULL != pfnm->dest_tile) {
+          pq_update(pfnm->queue, index1,
+                    -(cost_of_path + PF_TURN_FACTOR
+                      * pf_normal_map_estimate(pfnm, tile1, cost)));
+        } else {
+          pq_update(pfnm->queue, index1, -cost_of_path);
+        }
       }
     } adjc_dir_iterate_end;
   }
 
   /* Get the next node (the index with the highest priority). */
-  do {
-    if (!pq_remove(pfnm->queue, &index)) {
-      /* No more indexes in the priority queue, iteration end. */
-      return FALSE;
-    }
-    /* Discard if this node has already been processed. */
-  } while (NS_NEW != pfnm->lattice[index].status);
+  if (!pq_remove(pfnm->queue, &index)) {
+    /* No more indexes in the priority queue, iteration end. */
+    return FALSE;
+  }
 
   /* Change the pf_map iterator. Node status step C. to D. */
   pfm->tile = index_to_tile(index);
@@ -763,8 +977,7 @@ static void pf_normal_map_destroy(struct pf_map *pfm)
 {
   struct pf_normal_map *pfnm = PF_NORMAL_MAP(pfm);
 
-  free(pfnm->lattice);
-  pq_destroy(pfnm->queue);
+  pf_node_array_destroy(pfm);
   free(pfnm);
 }
 
@@ -787,8 +1000,10 @@ static struct pf_map *pf_normal_map_new(const struct pf_parameter *parameter)
 #endif /* PF_DEBUG */
 
   /* Allocate the map. */
-  pfnm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_normal_node));
-  pfnm->queue = pq_create(INITIAL_QUEUE_SIZE);
+  pfnm->lattice = pf_node_array_new(base_map, sizeof(struct pf_normal_node));
+  pfnm->queue = pf_node_array_queue(base_map);
+  pfnm->dest_tile = NULL;
+  pfnm->min_MC = 0;
 
   /* 'get_MC' or 'get_costs' callback must be set. */
   fc_assert_ret_val(NULL != parameter->get_MC
@@ -907,6 +1122,8 @@ static void pf_danger_node_init(struct pf_danger_map *pfdm,
   /* Else, not a critical problem, but waste of time. */
 #endif
 
+  pf_node_array_touch(PF_MAP(pfdm), node - pfdm->lattice);
+
   /* Establish the "known" status of node. */
   if (params->omniscience) {
     node->node_known_type = TILE_KNOWN_SEEN;
@@ -1600,12 +1817,13 @@ static void pf_danger_map_destroy(struct pf_map *pfm)
   int i;
 
   /* Need to clean up the dangling danger segments. */
-  for (i = 0, node = pfdm->lattice; i < MAP_INDEX_SIZE; i++, node++) {
+  for (i = 0; i < pfm->nodes->num_touched; i++) {
+    node = pfdm->lattice + pfm->nodes->touched[i];
     if (node->danger_segment) {
       free(node->danger_segment);
     }
   }
-  free(pfdm->lattice);
+  pf_node_array_destroy(pfm);
   pq_destroy(pfdm->queue);
   pq_destroy(pfdm->danger_queue);
   free(pfdm);
@@ -1630,7 +1848,7 @@ static struct pf_map *pf_danger_map_new(const struct pf_parameter *parameter)
 #endif /* PF_DEBUG */
 
   /* Allocate the map. */
-  pfdm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_danger_node));
+  pfdm->lattice = pf_node_array_new(base_map, sizeof(struct pf_danger_node));
   pfdm->queue = pq_create(INITIAL_QUEUE_SIZE);
   pfdm->danger_queue = pq_create(INITIAL_QUEUE_SIZE);
 
@@ -1761,6 +1979,8 @@ static void pf_fuel_node_init(struct pf_fuel_map *pffm,
   /* Else, not a critical problem, but waste of time. */
 #endif
 
+  pf_node_array_touch(PF_MAP(pffm), node - pffm->lattice);
+
   /* Establish the "known" status of node. */
   if (params->omniscience) {
     node->node_known_type = TILE_KNOWN_SEEN;
@@ -2629,12 +2849,13 @@ static void pf_fuel_map_destroy(struct pf_map *pfm)
   int i;
 
   /* Need to clean up the dangling fuel segments. */
-  for (i = 0, node = pffm->lattice; i < MAP_INDEX_SIZE; i++, node++) {
+  for (i = 0; i < pfm->nodes->num_touched; i++) {
+    node = pffm->lattice + pfm->nodes->touched[i];
     if (node->fuel_segment) {
       free(node->fuel_segment);
     }
   }
-  free(pffm->lattice);
+  pf_node_array_destroy(pfm);
   pq_destroy(pffm->queue);
   pq_destroy(pffm->out_of_fuel_queue);
   free(pffm);
@@ -2659,7 +2880,7 @@ static struct pf_map *pf_fuel_map_new(const struct pf_parameter *parameter)
 #endif /* PF_DEBUG */
 
   /* Allocate the map. */
-  pffm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_fuel_node));
+  pffm->lattice = pf_node_array_new(base_map, sizeof(struct pf_fuel_node));
   pffm->queue = pq_create(INITIAL_QUEUE_SIZE);
   pffm->out_of_fuel_queue = pq_create(INITIAL_QUEUE_SIZE);
 
@@ -2702,6 +2923,61 @@ static struct pf_map *pf_fuel_map_new(const struct pf_parameter *parameter)
 
 /* ====================== pf_map public functions ======================= */
 
+/****************************************************************************
+  Start keeping the node arrays of destroyed maps for reuse.
+****************************************************************************/
+void pf_map_pool_init(void)
+{
+  if (pf_pool.active) {
+    return;
+  }
+
+  fc_init_mutex(&pf_pool.mutex);
+  pf_pool.free_arrays = NULL;
+  pf_pool.active = TRUE;
+  pf_map_stats_reset();
+}
+
+/****************************************************************************
+  Free the kept node arrays. Maps destroyed after this just free theirs.
+****************************************************************************/
+void pf_map_pool_free(void)
+{
+  if (!pf_pool.active) {
+    return;
+  }
+
+  pf_pool.active = FALSE;
+  while (NULL != pf_pool.free_arrays) {
+    struct pf_node_array *parray = pf_pool.free_arrays;
+
+    pf_pool.free_arrays = parray->next;
+    pf_node_array_free(parray);
+  }
+  fc_destroy_mutex(&pf_pool.mutex);
+}
+
+/****************************************************************************
+  Get the number of maps created, of nodes they have used and of bytes
+  allocated for node arrays since the last pf_map_stats_reset().
+****************************************************************************/
+void pf_map_stats(int *maps, unsigned long *nodes, unsigned long *bytes)
+{
+  *maps = pf_pool.maps;
+  *nodes = pf_pool.nodes;
+  *bytes = pf_pool.bytes;
+}
+
+/****************************************************************************
+  Reset the counters of pf_map_stats().
+****************************************************************************/
+void pf_map_stats_reset(void)
+{
+  pf_pool.maps = 0;
+  pf_pool.nodes = 0;
+  pf_pool.bytes = 0;
+}
+
 /****************************************************************************
   Factory function to create a new map according to the parameter.
   Does not do any iterations.
@@ -2727,6 +3003,42 @@ struct pf_map *pf_map_new(const struct pf_parameter *parameter)
   return pf_normal_map_new(parameter);
 }
 
+/****************************************************************************
+  Like pf_map_new(), but for finding the way to 'dest_tile' only. 'min_MC'
+  must be a lower bound of the MC of any step with this parameter, see
+  pft_min_move_cost(). The map searches towards 'dest_tile', so it gives
+  the same costs as a map made with pf_map_new() but usually has to look
+  at far fewer tiles.
+
+  Only normal maps can do that; danger, fuel and jumbo maps just search
+  in every direction.
+****************************************************************************/
+struct pf_map *pf_map_new_to_tile(const struct pf_parameter *parameter,
+                                  struct tile *dest_tile, int min_MC)
+{
+  struct pf_map *pfm = pf_map_new(parameter);
+
+  if (NULL == parameter->is_pos_dangerous
+      && NULL == parameter->get_moves_left_req
+      && NULL == parameter->get_costs) {
+    struct pf_normal_map *pfnm = PF_NORMAL_MAP(pfm);
+
+    /* Moves into unknown tiles or to tiles we cannot leave don't use
+     * the MC callback. */
+    min_MC = MIN(min_MC, SINGLE_MOVE);
+    if (PF_IMPOSSIBLE_MC != parameter->unknown_MC) {
+      min_MC = MIN(min_MC, parameter->unknown_MC);
+    }
+
+    if (0 < min_MC) {
+      pfnm->dest_tile = dest_tile;
+      pfnm->min_MC = min_MC;
+    }
+  }
+
+  return pfm;
+}
+
 /****************************************************************************
   After usage the map must be destroyed.
 ****************************************************************************/
@@ -2935,7 +3247,7 @@ void pf_path_print_real(const struct pf_path *path, enum log_level level,
 
 /* The path-finding reverse maps are used check the move costs that the
  * units needs to reach the start tile. It stores a pf_map for every unit
- * type. */
+ * type. Unit types which move the same way share their pf_map. */
 
 /* The reverse map structure. */
 struct pf_reverse_map {
@@ -2943,6 +3255,23 @@ struct pf_reverse_map {
   struct pf_map **maps;         /* A vector of pf_map for every unit_type. */
 };
 
+/****************************************************************************
+  Returns TRUE if the map would have been built the same way for the unit
+  type, see pf_reverse_map_utype_map().
+****************************************************************************/
+static inline bool
+pf_reverse_map_fits_utype(const struct pf_map *pfm,
+                          const struct unit_type *punittype)
+{
+  const struct pf_parameter *param = &pfm->params;
+
+  return (param->uclass == utype_class(punittype)
+          && param->move_rate == punittype->move_rate
+          && param->fuel == MAX(utype_fuel(punittype), 1)
+          && BV_ISSET(param->unit_flags, UTYF_IGTER)
+             == utype_has_flag(punittype, UTYF_IGTER));
+}
+
 /****************************************************************************
   This function estime the cost for unit moves to reach the start tile.
 
@@ -3042,7 +3371,16 @@ void pf_reverse_map_destroy(struct pf_reverse_map *pfrm)
 
   for (i = 0, ppfm = pfrm->maps; i < utype_count(); i++, ppfm++) {
     if (NULL != *ppfm) {
-      pf_map_destroy(*ppfm);
+      struct pf_map *pfm = *ppfm;
+      size_t j;
+
+      /* Forget the other references to a shared map. */
+      for (j = i; j < utype_count(); j++) {
+        if (pfm == pfrm->maps[j]) {
+          pfrm->maps[j] = NULL;
+        }
+      }
+      pf_map_destroy(pfm);
     }
   }
   free(pfrm->maps);
@@ -3062,6 +3400,17 @@ pf_reverse_map_utype_map(struct pf_reverse_map *pfrm,
   if (NULL == pfm) {
     struct pf_parameter *param = &pfrm->param;
     int max_turns = FC_PTR_TO_INT(param->data);
+    size_t i;
+
+    /* The costs only depend on the unit class, the move rate, the fuel
+     * and UTYF_IGTER; reuse the map of a similar unit type if any. */
+    for (i = 0; i < utype_count(); i++) {
+      if (NULL != pfrm->maps[i]
+          && pf_reverse_map_fits_utype(pfrm->maps[i], punittype)) {
+        pfrm->maps[index] = pfrm->maps[i];
+        return pfrm->maps[i];
+      }
+    }
 
     /* Not created yet. */
     param->uclass = utype_class(punittype);
@@ -3159,3 +3508,24 @@ bool pf_reverse_map_unit_position(struct pf_reverse_map *pfrm,
 
   return pfm->get_position(pfm, unit_tile(punit), pos);
 }
+
+/****************************************************************************
+  Returns FALSE if the unit type certainly cannot reach the start tile from
+  'ptile' in the maximal number of turns, without iterating the map.
+  'min_MC' must be a lower bound of the MC of any step of the unit type,
+  see pft_uclass_min_move_cost().
+****************************************************************************/
+bool pf_reverse_map_utype_may_reach(const struct pf_reverse_map *pfrm,
+                                    const struct unit_type *punittype,
+                                    const struct tile *ptile, int min_MC)
+{
+  int max_turns = FC_PTR_TO_INT(pfrm->param.data);
+
+  if (0 >= min_MC || 0 > max_turns || FC_INFINITY <= max_turns) {
+    return TRUE;
+  }
+
+  /* Every step costs at least 'min_MC' and moves by one tile at most. */
+  return (real_map_distance(pfrm->param.start_tile, ptile) * min_MC
+          <= max_turns * punittype->move_rate);
+}
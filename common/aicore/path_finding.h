@@ -189,6 +189,12 @@
  *
  * You may call pf_map_path() multiple times with the same pfm.
  *
+ * If there is only one destination, pf_map_new_to_tile() builds a map
+ * which searches towards it (A*), using a lower bound of the cost of a
+ * single step to estimate the rest of the way. Such a map gives the same
+ * costs for every tile it reaches, but pf_map_iterate() doesn't visit the
+ * tiles in order of increasing costs anymore.
+ *
  * B) the caller doesn't know the map position of the goal yet (but knows
  * what he is looking for, e.g. a port) and wants to iterate over
  * all paths in order of increasing costs (total_CC):
@@ -415,6 +421,9 @@ struct pf_reverse_map;
 /* Create and free. */
 struct pf_map *pf_map_new(const struct pf_parameter *parameter)
                fc__warn_unused_result;
+struct pf_map *pf_map_new_to_tile(const struct pf_parameter *parameter,
+                                  struct tile *dest_tile, int min_MC)
+               fc__warn_unused_result;
 void pf_map_destroy(struct pf_map *pfm);
 
 /* Method A) functions. */
@@ -436,6 +445,11 @@ void pf_map_iter_position(struct pf_map *pfm, struct pf_position *pos);
 /* Other related functions. */
 const struct pf_parameter *pf_map_parameter(const struct pf_map *pfm);
 
+void pf_map_pool_init(void);
+void pf_map_pool_free(void);
+void pf_map_stats(int *maps, unsigned long *nodes, unsigned long *bytes);
+void pf_map_stats_reset(void);
+
 
 /* Paths functions. */
 void pf_path_destroy(struct pf_path *path);
@@ -479,6 +493,9 @@ bool pf_reverse_map_utype_position(struct pf_reverse_map *pfrm,
 bool pf_reverse_map_unit_position(struct pf_reverse_map *pfrm,
                                   const struct unit *punit,
                                   struct pf_position *pos);
+bool pf_reverse_map_utype_may_reach(const struct pf_reverse_map *pfrm,
+                                    const struct unit_type *punittype,
+                                    const struct tile *ptile, int min_MC);
 
 
 
@@ -25,7 +25,10 @@
 /* common */
 #include "base.h"
 #include "game.h"
+#include "map.h"
 #include "movement.h"
+#include "road.h"
+#include "terrain.h"
 #include "tile.h"
 #include "unit.h"
 #include "unittype.h"
@@ -990,6 +993,140 @@ void pft_fill_amphibious_parameter(struct pft_amphibious *parameter)
   parameter->combined.data = parameter;
 }
 
+/* The bounds found by pft_uclass_min_move_cost(), valid while
+ * tile_move_cost_generation() is still 'generation'. */
+static struct {
+  unsigned int generation;
+  int min_MC;
+} uclass_min_MC[UCL_LAST];
+
+/**********************************************************************
+  Return whether a step of a unit of this class on native tiles may cost
+  no move fragments at all, according to the ruleset.
+***********************************************************************/
+static bool uclass_may_move_free(const struct unit_class *pclass)
+{
+  if (!uclass_has_flag(pclass, UCF_TERRAIN_SPEED)) {
+    /* See tile_move_cost_ptrs(). */
+    return FALSE;
+  }
+
+  terrain_type_iterate(pterrain) {
+    if (0 >= pterrain->movement_cost) {
+      return TRUE;
+    }
+  } terrain_type_iterate_end;
+
+  road_type_iterate(proad) {
+    if (proad->move_mode != RMM_NO_BONUS
+        && 0 >= proad->move_cost
+        && is_native_extra_to_uclass(road_extra_get(proad), pclass)) {
+      return TRUE;
+    }
+  } road_type_iterate_end;
+
+  return FALSE;
+}
+
+/**********************************************************************
+  Compute the bound of pft_uclass_min_move_cost().
+***********************************************************************/
+static int uclass_min_move_cost_compute(const struct unit_class *pclass)
+{
+  int min_MC = SINGLE_MOVE;
+
+  if (!uclass_has_flag(pclass, UCF_TERRAIN_SPEED)) {
+    /* The moves cost SINGLE_MOVE, see tile_move_cost_ptrs(), but for the
+     * terrain costs of land_attack_move(), which don't depend on the
+     * map. */
+    terrain_type_iterate(pterrain) {
+      min_MC = MIN(min_MC, pterrain->movement_cost * SINGLE_MOVE);
+    } terrain_type_iterate_end;
+
+    return MAX(min_MC, 0);
+  }
+
+  /* See tile_move_cost_ptrs(). */
+  whole_map_iterate(ptile) {
+    const struct terrain *pterrain = tile_terrain(ptile);
+
+    if (NULL != pterrain) {
+      min_MC = MIN(min_MC, pterrain->movement_cost * SINGLE_MOVE);
+    }
+
+    road_type_iterate(proad) {
+      if (proad->move_mode != RMM_NO_BONUS
+          && proad->move_cost < min_MC
+          && tile_has_road(ptile, proad)
+          && is_native_extra_to_uclass(road_extra_get(proad), pclass)) {
+        min_MC = proad->move_cost;
+      }
+    } road_type_iterate_end;
+
+    if (0 >= min_MC) {
+      return 0;
+    }
+  } whole_map_iterate_end;
+
+  return min_MC;
+}
+
+/**********************************************************************
+  Return a lower bound of the MC of any step of a unit of this class,
+  from the terrains and roads found on the map. Returns 0 when some
+  steps may be free.
+
+  The bound is kept until the terrains or roads of the map change, see
+  tile_move_cost_generation(). Not to be called from several threads
+  at once.
+***********************************************************************/
+int pft_uclass_min_move_cost(const struct unit_class *pclass)
+{
+  unsigned int generation = tile_move_cost_generation();
+  Unit_Class_id idx = uclass_index(pclass);
+
+  if (uclass_min_MC[idx].generation != generation) {
+    uclass_min_MC[idx].min_MC = uclass_min_move_cost_compute(pclass);
+    uclass_min_MC[idx].generation = generation;
+  }
+
+  return uclass_min_MC[idx].min_MC;
+}
+
+/**********************************************************************
+  Return a lower bound of the MC of any step with this parameter, to be
+  given to pf_map_new_to_tile(). Returns 0 when it is not known, e.g.
+  for callbacks set outside of this file.
+
+  Only the terrains and roads found on the map are taken into account,
+  so the bound holds until the map changes.
+***********************************************************************/
+int pft_min_move_cost(const struct pf_parameter *param)
+{
+  if (param->get_MC == igter_move_unit) {
+    /* All the steps cost MOVE_COST_IGTER, but those which would be free
+     * anyway. Look at the map only if the ruleset has such steps. */
+    if (!uclass_may_move_free(param->uclass)
+        || 0 < pft_uclass_min_move_cost(param->uclass)) {
+      return MOVE_COST_IGTER;
+    }
+    return 0;
+  }
+
+  if (param->get_MC != seamove
+      && param->get_MC != airmove
+      && param->get_MC != seamove_no_bombard
+      && param->get_MC != sea_overlap_move
+      && param->get_MC != sea_attack_move
+      && param->get_MC != normal_move_unit
+      && param->get_MC != land_attack_move
+      && param->get_MC != land_overlap_move) {
+    return 0;
+  }
+
+  return pft_uclass_min_move_cost(param->uclass);
+}
+
 /**********************************************************************
   Concatenate two paths together.  The additional segment (src_path)
   should start where the initial segment (dest_path) stops.  The
@@ -64,6 +64,8 @@ void pft_fill_utype_attack_param(struct pf_parameter *parameter,
                                  struct player *pplayer);
 
 void pft_fill_amphibious_parameter(struct pft_amphibious *parameter);
+int pft_min_move_cost(const struct pf_parameter *param);
+int pft_uclass_min_move_cost(const struct unit_class *pclass);
 enum tile_behavior no_fights_or_unknown(const struct tile *ptile,
                                         enum known_type known,
                                         const struct pf_parameter *param);
@@ -21,6 +21,7 @@
 
 /* common */
 #include "city.h"
+#include "effects.h"
 #include "game.h"
 #include "player.h"
 
@@ -153,6 +154,9 @@ void citizens_nation_set(struct city *pcity, const struct player_slot *pslot,
   fc_assert_ret(pcity != NULL);
   fc_assert_ret(pcity->nationality != NULL);
 
+  if (*(pcity->nationality + player_slot_index(pslot)) != count) {
+    effect_cache_invalidate();
+  }
   *(pcity->nationality + player_slot_index(pslot)) = count;
 }
 
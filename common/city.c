@@ -49,6 +49,8 @@
 #undef CITY_DEBUGGING
 
 static char *citylog_map_line(int y, int city_radius_sq, int *city_map_data);
+static bool improvement_effects_reach_beyond_city(const struct impr_type
+                                                  *pimprove);
 #ifdef DEBUG
 /* only used for debugging */
 static void citylog_map_index(enum log_level level);
@@ -65,6 +67,10 @@ static int city_map_xy[CITY_MAP_MAX_SIZE][CITY_MAP_MAX_SIZE];
 /* number of tiles of a city; depends on the squared city radius */
 static int city_map_numtiles[CITY_MAP_MAX_RADIUS_SQ + 1];
 
+/* Bumped by every change that may alter the result of
+ * city_refresh_from_main_map() for cities other than the one changed. */
+static unsigned int city_refresh_gen = 0;
+
 /* definitions and functions for the tile_cache */
 struct tile_cache {
   int output[O_LAST];
@@ -1096,6 +1102,15 @@ void city_size_set(struct city *pcity, citizens size)
 {
   fc_assert_ret(pcity != NULL);
 
+  if (pcity->size != size) {
+    if (city_num_trade_routes(pcity) > 0) {
+      /* Trade with the partners depends on the size of both cities. */
+      city_refresh_generation_bump();
+    } else {
+      effect_cache_invalidate();
+    }
+  }
+
   /* Set city size. */
   pcity->size = size;
 }
@@ -2787,6 +2802,61 @@ static inline void city_support(struct city *pcity)
   } unit_list_iterate_end;
 }
 
+/**************************************************************************
+  Return the current city refresh generation. As long as it doesn't
+  change, refreshing a city whose own data stayed the same gives the
+  same result as before.
+**************************************************************************/
+unsigned int city_refresh_generation(void)
+{
+  return city_refresh_gen;
+}
+
+/**************************************************************************
+  Note a change that may affect the refresh results of other cities than
+  the one (if any) changed: map tiles, techs, governments, wonders, units
+  and the like.
+**************************************************************************/
+void city_refresh_generation_bump(void)
+{
+  city_refresh_gen++;
+  effect_cache_invalidate();
+}
+
+/**************************************************************************
+  Return whether the improvement can affect cities other than the one
+  having it.
+**************************************************************************/
+static bool improvement_effects_reach_beyond_city(const struct impr_type
+                                                  *pimprove)
+{
+  struct universal source = {
+    .kind = VUT_IMPROVEMENT,
+    .value = {.building = improvement_by_number(improvement_number(pimprove))}
+  };
+
+  if (is_wonder(pimprove)) {
+    return TRUE;
+  }
+
+  effect_list_iterate(get_req_source_effects(&source), peffect) {
+    requirement_list_iterate(peffect->reqs, preq) {
+      if (are_universals_equal(&preq->source, &source)
+          && preq->range > REQ_RANGE_CITY) {
+        return TRUE;
+      }
+    } requirement_list_iterate_end;
+    requirement_list_iterate(peffect->nreqs, preq) {
+      if (are_universals_equal(&preq->source, &source)
+          && preq->range > REQ_RANGE_CITY) {
+        return TRUE;
+      }
+    } requirement_list_iterate_end;
+  } effect_list_iterate_end;
+
+  return FALSE;
+}
+
 /**************************************************************************
   Refreshes the internal cached data in the city structure.
 
@@ -2974,6 +3044,12 @@ void city_add_improvement(struct city *pcity,
 {
   pcity->built[improvement_index(pimprove)].turn = game.info.turn; /*I_ACTIVE*/
 
+  if (improvement_effects_reach_beyond_city(pimprove)) {
+    city_refresh_generation_bump();
+  } else {
+    effect_cache_invalidate();
+  }
+
   if (is_server() && is_wonder(pimprove)) {
     /* Client just read the info from the packets. */
     wonder_built(pcity, pimprove);
@@ -2991,6 +3067,12 @@ void city_remove_improvement(struct city *pcity,
   
   pcity->built[improvement_index(pimprove)].turn = I_DESTROYED;
 
+  if (improvement_effects_reach_beyond_city(pimprove)) {
+    city_refresh_generation_bump();
+  } else {
+    effect_cache_invalidate();
+  }
+
   if (is_server() && is_wonder(pimprove)) {
     /* Client just read the info from the packets. */
     wonder_destroyed(pcity, pimprove);
@@ -3056,6 +3138,7 @@ struct city *create_city_virtual(struct player *pplayer,
 
   pcity->tile = ptile;
   fc_assert_ret_val(NULL != pplayer, NULL);     /* No unowned cities! */
+  pcity->effect_cache = effect_cache_new();
   pcity->owner = pplayer;
   pcity->original = pplayer;
 
@@ -3118,6 +3201,7 @@ void destroy_city_virtual(struct city *pcity)
   CALL_FUNC_EACH_AI(city_free, pcity);
 
   citizens_free(pcity);
+  effect_cache_destroy(pcity->effect_cache);
 
   unit_list_destroy(pcity->units_supported);
   if (pcity->tile_cache != NULL) {
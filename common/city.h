@@ -332,6 +332,7 @@ struct city {
 
   /* Cached values for CPU savings. */
   int bonus[O_LAST];
+  struct effect_cache *effect_cache; /* see effects.c */
 
   /* the physics */
   int food_stock;
@@ -665,6 +666,8 @@ void city_remove_improvement(struct city *pcity,
 
 /* city update functions */
 void city_refresh_from_main_map(struct city *pcity, bool *workers_map);
+unsigned int city_refresh_generation(void);
+void city_refresh_generation_bump(void);
 
 int city_waste(const struct city *pcity, Output_type_id otype, int total);
 Specialist_type_id best_specialist(Output_type_id otype,
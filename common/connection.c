@@ -158,19 +158,163 @@ int read_socket_data(int sock, struct socket_packet_buffer *buffer)
   return -1;
 }
 
+/**************************************************************************
+  Create a packet buffer with room for 'capacity' bytes and a single
+  reference, held by the caller.
+**************************************************************************/
+struct packet_buffer *packet_buffer_new(int capacity)
+{
+  struct packet_buffer *pbuf = fc_malloc(sizeof(*pbuf));
+
+  pbuf->refcount = 1;
+  pbuf->size = 0;
+  pbuf->capacity = capacity;
+  pbuf->data = fc_malloc(MAX(capacity, 1));
+  return pbuf;
+}
+
+/**************************************************************************
+  Take another reference to the packet buffer. Returns 'pbuf'.
+**************************************************************************/
+struct packet_buffer *packet_buffer_ref(struct packet_buffer *pbuf)
+{
+  pbuf->refcount++;
+  return pbuf;
+}
+
+/**************************************************************************
+  Drop a reference to the packet buffer, freeing it with the last one.
+**************************************************************************/
+void packet_buffer_unref(struct packet_buffer *pbuf)
+{
+  fc_assert_ret(0 < pbuf->refcount);
+
+  if (0 == --pbuf->refcount) {
+    free(pbuf->data);
+    free(pbuf);
+  }
+}
+
+/* Size of the buffers small writes are collected into. */
+#define SEND_QUEUE_CHUNK (10 * MAX_LEN_PACKET)
+
+/**************************************************************************
+  Return malloced send queue, appropriately initialized.
+**************************************************************************/
+static struct socket_send_queue *new_socket_send_queue(void)
+{
+  return fc_calloc(1, sizeof(struct socket_send_queue));
+}
+
+/**************************************************************************
+  Free the send queue and drop its references.
+**************************************************************************/
+static void free_socket_send_queue(struct socket_send_queue *queue)
+{
+  int i;
+
+  if (NULL == queue) {
+    return;
+  }
+
+  for (i = 0; i < queue->nbufs; i++) {
+    packet_buffer_unref(queue->bufs[i]);
+  }
+  if (NULL != queue->spare) {
+    packet_buffer_unref(queue->spare);
+  }
+  free(queue->bufs);
+  free(queue);
+}
+
+/**************************************************************************
+  Append a reference to 'pbuf' to the queue. The reference is taken over
+  from the caller.
+**************************************************************************/
+static void send_queue_append(struct socket_send_queue *queue,
+                              struct packet_buffer *pbuf)
+{
+  if (queue->nbufs == queue->nalloc) {
+    queue->nalloc = MAX(8, 2 * queue->nalloc);
+    queue->bufs = fc_realloc(queue->bufs,
+                             queue->nalloc * sizeof(*queue->bufs));
+  }
+  queue->bufs[queue->nbufs++] = pbuf;
+  queue->ndata += pbuf->size;
+  queue->nsize = MAX(queue->nsize, queue->ndata);
+}
+
+/**************************************************************************
+  Remove 'len' written bytes from the head of the queue.
+**************************************************************************/
+static void send_queue_consume(struct socket_send_queue *queue, int len)
+{
+  int done = 0;
+
+  queue->ndata -= len;
+  len += queue->offset;
+  while (done < queue->nbufs && len >= queue->bufs[done]->size) {
+    struct packet_buffer *pbuf = queue->bufs[done++];
+
+    len -= pbuf->size;
+    if (NULL == queue->spare && 1 == pbuf->refcount
+        && SEND_QUEUE_CHUNK == pbuf->capacity) {
+      pbuf->size = 0;
+      queue->spare = pbuf;
+    } else {
+      packet_buffer_unref(pbuf);
+    }
+  }
+
+  queue->nbufs -= done;
+  memmove(queue->bufs, queue->bufs + done,
+          queue->nbufs * sizeof(*queue->bufs));
+  queue->offset = len;
+}
+
+/**************************************************************************
+  Write as much of the queue as the socket takes in one go, at most
+  'max_len' bytes. Returns the number of bytes written, or -1 on error.
+**************************************************************************/
+static int send_queue_write(int sock, struct socket_send_queue *queue,
+                            int max_len)
+{
+  struct fc_iovec iov[FC_IOV_MAX];
+  int offset = queue->offset;
+  int iovcnt, total = 0;
+
+  for (iovcnt = 0;
+       iovcnt < queue->nbufs && iovcnt < FC_IOV_MAX && total < max_len;
+       iovcnt++) {
+    const struct packet_buffer *pbuf = queue->bufs[iovcnt];
+
+    iov[iovcnt].base = pbuf->data + offset;
+    iov[iovcnt].len = MIN(pbuf->size - offset, max_len - total);
+    total += iov[iovcnt].len;
+    offset = 0;
+  }
+
+  log_debug("trying to write %d bytes in %d pieces", total, iovcnt);
+  return fc_writevsocket(sock, iov, iovcnt);
+}
+
 /**************************************************************************
   write wrapper function -vasc
 **************************************************************************/
 static int write_socket_data(struct connection *pc,
-			     struct socket_packet_buffer *buf, int limit)
+                             struct socket_send_queue *queue, int limit)
 {
-  int start, nput, nblock;
+  /* The server's sockets are non-blocking and can be handed everything
+   * at once. Elsewhere, keep the writes small enough not to block for
+   * long. */
+  int max_len = is_server() ? MAX_LEN_BUFFER : MAX_LEN_PACKET;
+  int start, nput;
 
   if (is_server() && pc->server.is_closing) {
     return 0;
   }
 
-  for (start=0; buf->ndata-start>limit;) {
+  for (start = 0; queue->ndata > limit;) {
     fd_set writefs, exceptfs;
     struct timeval tv;
 
@@ -197,10 +341,8 @@ static int write_socket_data(struct connection *pc,
     }
 
     if (FD_ISSET(pc->sock, &writefs)) {
-      nblock=MIN(buf->ndata-start, MAX_LEN_PACKET);
-      log_debug("trying to write %d limit=%d", nblock, limit);
-      if((nput=fc_writesocket(pc->sock, 
-			      (const char *)buf->data+start, nblock)) == -1) {
+      log_debug("trying to write %d limit=%d", queue->ndata, limit);
+      if ((nput = send_queue_write(pc->sock, queue, max_len)) == -1) {
 #ifdef NONBLOCKING_SOCKETS
 	if (errno == EWOULDBLOCK || errno == EAGAIN) {
 	  break;
@@ -209,13 +351,12 @@ static int write_socket_data(struct connection *pc,
         connection_close(pc, _("lagging connection"));
         return -1;
       }
+      send_queue_consume(queue, nput);
       start += nput;
     }
   }
 
   if (start > 0) {
-    buf->ndata -= start;
-    memmove(buf->data, buf->data+start, buf->ndata);
     pc->last_write = timer_renew(pc->last_write, TIMER_USER, TIMER_ACTIVE);
     timer_start(pc->last_write);
   }
@@ -252,12 +393,15 @@ static void flush_connection_send_buffer_packets(struct connection *pc)
 }
 
 /****************************************************************************
-  Add data to send to the connection.
+  Add data to send to the connection. If 'pbuf' is given, a reference to
+  it is queued; otherwise 'len' bytes from 'data' are copied.
 ****************************************************************************/
 static bool add_connection_data(struct connection *pconn,
-                                const unsigned char *data, int len)
+                                const unsigned char *data, int len,
+                                struct packet_buffer *pbuf)
 {
-  struct socket_packet_buffer *buf;
+  struct socket_send_queue *queue;
+  struct packet_buffer *tail;
 
   if (NULL == pconn
       || !pconn->used
@@ -265,23 +409,48 @@ static bool add_connection_data(struct connection *pconn,
     return TRUE;
   }
 
-  buf = pconn->send_buffer;
-  log_debug("add %d bytes to %d (space =%d)", len, buf->ndata, buf->nsize);
-  if (!buffer_ensure_free_extra_space(buf, len)) {
+  queue = pconn->send_buffer;
+  log_debug("add %d bytes to %d", len, queue->ndata);
+  /* added this check so we don't gobble up too much mem */
+  if (queue->ndata + len > MAX_LEN_BUFFER) {
     connection_close(pconn, _("buffer overflow"));
     return FALSE;
   }
 
-  memcpy(buf->data + buf->ndata, data, len);
-  buf->ndata += len;
+  if (NULL != pbuf) {
+    if (0 < len) {
+      send_queue_append(queue, packet_buffer_ref(pbuf));
+    }
+    return TRUE;
+  }
+
+  /* Copy into the last buffer if it is ours and has room left. */
+  tail = (0 < queue->nbufs ? queue->bufs[queue->nbufs - 1] : NULL);
+  if (NULL == tail || 1 < tail->refcount
+      || tail->capacity - tail->size < len) {
+    if (NULL != queue->spare && len <= queue->spare->capacity) {
+      tail = queue->spare;
+      queue->spare = NULL;
+    } else {
+      tail = packet_buffer_new(MAX(len, SEND_QUEUE_CHUNK));
+    }
+    send_queue_append(queue, tail);
+  }
+
+  memcpy(tail->data + tail->size, data, len);
+  tail->size += len;
+  queue->ndata += len;
+  queue->nsize = MAX(queue->nsize, queue->ndata);
   return TRUE;
 }
 
 /****************************************************************************
-  Write data to socket. Return TRUE on success.
+  Queue data to be sent and write what the buffering mode allows. Return
+  TRUE on success.
 ****************************************************************************/
-bool connection_send_data(struct connection *pconn,
-                          const unsigned char *data, int len)
+static bool connection_send(struct connection *pconn,
+                            const unsigned char *data, int len,
+                            struct packet_buffer *pbuf)
 {
   if (NULL == pconn
       || !pconn->used
@@ -292,7 +461,7 @@ bool connection_send_data(struct connection *pconn,
   pconn->statistics.bytes_send += len;
   if (0 < pconn->send_buffer->do_buffer_sends) {
     flush_connection_send_buffer_packets(pconn);
-    if (!add_connection_data(pconn, data, len)) {
+    if (!add_connection_data(pconn, data, len, pbuf)) {
       log_verbose("cut connection %s due to huge send buffer (1)",
                   conn_description(pconn));
       return FALSE;
@@ -300,7 +469,7 @@ bool connection_send_data(struct connection *pconn,
     flush_connection_send_buffer_packets(pconn);
   } else {
     flush_connection_send_buffer_all(pconn);
-    if (!add_connection_data(pconn, data, len)) {
+    if (!add_connection_data(pconn, data, len, pbuf)) {
       log_verbose("cut connection %s due to huge send buffer (2)",
                   conn_description(pconn));
       return FALSE;
@@ -310,6 +479,26 @@ bool connection_send_data(struct connection *pconn,
   return TRUE;
 }
 
+/****************************************************************************
+  Write data to socket. Return TRUE on success.
+****************************************************************************/
+bool connection_send_data(struct connection *pconn,
+                          const unsigned char *data, int len)
+{
+  return connection_send(pconn, data, len, NULL);
+}
+
+/****************************************************************************
+  Send the contents of 'pbuf' to the connection. The buffer is queued by
+  reference and must not be changed afterwards; the caller keeps its own
+  reference. Return TRUE on success.
+****************************************************************************/
+bool connection_send_buffer(struct connection *pconn,
+                            struct packet_buffer *pbuf)
+{
+  return connection_send(pconn, pbuf->data, pbuf->size, pbuf);
+}
+
 /**************************************************************************
   Turn on buffering, using a counter so that calls may be nested.
 **************************************************************************/
@@ -515,16 +704,6 @@ int get_next_request_id(int old_request_id)
   return result;
 }
 
-/**************************************************************************
-  Free compression queue for given connection.
-**************************************************************************/
-void free_compression_queue(struct connection *pc)
-{
-#ifdef USE_COMPRESSION
-  byte_vector_free(&pc->compression.queue);
-#endif
-}
-
 /**************************************************************************
   Allocate and initialize packet hashs for given connection.
 **************************************************************************/
@@ -550,6 +729,9 @@ static void free_packet_hashes(struct connection *pc)
 {
   int i;
 
+  /* Don't destroy the hashes shared with other connections. */
+  conn_delta_group_leave(pc);
+
   if (pc->phs.sent) {
     for (i = 0; i < PACKET_LAST; i++) {
       if (pc->phs.sent[i] != NULL) {
@@ -588,15 +770,13 @@ void connection_common_init(struct connection *pconn)
   pconn->closing_reason = NULL;
   pconn->last_write = NULL;
   pconn->buffer = new_socket_packet_buffer();
-  pconn->send_buffer = new_socket_packet_buffer();
+  pconn->send_buffer = new_socket_send_queue();
   pconn->statistics.bytes_send = 0;
 
+  pconn->delta_group = NULL;
   init_packet_hashs(pconn);
 
-#ifdef USE_COMPRESSION
-  byte_vector_init(&pconn->compression.queue);
-  pconn->compression.frozen_level = 0;
-#endif
+  conn_compression_init(pconn);
 }
 
 /**************************************************************************
@@ -617,7 +797,7 @@ void connection_common_close(struct connection *pconn)
     free_socket_packet_buffer(pconn->buffer);
     pconn->buffer = NULL;
 
-    free_socket_packet_buffer(pconn->send_buffer);
+    free_socket_send_queue(pconn->send_buffer);
     pconn->send_buffer = NULL;
 
     if (pconn->last_write) {
@@ -638,6 +818,9 @@ void conn_reset_delta_state(struct connection *pc)
 {
   int i;
 
+  /* The other members keep the shared delta-state. */
+  conn_delta_group_leave(pc);
+
   for (i = 0; i < PACKET_LAST; i++) {
     if (packet_has_game_info_flag(i)) {
       if (NULL != pc->phs.sent && NULL != pc->phs.sent[i]) {
@@ -650,6 +833,236 @@ void conn_reset_delta_state(struct connection *pc)
   }
 }
 
+/**************************************************************************
+  A set of connections sharing the delta-state of the is-game-info
+  packets. The 'sent' hashes of the members point to the ones of the
+  group, so a packet is delta-encoded once for all of them and the
+  resulting bytes are sent to every member (see send_packet_data()).
+  Hashes are still created lazily by the packet senders; the group
+  adopts them in conn_delta_group_shares().
+**************************************************************************/
+struct conn_delta_group {
+  struct conn_list *members;
+  struct genhash *sent[PACKET_LAST];
+};
+
+/**************************************************************************
+  Send again an is-game-info packet taken from a delta hash. Returns FALSE
+  if the packet type is unknown here.
+**************************************************************************/
+static bool delta_group_resend(struct connection *pconn,
+                               enum packet_type type, const void *packet)
+{
+  switch (type) {
+  case PACKET_TILE_INFO:
+    send_packet_tile_info(pconn, packet);
+    return TRUE;
+  case PACKET_CITY_INFO:
+    send_packet_city_info(pconn, packet, FALSE);
+    return TRUE;
+  case PACKET_CITY_SHORT_INFO:
+    send_packet_city_short_info(pconn, packet);
+    return TRUE;
+  case PACKET_UNIT_INFO:
+    send_packet_unit_info(pconn, packet);
+    return TRUE;
+  case PACKET_UNIT_SHORT_INFO:
+    send_packet_unit_short_info(pconn, packet);
+    return TRUE;
+  default:
+    break;
+  }
+
+  return FALSE;
+}
+
+/**************************************************************************
+  Make 'pconn' share the delta-state of the is-game-info packets with
+  'peer' (creating a group for 'peer' if needed), or start a group of its
+  own when 'peer' is NULL. The caller must make sure all the members will
+  be sent the same is-game-info packets, and that both connections use
+  the same packet variants.
+
+  The client of 'pconn' knows what was sent to it, and the clients of the
+  group what was sent to the group; both may differ. So first the packets
+  cached for 'pconn' are sent to the group, then the ones the group has
+  and 'pconn' doesn't are sent to 'pconn'. Then both caches are equal and
+  the private one is dropped.
+**************************************************************************/
+void conn_delta_group_join(struct connection *pconn,
+                           struct connection *peer)
+{
+  struct conn_delta_group *pgroup;
+  struct connection *first;
+  enum packet_type i;
+
+  fc_assert_ret(NULL != pconn);
+  fc_assert_ret(NULL == pconn->delta_group);
+  fc_assert_ret(NULL != pconn->phs.sent);
+
+  if (NULL == peer || NULL == peer->delta_group) {
+    pgroup = fc_malloc(sizeof(*pgroup));
+    pgroup->members = conn_list_new();
+    for (i = 0; i < PACKET_LAST; i++) {
+      pgroup->sent[i] = NULL;
+    }
+
+    if (NULL == peer) {
+      peer = pconn;
+    } else {
+      fc_assert(peer->phs.sent != NULL);
+    }
+    for (i = 0; i < PACKET_LAST; i++) {
+      if (packet_has_game_info_flag(i)) {
+        pgroup->sent[i] = peer->phs.sent[i];
+      }
+    }
+    conn_list_append(pgroup->members, peer);
+    peer->delta_group = pgroup;
+
+    if (peer == pconn) {
+      return;
+    }
+  }
+
+  pgroup = peer->delta_group;
+  first = conn_list_get(pgroup->members, 0);
+
+  /* Bring the group up to date with 'pconn'. */
+  for (i = 0; i < PACKET_LAST; i++) {
+    if (packet_has_game_info_flag(i) && NULL != pconn->phs.sent[i]) {
+      genhash_values_iterate(pconn->phs.sent[i], packet) {
+        if (!delta_group_resend(first, i, packet)) {
+          log_error("Can't share the delta-state of %s packets.",
+                    packet_name(i));
+          return;
+        }
+      } genhash_values_iterate_end;
+    }
+  }
+
+  /* Then 'pconn' up to date with the group. */
+  for (i = 0; i < PACKET_LAST; i++) {
+    if (packet_has_game_info_flag(i) && NULL != pgroup->sent[i]) {
+      genhash_values_iterate(pgroup->sent[i], packet) {
+        if (NULL == pconn->phs.sent[i]
+            || !genhash_lookup(pconn->phs.sent[i], packet, NULL)) {
+          if (!delta_group_resend(pconn, i, packet)) {
+            log_error("Can't share the delta-state of %s packets.",
+                      packet_name(i));
+            return;
+          }
+        }
+      } genhash_values_iterate_end;
+    }
+  }
+
+  for (i = 0; i < PACKET_LAST; i++) {
+    if (packet_has_game_info_flag(i)) {
+      if (NULL != pconn->phs.sent[i]) {
+        fc_assert(NULL == pgroup->sent[i]
+                  || (genhash_size(pgroup->sent[i])
+                      == genhash_size(pconn->phs.sent[i])));
+        genhash_destroy(pconn->phs.sent[i]);
+      }
+      pconn->phs.sent[i] = pgroup->sent[i];
+    }
+  }
+  conn_list_append(pgroup->members, pconn);
+  pconn->delta_group = pgroup;
+
+  log_debug("%s shares the delta-state with %d other connection(s).",
+            conn_description(pconn), conn_list_size(pgroup->members) - 1);
+}
+
+/**************************************************************************
+  Stop sharing the delta-state of the is-game-info packets. The
+  connection is left with an empty delta-state for them, so unless it
+  is closing, its client must be reset as well, or not be sent any of
+  them anymore.
+**************************************************************************/
+void conn_delta_group_leave(struct connection *pconn)
+{
+  struct conn_delta_group *pgroup = pconn->delta_group;
+  enum packet_type i;
+
+  if (NULL == pgroup) {
+    return;
+  }
+
+  conn_list_remove(pgroup->members, pconn);
+  pconn->delta_group = NULL;
+  if (NULL != pconn->phs.sent) {
+    for (i = 0; i < PACKET_LAST; i++) {
+      if (packet_has_game_info_flag(i)) {
+        fc_assert(pconn->phs.sent[i] == pgroup->sent[i]);
+        pconn->phs.sent[i] = NULL;
+      }
+    }
+  }
+
+  if (0 == conn_list_size(pgroup->members)) {
+    for (i = 0; i < PACKET_LAST; i++) {
+      if (NULL != pgroup->sent[i]) {
+        genhash_destroy(pgroup->sent[i]);
+      }
+    }
+    conn_list_destroy(pgroup->members);
+    free(pgroup);
+  }
+}
+
+/**************************************************************************
+  Returns whether the packet of this type just encoded for the connection
+  used the delta-state shared with its group, and so must be sent to all
+  the members. A delta hash created for the first time by the encoder is
+  made the one of the group here.
+**************************************************************************/
+bool conn_delta_group_shares(struct connection *pconn, int packet_type)
+{
+  struct conn_delta_group *pgroup = pconn->delta_group;
+  struct genhash *phash;
+
+  if (NULL == pgroup || !packet_has_game_info_flag(packet_type)
+      || NULL == (phash = pconn->phs.sent[packet_type])) {
+    return FALSE;
+  }
+
+  if (NULL == pgroup->sent[packet_type]) {
+    pgroup->sent[packet_type] = phash;
+    conn_list_iterate(pgroup->members, pmember) {
+      fc_assert(NULL == pmember->phs.sent[packet_type]
+                || phash == pmember->phs.sent[packet_type]);
+      pmember->phs.sent[packet_type] = phash;
+    } conn_list_iterate_end;
+  }
+
+  fc_assert_ret_val(phash == pgroup->sent[packet_type], FALSE);
+  return TRUE;
+}
+
+/**************************************************************************
+  Returns TRUE if the connection shares the delta-state with others and
+  isn't the first of them. What is sent to the first one reaches it
+  anyway, so a loop sending the same is-game-info packets to a list
+  holding them all (like game.est_connections) can skip it.
+**************************************************************************/
+bool conn_delta_group_follower(const struct connection *pconn)
+{
+  return (NULL != pconn->delta_group
+          && pconn != conn_list_get(pconn->delta_group->members, 0));
+}
+
+/**************************************************************************
+  Returns the connections sharing the delta-state with this one, itself
+  included, or NULL if it doesn't share it.
+**************************************************************************/
+const struct conn_list *
+conn_delta_group_members(const struct connection *pconn)
+{
+  return NULL != pconn->delta_group ? pconn->delta_group->members : NULL;
+}
+
 /****************************************************************************
   Freeze the connection. Then the packets sent to it won't be sent
   immediatly, but later, using a compression method. See futher details in
@@ -43,6 +43,7 @@ extern "C" {
 
 struct genhash;
 struct timer_list;
+struct z_stream_s;
 struct conn_pattern_list;
 
 /* Used in the network protocol. */
@@ -91,6 +92,7 @@ enum auth_status {
   AS_FAILED,
   AS_REQUESTING_NEW_PASS,
   AS_REQUESTING_OLD_PASS,
+  AS_WAITING_FCDB,              /* waiting on the database, see auth.c */
   AS_ESTABLISHED
 };
 
@@ -117,6 +119,35 @@ struct socket_packet_buffer {
   unsigned char *data;
 };
 
+/***********************************************************
+  A reference counted block of outgoing data. The same
+  buffer may be queued on several connections at once, for
+  data that is sent to all of them unchanged; it is freed
+  when the last reference is dropped.
+***********************************************************/
+struct packet_buffer {
+  int refcount;
+  int size;                     /* Bytes of data. */
+  int capacity;                 /* Bytes allocated for data. */
+  unsigned char *data;
+};
+
+/***********************************************************
+  The data waiting to be written to a connection, as a queue
+  of packet buffers. Small writes are collected into buffers
+  of the queue's own; shared buffers are only referenced.
+***********************************************************/
+struct socket_send_queue {
+  int ndata;                    /* Bytes waiting, in all buffers. */
+  int do_buffer_sends;
+  int nsize;                    /* Most bytes ever waiting at once. */
+  int offset;                   /* Bytes of bufs[0] already written. */
+  int nbufs;
+  int nalloc;
+  struct packet_buffer **bufs;
+  struct packet_buffer *spare;  /* Written buffer kept for reuse. */
+};
+
 struct packet_header {
   unsigned int length : 4;      /* Actually 'enum data_type' */
   unsigned int type : 4;        /* Actually 'enum data_type' */
@@ -126,6 +157,8 @@ struct packet_header {
 #define SPECVEC_TYPE unsigned char
 #include "specvec.h"
 
+struct conn_delta_group;
+
 /***********************************************************
   The connection struct represents a single client or server
   at the other end of a network connection.
@@ -148,7 +181,7 @@ struct connection {
   struct player *playing;
 
   struct socket_packet_buffer *buffer;
-  struct socket_packet_buffer *send_buffer;
+  struct socket_send_queue *send_buffer;
   struct timer *last_write;
 
   double ping_time;
@@ -253,11 +286,32 @@ struct connection {
     int *variant;
   } phs;
 
+  /* Connections having the same view of the game (global observers)
+   * share the delta-state of the is-game-info packets: what is sent to
+   * one of them is sent to all. See conn_delta_group_join(). */
+  struct conn_delta_group *delta_group;
+
 #ifdef USE_COMPRESSION
   struct {
     int frozen_level;
+    int level;                  /* zlib level, see conn_compression_set_level(). */
 
     struct byte_vector queue;
+
+    /* With the "zstream" capability, the compressed packets sent after
+     * the join reply are parts of one deflate stream, which the other
+     * end inflates likewise. NULL until in use. */
+    bool stream_pending;        /* Start the stream after this flush. */
+    struct z_stream_s *deflate_stream;
+    int deflate_level;          /* Level the stream was last given. */
+    struct z_stream_s *inflate_stream;
+
+    struct {
+      unsigned long bytes_in;   /* Queued data flushed. */
+      unsigned long bytes_out;  /* Data sent for it. */
+      unsigned long bytes_reused; /* Flushed without compressing again. */
+      struct timer *timer;      /* CPU time spent compressing. */
+    } stats;
   } compression;
 #endif
   struct {
@@ -274,6 +328,12 @@ int read_socket_data(int sock, struct socket_packet_buffer *buffer);
 void flush_connection_send_buffer_all(struct connection *pc);
 bool connection_send_data(struct connection *pconn,
                           const unsigned char *data, int len);
+bool connection_send_buffer(struct connection *pconn,
+                            struct packet_buffer *pbuf);
+
+struct packet_buffer *packet_buffer_new(int capacity);
+struct packet_buffer *packet_buffer_ref(struct packet_buffer *pbuf);
+void packet_buffer_unref(struct packet_buffer *pbuf);
 
 void connection_do_buffer(struct connection *pc);
 void connection_do_unbuffer(struct connection *pc);
@@ -292,6 +352,16 @@ void connection_common_close(struct connection *pconn);
 void free_compression_queue(struct connection *pconn);
 void conn_reset_delta_state(struct connection *pconn);
 
+void conn_delta_group_join(struct connection *pconn,
+                           struct connection *peer);
+void conn_delta_group_leave(struct connection *pconn);
+bool conn_delta_group_shares(struct connection *pconn, int packet_type);
+bool conn_delta_group_follower(const struct connection *pconn);
+const struct conn_list *
+conn_delta_group_members(const struct connection *pconn);
+
+void conn_compression_init(struct connection *pconn);
+void conn_compression_set_level(struct connection *pconn, int level);
 void conn_compression_freeze(struct connection *pconn);
 bool conn_compression_thaw(struct connection *pconn);
 bool conn_compression_frozen(const struct connection *pconn);
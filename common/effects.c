@@ -18,6 +18,7 @@
 #include <string.h>
 
 /* utility */
+#include "bitvector.h"
 #include "fcintl.h"
 #include "log.h"
 #include "mem.h"
@@ -36,6 +37,9 @@
 
 #include "effects.h"
 
+/* Define this to check every answer of the effect bonus cache against a
+ * full recomputation (slow). */
+#undef EFFECT_CACHE_DEBUGGING
 
 static bool initialized = FALSE;
 
@@ -117,6 +121,43 @@ static struct {
 } ruleset_cache;
 
 
+/**************************************************************************
+  Effect bonus cache. get_player_bonus() and get_city_bonus() remember
+  their results per target and effect type. All entries are dropped at
+  once when anything changes that an effect requirement may depend on;
+  the code making such changes calls effect_cache_invalidate(), mostly
+  from the low level setters (techs, tiles, city size and buildings,
+  governments, units, achievements and so on).
+
+  Effect types with requirements whose changes are not reported this way
+  (diplomatic relations, the alliance range, AI skill levels, units on a
+  tile) are never cached.
+
+  The cache is only used by the server, and only while it is enabled
+  with effect_cache_enable(). It is read only while
+  effect_cache_set_read_only() is in force, so that several threads can
+  query effects at the same time.
+**************************************************************************/
+BV_DEFINE(bv_effect_types, EFT_COUNT);
+
+struct effect_cache {
+  unsigned int generation;
+  bv_effect_types known;
+  int value[EFT_COUNT];
+};
+
+static struct {
+  bool enabled;
+  bool read_only;
+  unsigned int generation;
+  /* Effect types that are never cached. */
+  bv_effect_types uncacheable;
+  unsigned long hits;
+  unsigned long misses;
+} effect_cache = {
+  .generation = 1
+};
+
 /**************************************************************************
   Get a list of effects of this type.
 **************************************************************************/
@@ -169,6 +210,12 @@ struct effect *effect_new(enum effect_type type, int value)
   peffect->reqs = requirement_list_new();
   peffect->nreqs = requirement_list_new();
 
+  peffect->compiled.never = FALSE;
+  peffect->compiled.needs = 0;
+  peffect->compiled.num_reqs = 0;
+  peffect->compiled.num_nreqs = 0;
+  peffect->compiled.reqs = NULL;
+
   /* Now add the effect to the ruleset cache. */
   effect_list_append(ruleset_cache.tracker, peffect);
   effect_list_append(get_effects(type), peffect);
@@ -190,9 +237,106 @@ static void effect_free(struct effect *peffect)
   } requirement_list_iterate_end;
   requirement_list_destroy(peffect->nreqs);
 
+  free(peffect->compiled.reqs);
   free(peffect);
 }
 
+/**************************************************************************
+  Evaluation order of the requirements of an effect: checks on the target
+  itself first, those looking at its surroundings last.
+**************************************************************************/
+static int effect_req_rank(const struct requirement *preq)
+{
+  switch (preq->range) {
+  case REQ_RANGE_LOCAL:
+    return 0;
+  case REQ_RANGE_CITY:
+  case REQ_RANGE_PLAYER:
+  case REQ_RANGE_WORLD:
+    return 1;
+  case REQ_RANGE_CADJACENT:
+  case REQ_RANGE_ADJACENT:
+  case REQ_RANGE_CONTINENT:
+  case REQ_RANGE_ALLIANCE:
+  case REQ_RANGE_COUNT:
+    break;
+  }
+
+  return 2;
+}
+
+/**************************************************************************
+  Sort the requirements by effect_req_rank(), keeping the ruleset order
+  otherwise.
+**************************************************************************/
+static void effect_reqs_sort(struct requirement *reqs, int count)
+{
+  int i, j;
+
+  for (i = 1; i < count; i++) {
+    struct requirement req = reqs[i];
+    int rank = effect_req_rank(&req);
+
+    for (j = i; j > 0 && effect_req_rank(&reqs[j - 1]) > rank; j--) {
+      reqs[j] = reqs[j - 1];
+    }
+    reqs[j] = req;
+  }
+}
+
+/**************************************************************************
+  Prepare the requirements of the effect for is_effect_active(). They are
+  copied into one array, enabling ones first, with requirements whose
+  outcome never changes folded away, and the targets the effect can't be
+  active without are noted. An effect left without requirements is
+  active for any target.
+**************************************************************************/
+static void effect_compile(struct effect *peffect)
+{
+  int size = requirement_list_size(peffect->reqs)
+             + requirement_list_size(peffect->nreqs);
+  struct requirement *reqs = NULL;
+  int num_reqs = 0, num_nreqs = 0;
+
+  peffect->compiled.never = FALSE;
+  peffect->compiled.needs = 0;
+
+  if (size > 0) {
+    reqs = fc_malloc(size * sizeof(*reqs));
+  }
+
+  requirement_list_iterate(peffect->reqs, preq) {
+    if (preq->source.kind == VUT_NONE) {
+      /* Always met; unless it must not be. */
+      if (!preq->present) {
+        peffect->compiled.never = TRUE;
+      }
+      continue;
+    }
+    peffect->compiled.needs |= req_needed_targets(preq, TRUE);
+    reqs[num_reqs++] = *preq;
+  } requirement_list_iterate_end;
+
+  requirement_list_iterate(peffect->nreqs, preq) {
+    if (preq->source.kind == VUT_NONE) {
+      if (preq->present) {
+        peffect->compiled.never = TRUE;
+      }
+      continue;
+    }
+    peffect->compiled.needs |= req_needed_targets(preq, FALSE);
+    reqs[num_reqs + num_nreqs++] = *preq;
+  } requirement_list_iterate_end;
+
+  effect_reqs_sort(reqs, num_reqs);
+  effect_reqs_sort(reqs + num_reqs, num_nreqs);
+
+  free(peffect->compiled.reqs);
+  peffect->compiled.reqs = reqs;
+  peffect->compiled.num_reqs = num_reqs;
+  peffect->compiled.num_nreqs = num_nreqs;
+}
+
 /**************************************************************************
   Append requirement to effect.
 **************************************************************************/
@@ -209,6 +353,15 @@ void effect_req_append(struct effect *peffect, bool neg,
 
   /* Append requirement to the effect. */
   requirement_list_append(req_list, preq);
+  effect_compile(peffect);
+
+  if (preq->source.kind == VUT_DIPLREL
+      || preq->source.kind == VUT_AI_LEVEL
+      || preq->source.kind == VUT_MAXTILEUNITS
+      || preq->range == REQ_RANGE_ALLIANCE) {
+    /* Changes of these don't invalidate the effect cache. */
+    BV_SET(effect_cache.uncacheable, peffect->type);
+  }
 
   /* Add effect to the source's effect list. */
   if (!neg) {
@@ -231,6 +384,9 @@ void ruleset_cache_init(void)
 
   initialized = TRUE;
 
+  BV_CLR_ALL(effect_cache.uncacheable);
+  effect_cache_invalidate();
+
   ruleset_cache.tracker = effect_list_new();
 
   for (i = 0; i < ARRAY_SIZE(ruleset_cache.effects); i++) {
@@ -432,37 +588,12 @@ bool is_effect_disabled(const struct player *target_player,
   return FALSE;
 }
 
-/**************************************************************************
-  Return TRUE iff all of the enabling requirements for this effect are
-  active (an effect is active if all of its enabling requirements and
-  none of its disabling ones are active).
-**************************************************************************/
-static bool is_effect_enabled(const struct player *target_player,
-			      const struct player *other_player,
-			      const struct city *target_city,
-			      const struct impr_type *target_building,
-			      const struct tile *target_tile,
-			      const struct unit_type *target_unittype,
-			      const struct output_type *target_output,
-			      const struct specialist *target_specialist,
-			      const struct effect *peffect,
-                              const enum   req_problem_type prob_type)
-{
-  requirement_list_iterate(peffect->reqs, preq) {
-    if (!is_req_active(target_player, other_player, target_city,
-                       target_building, target_tile, target_unittype,
-                       target_output, target_specialist,
-		       preq, prob_type)) {
-      return FALSE;
-    }
-  } requirement_list_iterate_end;
-  return TRUE;
-}
-
 /**************************************************************************
   Is the effect active at a certain target (player, city or building)?
 
-  This checks whether an effect's requirements are met.
+  This checks whether an effect's requirements are met, using the
+  compiled form of them. 'targets' are the REQ_TARGET_* flags of the
+  targets given.
 
   target gives the type of the target
   (player,city,building,tile) give the exact target
@@ -476,18 +607,42 @@ static bool is_effect_active(const struct player *target_player,
 			     const struct unit_type *target_unittype,
 			     const struct output_type *target_output,
 			     const struct specialist *target_specialist,
+			     int targets,
 			     const struct effect *peffect,
                              const enum   req_problem_type prob_type)
 {
-  /* Reversed prob_type when checking disabling effects */
-  return is_effect_enabled(target_player, other_player, target_city,
-                           target_building, target_tile, target_unittype,
-                           target_output, target_specialist,
-			   peffect, prob_type)
-    && !is_effect_disabled(target_player, other_player, target_city,
-                           target_building, target_tile, target_unittype,
-                           target_output, target_specialist,
-			   peffect, REVERSED_RPT(prob_type));
+  const struct requirement *preq = peffect->compiled.reqs;
+  const struct requirement *pnreqs = preq + peffect->compiled.num_reqs;
+  const struct requirement *pend = pnreqs + peffect->compiled.num_nreqs;
+
+  if (peffect->compiled.never) {
+    return FALSE;
+  }
+  if (prob_type == RPT_CERTAIN
+      && (peffect->compiled.needs & ~targets) != 0) {
+    /* Some requirement could only be "maybe" met. */
+    return FALSE;
+  }
+
+  for (; preq < pnreqs; preq++) {
+    if (!is_req_active(target_player, other_player, target_city,
+                       target_building, target_tile, target_unittype,
+                       target_output, target_specialist,
+                       preq, prob_type)) {
+      return FALSE;
+    }
+  }
+  /* Reversed prob_type when checking disabling requirements */
+  for (; preq < pend; preq++) {
+    if (is_req_active(target_player, other_player, target_city,
+                      target_building, target_tile, target_unittype,
+                      target_output, target_specialist,
+                      preq, REVERSED_RPT(prob_type))) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
 }
 
 /**************************************************************************
@@ -598,13 +753,33 @@ int get_target_bonus_effects(struct effect_list *plist,
                              enum effect_type effect_type)
 {
   int bonus = 0;
+  int targets = 0;
+
+  if (target_player != NULL) {
+    targets |= REQ_TARGET_PLAYER;
+  }
+  if (target_city != NULL) {
+    targets |= REQ_TARGET_CITY;
+  }
+  if (target_tile != NULL) {
+    targets |= REQ_TARGET_TILE;
+  }
+  if (target_unittype != NULL) {
+    targets |= REQ_TARGET_UNITTYPE;
+  }
+  if (target_output != NULL) {
+    targets |= REQ_TARGET_OUTPUT;
+  }
+  if (target_specialist != NULL) {
+    targets |= REQ_TARGET_SPECIALIST;
+  }
 
   /* Loop over all effects of this type. */
   effect_list_iterate(get_effects(effect_type), peffect) {
     /* For each effect, see if it is active. */
     if (is_effect_active(target_player, other_player, target_city,
                          target_building, target_tile, target_unittype,
-                         target_output, target_specialist,
+                         target_output, target_specialist, targets,
 			 peffect, RPT_CERTAIN)) {
       /* And if so add on the value. */
       bonus += peffect->value;
@@ -618,6 +793,105 @@ int get_target_bonus_effects(struct effect_list *plist,
   return bonus;
 }
 
+/**************************************************************************
+  Allocate an empty effect bonus cache for a player or city.
+**************************************************************************/
+struct effect_cache *effect_cache_new(void)
+{
+  return fc_calloc(1, sizeof(struct effect_cache));
+}
+
+/**************************************************************************
+  Free an effect bonus cache.
+**************************************************************************/
+void effect_cache_destroy(struct effect_cache *pcache)
+{
+  free(pcache);
+}
+
+/**************************************************************************
+  Turn the effect bonus cache on or off. Turning it on drops whatever
+  was cached before.
+**************************************************************************/
+void effect_cache_enable(bool enable)
+{
+  effect_cache.enabled = enable;
+  effect_cache_invalidate();
+}
+
+/**************************************************************************
+  While set, cache lookups don't store new entries, nor update the
+  statistics.
+**************************************************************************/
+void effect_cache_set_read_only(bool read_only)
+{
+  effect_cache.read_only = read_only;
+}
+
+/**************************************************************************
+  Forget all cached effect bonuses. Call this whenever something changes
+  that effect requirements may depend on.
+**************************************************************************/
+void effect_cache_invalidate(void)
+{
+  effect_cache.generation++;
+}
+
+/**************************************************************************
+  Return the number of cache hits and misses so far.
+**************************************************************************/
+void effect_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+  *hits = effect_cache.hits;
+  *misses = effect_cache.misses;
+}
+
+/**************************************************************************
+  Look up the cached bonus of the effect type. Returns FALSE if it is not
+  cached, or the type can't be cached at all.
+**************************************************************************/
+static bool effect_cache_lookup(struct effect_cache *pcache,
+                                enum effect_type effect_type, int *value)
+{
+  if (!effect_cache.enabled || pcache == NULL
+      || BV_ISSET(effect_cache.uncacheable, effect_type)) {
+    return FALSE;
+  }
+
+  if (pcache->generation == effect_cache.generation
+      && BV_ISSET(pcache->known, effect_type)) {
+    if (!effect_cache.read_only) {
+      effect_cache.hits++;
+    }
+    *value = pcache->value[effect_type];
+    return TRUE;
+  }
+
+  if (!effect_cache.read_only) {
+    effect_cache.misses++;
+  }
+  return FALSE;
+}
+
+/**************************************************************************
+  Store the bonus of the effect type in the cache.
+**************************************************************************/
+static void effect_cache_store(struct effect_cache *pcache,
+                               enum effect_type effect_type, int value)
+{
+  if (!effect_cache.enabled || effect_cache.read_only || pcache == NULL
+      || BV_ISSET(effect_cache.uncacheable, effect_type)) {
+    return;
+  }
+
+  if (pcache->generation != effect_cache.generation) {
+    BV_CLR_ALL(pcache->known);
+    pcache->generation = effect_cache.generation;
+  }
+  BV_SET(pcache->known, effect_type);
+  pcache->value[effect_type] = value;
+}
+
 /**************************************************************************
   Returns the effect bonus for the whole world.
 **************************************************************************/
@@ -639,14 +913,32 @@ int get_world_bonus(enum effect_type effect_type)
 int get_player_bonus(const struct player *pplayer,
 		     enum effect_type effect_type)
 {
+  int bonus;
+
   if (!initialized) {
     return 0;
   }
 
-  return get_target_bonus_effects(NULL,
-                                  pplayer, NULL, NULL, NULL,
-				  NULL, NULL, NULL, NULL,
-				  effect_type);
+  if (pplayer != NULL
+      && effect_cache_lookup(pplayer->effect_cache, effect_type, &bonus)) {
+#ifdef EFFECT_CACHE_DEBUGGING
+    fc_assert(bonus == get_target_bonus_effects(NULL,
+                                                pplayer, NULL, NULL, NULL,
+                                                NULL, NULL, NULL, NULL,
+                                                effect_type));
+#endif
+    return bonus;
+  }
+
+  bonus = get_target_bonus_effects(NULL,
+                                   pplayer, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL,
+                                   effect_type);
+  if (pplayer != NULL) {
+    effect_cache_store(pplayer->effect_cache, effect_type, bonus);
+  }
+
+  return bonus;
 }
 
 /**************************************************************************
@@ -654,14 +946,30 @@ int get_player_bonus(const struct player *pplayer,
 **************************************************************************/
 int get_city_bonus(const struct city *pcity, enum effect_type effect_type)
 {
+  int bonus;
+
   if (!initialized) {
     return 0;
   }
 
-  return get_target_bonus_effects(NULL,
-                                  city_owner(pcity), NULL, pcity, NULL,
-				  city_tile(pcity), NULL, NULL, NULL,
-				  effect_type);
+  if (effect_cache_lookup(pcity->effect_cache, effect_type, &bonus)) {
+#ifdef EFFECT_CACHE_DEBUGGING
+    fc_assert(bonus == get_target_bonus_effects(NULL,
+                                                city_owner(pcity), NULL,
+                                                pcity, NULL,
+                                                city_tile(pcity), NULL,
+                                                NULL, NULL, effect_type));
+#endif
+    return bonus;
+  }
+
+  bonus = get_target_bonus_effects(NULL,
+                                   city_owner(pcity), NULL, pcity, NULL,
+                                   city_tile(pcity), NULL, NULL, NULL,
+                                   effect_type);
+  effect_cache_store(pcity->effect_cache, effect_type, bonus);
+
+  return bonus;
 }
 
 /**************************************************************************
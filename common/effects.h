@@ -274,6 +274,15 @@ struct effect {
   /* An effect can have multiple negated requirements.  The effect will
    * only be active if none of these requirements are met. */
   struct requirement_list *nreqs;
+
+  /* reqs and nreqs prepared for evaluation, see effect_compile(). */
+  struct {
+    bool never;                 /* Can't ever be active. */
+    int needs;                  /* REQ_TARGET_* needed to be active. */
+    int num_reqs;
+    int num_nreqs;
+    struct requirement *reqs;   /* num_reqs, then num_nreqs of them. */
+  } compiled;
 };
 
 /* An effect_list is a list of effects. */
@@ -345,6 +354,16 @@ int get_unit_bonus(const struct unit *punit, enum effect_type effect_type);
 int get_tile_bonus(const struct tile *ptile, const struct unit *punit,
                    enum effect_type etype);
 
+/* effect bonus cache */
+struct effect_cache;
+
+struct effect_cache *effect_cache_new(void);
+void effect_cache_destroy(struct effect_cache *pcache);
+void effect_cache_enable(bool enable);
+void effect_cache_set_read_only(bool read_only);
+void effect_cache_invalidate(void);
+void effect_cache_stats(unsigned long *hits, unsigned long *misses);
+
 /* miscellaneous auxiliary effects functions */
 struct effect_list *get_req_source_effects(struct universal *psource);
 bool is_effect_disabled(const struct player *target_player,
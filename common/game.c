@@ -25,6 +25,7 @@
 
 /* aicore */
 #include "cm.h"
+#include "path_finding.h"
 
 /* common */
 #include "achievements.h"
@@ -32,6 +33,7 @@
 #include "city.h"
 #include "connection.h"
 #include "disaster.h"
+#include "effects.h"
 #include "extras.h"
 #include "government.h"
 #include "idex.h"
@@ -393,6 +395,8 @@ static void game_defaults(void)
     sz_strlcpy(game.server.rulesetdir, GAME_DEFAULT_RULESETDIR);
     game.server.save_compress_level = GAME_DEFAULT_COMPRESS_LEVEL;
     game.server.save_compress_type = GAME_DEFAULT_COMPRESS_TYPE;
+    game.server.save_format       = GAME_DEFAULT_SAVE_FORMAT;
+    game.server.save_async        = GAME_DEFAULT_SAVE_ASYNC;
     sz_strlcpy(game.server.save_name, GAME_DEFAULT_SAVE_NAME);
     game.server.save_nturns       = GAME_DEFAULT_SAVETURNS;
     game.server.save_options.save_known = TRUE;
@@ -417,6 +421,7 @@ static void game_defaults(void)
     game.server.timeoutintinc     = GAME_DEFAULT_TIMEOUTINTINC;
     game.server.turnblock         = GAME_DEFAULT_TURNBLOCK;
     game.server.unitwaittime      = GAME_DEFAULT_UNITWAITTIME;
+    game.server.worker_threads    = GAME_DEFAULT_WORKER_THREADS;
     game.server.plr_colors        = NULL;
   }
 }
@@ -435,6 +440,7 @@ void game_init(void)
   game_ruleset_init();
   idex_init();
   cm_init();
+  pf_map_pool_init();
   player_researches_init();
 }
 
@@ -464,6 +470,7 @@ void game_free(void)
   set_allowed_nation_groups(NULL);
   game_ruleset_free();
   cm_free();
+  pf_map_pool_free();
 }
 
 /***************************************************************
@@ -510,6 +517,9 @@ void game_ruleset_init(void)
   user_unit_type_flags_init();
   user_terrain_flags_init();
   user_tech_flags_init();
+
+  /* The move costs come from the ruleset. */
+  tile_move_cost_generation_bump();
 }
 
 /***************************************************************
@@ -631,6 +641,7 @@ void game_advance_year(void)
 {
   game.info.year = game_next_year(game.info.year);
   game.info.turn++;
+  effect_cache_invalidate();
 }
 
 /**************************************************************************
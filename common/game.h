@@ -136,6 +136,7 @@ struct civ_game {
       int killunhomed;    /* slowly killing unhomed units */
       int maxconnectionsperhost;
       int max_players;
+      int worker_threads;
       int mgr_distance;
       bool mgr_foodneeded;
       int mgr_nationchance;
@@ -157,6 +158,8 @@ struct civ_game {
       int revolution_length;
       int save_compress_level;
       enum fz_method save_compress_type;
+      enum secfile_format save_format;
+      bool save_async;
       int save_nturns;
       unsigned autosaves; /* FIXME: char would be enough, but current settings.c code wants to
                              write sizeof(unsigned) bytes */
@@ -575,6 +578,10 @@ extern struct civ_game game;
 #  define GAME_DEFAULT_COMPRESS_TYPE FZ_PLAIN
 #endif
 
+#define GAME_DEFAULT_SAVE_FORMAT    SECFILE_FORMAT_TEXT
+
+#define GAME_DEFAULT_SAVE_ASYNC     FALSE
+
 #define GAME_DEFAULT_ALLOWED_CITY_NAMES CNM_PLAYER_UNIQUE
 
 #define GAME_DEFAULT_PLRCOLORMODE PLRCOL_PLR_ORDER
@@ -589,6 +596,10 @@ extern struct civ_game game;
 
 #define GAME_MAX_READ_RECURSION 10 /* max recursion for the read command */
 
+#define GAME_DEFAULT_WORKER_THREADS 0      /* 0 = single threaded. */
+#define GAME_MIN_WORKER_THREADS     0
+#define GAME_MAX_WORKER_THREADS     64
+
 #define GAME_DEFAULT_KICK_TIME 1800     /* 1800 seconds = 30 minutes. */
 #define GAME_MIN_KICK_TIME 0            /* 0 = disabling. */
 #define GAME_MAX_KICK_TIME 86400        /* 86400 seconds = 24 hours. */
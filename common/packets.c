@@ -38,6 +38,7 @@
 #include "support.h"
 
 /* commmon */
+#include "capstr.h"
 #include "dataio.h"
 #include "game.h"
 #include "events.h"
@@ -61,6 +62,12 @@
  * All compressed packets this size or greater are sent as a jumbo packet.
  */
 #define JUMBO_BORDER 		(64*1024-COMPRESSION_BORDER-1)
+
+/*
+ * Network capability of compressing what follows the join reply as one
+ * stream, see post_send_packet_server_join_reply().
+ */
+#define STREAM_CAPABILITY	"ZStream"
 #endif
 
 #define log_compress    log_debug
@@ -73,11 +80,6 @@
 #define PACKET_SIZE_STATISTICS 0
 
 #ifdef USE_COMPRESSION
-static int stat_size_alone = 0;
-static int stat_size_uncompressed = 0;
-static int stat_size_compressed = 0;
-static int stat_size_no_compression = 0;
-
 /****************************************************************************
   Returns the compression level. Initilialize it if needed.
 ****************************************************************************/
@@ -97,76 +99,341 @@ static inline int get_compression_level(void)
 }
 
 /****************************************************************************
-  Send all waiting data. Return TRUE on success.
+  Write the header of a compressed packet carrying 'compressed_size' bytes
+  in front of them. 'pbuf' holds the data from offset 6 on; returns the
+  offset where the packet starts.
 ****************************************************************************/
-static bool conn_compression_flush(struct connection *pconn)
+static int compression_header(struct packet_buffer *pbuf,
+                              unsigned long compressed_size)
 {
-  int compression_level = get_compression_level();
-  uLongf compressed_size = 12 + 1.001 * pconn->compression.queue.size;
-  int error;
-  Bytef compressed[compressed_size];
-  bool jumbo;
-  unsigned long compressed_packet_len;
+  struct data_out dout;
 
-  error = compress2(compressed, &compressed_size,
-                    pconn->compression.queue.p,
-                    pconn->compression.queue.size,
+  /* Include normal length field in decision */
+  if (compressed_size + 2 < JUMBO_BORDER) {
+    FC_STATIC_ASSERT(COMPRESSION_BORDER > MAX_LEN_PACKET,
+                     uncompressed_compressed_packet_len_overlap);
+
+    log_compress("COMPRESS: sending %ld as normal", compressed_size);
+    dio_output_init(&dout, pbuf->data + 4, 2);
+    dio_put_uint16(&dout, 2 + compressed_size + COMPRESSION_BORDER);
+    return 4;
+  } else {
+    FC_STATIC_ASSERT(JUMBO_SIZE >= JUMBO_BORDER+COMPRESSION_BORDER,
+                     compressed_normal_jumbo_packet_len_overlap);
+
+    log_compress("COMPRESS: sending %ld as jumbo", compressed_size);
+    dio_output_init(&dout, pbuf->data, 6);
+    dio_put_uint16(&dout, JUMBO_SIZE);
+    dio_put_uint32(&dout, 6 + compressed_size);
+    return 0;
+  }
+}
+
+/****************************************************************************
+  Build the data to send for a compression queue: a compressed packet
+  if that is smaller, else the queue itself.
+****************************************************************************/
+static struct packet_buffer *compression_output(const unsigned char *queue,
+                                                size_t size,
+                                                int compression_level)
+{
+  uLongf compressed_size = compressBound(size);
+  /* Room for the largest header in front of the data. */
+  struct packet_buffer *pbuf = packet_buffer_new(6 + compressed_size);
+  int error, start;
+
+  error = compress2(pbuf->data + 6, &compressed_size, queue, size,
                     compression_level);
-  fc_assert_ret_val(error == Z_OK, FALSE);
+  fc_assert(error == Z_OK);
+
+  if (error == Z_OK
+      && compressed_size + (compressed_size + 2 < JUMBO_BORDER ? 2 : 6)
+         < size) {
+    start = compression_header(pbuf, compressed_size);
+    /* Move the packet to the front; the buffer may be shared and sent
+     * as a whole. */
+    memmove(pbuf->data, pbuf->data + start, 6 - start + compressed_size);
+    pbuf->size = 6 - start + compressed_size;
+  } else {
+    log_compress("COMPRESS: would enlarge %lu bytes; sending uncompressed",
+                 (unsigned long) size);
+    memcpy(pbuf->data, queue, size);
+    pbuf->size = size;
+  }
+
+  return pbuf;
+}
+
+/****************************************************************************
+  Build the data to send for a compression queue as the next part of the
+  connection's deflate stream. The whole queue is flushed, so the other
+  end can inflate it at once.
+****************************************************************************/
+static struct packet_buffer *stream_output(struct connection *pconn,
+                                           const unsigned char *queue,
+                                           size_t size)
+{
+  z_stream *strm = pconn->compression.deflate_stream;
+  /* The bound does not count the flush marker; leave room for it. */
+  struct packet_buffer *pbuf =
+      packet_buffer_new(6 + deflateBound(strm, size) + 16);
+  int error, start;
+
+  strm->next_in = (Bytef *) queue;
+  strm->avail_in = size;
+  strm->next_out = pbuf->data + 6;
+  strm->avail_out = pbuf->capacity - 6;
+
+  if (pconn->compression.deflate_level != pconn->compression.level) {
+    /* Anything this has to write goes to the output as well. */
+    error = deflateParams(strm, pconn->compression.level,
+                          Z_DEFAULT_STRATEGY);
+    fc_assert(error == Z_OK);
+    pconn->compression.deflate_level = pconn->compression.level;
+  }
+
+  error = deflate(strm, Z_SYNC_FLUSH);
+  fc_assert(error == Z_OK && 0 == strm->avail_in && 0 < strm->avail_out);
+
+  start = compression_header(pbuf, strm->next_out - (pbuf->data + 6));
+  pbuf->size = strm->next_out - (pbuf->data + start);
+  memmove(pbuf->data, pbuf->data + start, pbuf->size);
+  strm->next_in = NULL;
+  strm->next_out = NULL;
+
+  return pbuf;
+}
+
+/****************************************************************************
+  Start the deflate stream of the connection. See also
+  post_send_packet_server_join_reply().
+****************************************************************************/
+static void conn_compression_start_stream(struct connection *pconn)
+{
+  z_stream *strm = fc_calloc(1, sizeof(*strm));
+
+  if (Z_OK != deflateInit(strm, pconn->compression.level)) {
+    free(strm);
+    connection_close(pconn, _("compression error"));
+    return;
+  }
+  pconn->compression.deflate_stream = strm;
+  pconn->compression.deflate_level = pconn->compression.level;
+  log_compress("COMPRESS: streaming to %s", conn_description(pconn));
+}
+
+/****************************************************************************
+  Send all waiting data. Return TRUE on success.
+
+  Connections that are sent the same packets in step, like all clients
+  receiving a reloaded ruleset or global observers at turn change, end up
+  with identical queues. Without a stream, the last queue and its result
+  are kept so that the result can be queued on each of them by reference
+  instead of compressing it again.
+****************************************************************************/
+static bool conn_compression_flush(struct connection *pconn)
+{
+  static struct {
+    unsigned char *queue;       /* Copy of the last queue flushed. */
+    size_t size;
+    size_t alloc;
+    int level;
+    struct packet_buffer *output;
+  } last = { NULL, 0, 0, 0, NULL };
+  const unsigned char *queue = pconn->compression.queue.p;
+  size_t size = pconn->compression.queue.size;
+  struct packet_buffer *output;
 
   /* Compression signalling currently assumes a 2-byte packet length; if that
    * changes, the protocol should probably be changed */
   fc_assert_ret_val(data_type_size(pconn->packet_header.length) == 2, FALSE);
 
-  /* Include normal length field in decision */
-  jumbo = (compressed_size+2 >= JUMBO_BORDER);
+  if (0 == size) {
+    /* Nothing to send. Don't put an empty block into a stream. */
+    output = NULL;
+  } else if (NULL != pconn->compression.deflate_stream) {
+    timer_start(pconn->compression.stats.timer);
+    output = stream_output(pconn, queue, size);
+    timer_stop(pconn->compression.stats.timer);
+  } else if (NULL != last.output && last.size == size
+             && last.level == pconn->compression.level
+             && 0 == memcmp(last.queue, queue, size)) {
+    pconn->compression.stats.bytes_reused += size;
+    log_compress("COMPRESS: reusing the data sent for %lu bytes",
+                 (unsigned long) size);
+    output = packet_buffer_ref(last.output);
+  } else {
+    if (NULL != last.output) {
+      packet_buffer_unref(last.output);
+    }
+    timer_start(pconn->compression.stats.timer);
+    last.output = compression_output(queue, size,
+                                     pconn->compression.level);
+    timer_stop(pconn->compression.stats.timer);
+
+    if (last.alloc < size) {
+      last.alloc = size;
+      last.queue = fc_realloc(last.queue, last.alloc);
+    }
+    memcpy(last.queue, queue, size);
+    last.size = size;
+    last.level = pconn->compression.level;
+    output = packet_buffer_ref(last.output);
+  }
 
-  compressed_packet_len = compressed_size + (jumbo ? 6 : 2);
-  if (compressed_packet_len < pconn->compression.queue.size) {
-    struct data_out dout;
+  if (NULL != output) {
+    pconn->compression.stats.bytes_in += size;
+    pconn->compression.stats.bytes_out += output->size;
+    log_compress("COMPRESS: %s: %lu bytes sent as %d",
+                 conn_description(pconn), (unsigned long) size,
+                 output->size);
+    connection_send_buffer(pconn, output);
+    packet_buffer_unref(output);
+  }
 
-    log_compress("COMPRESS: compressed %lu bytes to %ld (level %d)",
-                 (unsigned long) pconn->compression.queue.size,
-                 compressed_size, compression_level);
-    stat_size_uncompressed += pconn->compression.queue.size;
-    stat_size_compressed += compressed_size;
+  if (pconn->compression.stream_pending) {
+    /* This was the last flush the other end inflates alone. */
+    pconn->compression.stream_pending = FALSE;
+    conn_compression_start_stream(pconn);
+  }
 
-    if (!jumbo) {
-      unsigned char header[2];
-      FC_STATIC_ASSERT(COMPRESSION_BORDER > MAX_LEN_PACKET,
-                       uncompressed_compressed_packet_len_overlap);
+  return pconn->used;
+}
 
-      log_compress("COMPRESS: sending %ld as normal", compressed_size);
+/****************************************************************************
+  Inflate the 'len' bytes at 'data', the body of a compressed packet.
+  Returns the malloced result, its size in 'result_size', or NULL on
+  error.
+****************************************************************************/
+static void *conn_compression_inflate(struct connection *pconn,
+                                      const unsigned char *data, int len,
+                                      unsigned long *result_size)
+{
+  z_stream *strm = pconn->compression.inflate_stream;
+  unsigned long size;
+  unsigned char *result;
+  int error;
 
-      dio_output_init(&dout, header, sizeof(header));
-      dio_put_uint16(&dout, 2 + compressed_size + COMPRESSION_BORDER);
-      connection_send_data(pconn, header, sizeof(header));
-      connection_send_data(pconn, compressed, compressed_size);
-    } else {
-      unsigned char header[6];
-      FC_STATIC_ASSERT(JUMBO_SIZE >= JUMBO_BORDER+COMPRESSION_BORDER,
-                       compressed_normal_jumbo_packet_len_overlap);
-
-      log_compress("COMPRESS: sending %ld as jumbo", compressed_size);
-      dio_output_init(&dout, header, sizeof(header));
-      dio_put_uint16(&dout, JUMBO_SIZE);
-      dio_put_uint32(&dout, 6 + compressed_size);
-      connection_send_data(pconn, header, sizeof(header));
-      connection_send_data(pconn, compressed, compressed_size);
+  if (NULL == strm) {
+    /* A standalone zlib stream. We don't know the decompressed size. We
+     * assume a bad case here: an expansion by an factor of 100. */
+    size = 100 * len;
+    result = fc_malloc(size);
+    error = uncompress(result, &size, data, len);
+    if (error != Z_OK) {
+      free(result);
+      return NULL;
     }
-  } else {
-    log_compress("COMPRESS: would enlarge %lu bytes to %ld; "
-                 "sending uncompressed",
-                 (unsigned long) pconn->compression.queue.size,
-                 compressed_packet_len);
-    connection_send_data(pconn, pconn->compression.queue.p,
-                         pconn->compression.queue.size);
-    stat_size_no_compression += pconn->compression.queue.size;
+    *result_size = size;
+    return result;
   }
-  return pconn->used;
+
+  /* Part of the stream; it ends with a flush, so all of it comes out
+   * now. */
+  size = 4 * len + MAX_LEN_PACKET;
+  result = fc_malloc(size);
+  strm->next_in = (Bytef *) data;
+  strm->avail_in = len;
+  strm->next_out = result;
+  strm->avail_out = size;
+
+  while (TRUE) {
+    error = inflate(strm, Z_SYNC_FLUSH);
+    if (error != Z_OK && error != Z_BUF_ERROR) {
+      break;
+    }
+    if (0 == strm->avail_in && 0 < strm->avail_out) {
+      *result_size = size - strm->avail_out;
+      strm->next_in = NULL;
+      strm->next_out = NULL;
+      return result;
+    }
+    if (0 < strm->avail_out || size >= MAX_LEN_BUFFER * 100) {
+      /* No progress, or a bomb. */
+      break;
+    }
+    result = fc_realloc(result, 2 * size);
+    strm->next_out = result + size;
+    strm->avail_out = size;
+    size *= 2;
+  }
+
+  free(result);
+  return NULL;
 }
 #endif /* USE_COMPRESSION */
 
+/****************************************************************************
+  Initialize the compression state of a new connection.
+****************************************************************************/
+void conn_compression_init(struct connection *pconn)
+{
+#ifdef USE_COMPRESSION
+  byte_vector_init(&pconn->compression.queue);
+  pconn->compression.frozen_level = 0;
+  pconn->compression.level = get_compression_level();
+  pconn->compression.stream_pending = FALSE;
+  pconn->compression.deflate_stream = NULL;
+  pconn->compression.inflate_stream = NULL;
+  pconn->compression.stats.bytes_in = 0;
+  pconn->compression.stats.bytes_out = 0;
+  pconn->compression.stats.bytes_reused = 0;
+  pconn->compression.stats.timer = timer_new(TIMER_CPU, TIMER_ACTIVE);
+#endif /* USE_COMPRESSION */
+}
+
+/****************************************************************************
+  Free compression queue for given connection, and report how well the
+  compression did.
+****************************************************************************/
+void free_compression_queue(struct connection *pconn)
+{
+#ifdef USE_COMPRESSION
+  if (0 < pconn->compression.stats.bytes_in) {
+    log_verbose("%s: compressed %lu bytes to %lu (%.1f%%) in %.3f seconds"
+                " of CPU time, %lu bytes reused.",
+                pconn->username,
+                pconn->compression.stats.bytes_in,
+                pconn->compression.stats.bytes_out,
+                100.0 * pconn->compression.stats.bytes_out
+                / pconn->compression.stats.bytes_in,
+                timer_read_seconds(pconn->compression.stats.timer),
+                pconn->compression.stats.bytes_reused);
+  }
+
+  if (NULL != pconn->compression.deflate_stream) {
+    deflateEnd(pconn->compression.deflate_stream);
+    free(pconn->compression.deflate_stream);
+    pconn->compression.deflate_stream = NULL;
+  }
+  if (NULL != pconn->compression.inflate_stream) {
+    inflateEnd(pconn->compression.inflate_stream);
+    free(pconn->compression.inflate_stream);
+    pconn->compression.inflate_stream = NULL;
+  }
+  if (NULL != pconn->compression.stats.timer) {
+    timer_destroy(pconn->compression.stats.timer);
+    pconn->compression.stats.timer = NULL;
+  }
+  byte_vector_free(&pconn->compression.queue);
+#endif /* USE_COMPRESSION */
+}
+
+/****************************************************************************
+  Set the zlib compression level (-1 for the default, 0 to 9) of the
+  packets sent to the connection. FREECIV_COMPRESSION_LEVEL gives the
+  initial level of all connections; the server's /netcompress command
+  changes it later.
+****************************************************************************/
+void conn_compression_set_level(struct connection *pconn, int level)
+{
+#ifdef USE_COMPRESSION
+  fc_assert_ret(-1 <= level && 9 >= level);
+  /* A running stream picks this up with its next flush. */
+  pconn->compression.level = level;
+#endif /* USE_COMPRESSION */
+}
+
 /****************************************************************************
   Thaw the connection. Then maybe compress the data waiting to send them
   to the connection. Returns TRUE on success. See also
@@ -189,10 +456,11 @@ bool conn_compression_thaw(struct connection *pconn)
 
 
 /**************************************************************************
-  It returns the request id of the outgoing packet (or 0 if is_server()).
+  Send or queue the packet data for this connection alone. It returns the
+  request id of the outgoing packet (or 0 if is_server()).
 **************************************************************************/
-int send_packet_data(struct connection *pc, unsigned char *data, int len,
-                     enum packet_type packet_type)
+static int send_packet_data_real(struct connection *pc, unsigned char *data,
+                                 int len, enum packet_type packet_type)
 {
   /* default for the server */
   int result = 0;
@@ -215,8 +483,6 @@ int send_packet_data(struct connection *pc, unsigned char *data, int len,
 
 #ifdef USE_COMPRESSION
   if (TRUE) {
-    int size = len;
-
     if (conn_compression_frozen(pc)) {
       size_t old_size;
 
@@ -247,16 +513,9 @@ int send_packet_data(struct connection *pc, unsigned char *data, int len,
       log_compress2("COMPRESS: putting %s into the queue",
                     packet_name(packet_type));
     } else {
-      stat_size_alone += size;
-      log_compress("COMPRESS: sending %s alone (%d bytes total)",
-                   packet_name(packet_type), stat_size_alone);
+      log_compress("COMPRESS: sending %s alone", packet_name(packet_type));
       connection_send_data(pc, data, len);
     }
-
-    log_compress2("COMPRESS: STATS: alone=%d compression-expand=%d "
-                  "compression (before/after) = %d/%d",
-                  stat_size_alone, stat_size_no_compression,
-                  stat_size_uncompressed, stat_size_compressed);
   }
 #else  /* USE_COMPRESSION */
   connection_send_data(pc, data, len);
@@ -347,6 +606,31 @@ int send_packet_data(struct connection *pc, unsigned char *data, int len,
   return result;
 }
 
+/**************************************************************************
+  It returns the request id of the outgoing packet (or 0 if is_server()).
+  A packet delta-encoded against the state the connection shares with
+  others is sent to all of them.
+**************************************************************************/
+int send_packet_data(struct connection *pc, unsigned char *data, int len,
+                     enum packet_type packet_type)
+{
+  int result = 0;
+
+  if (!conn_delta_group_shares(pc, packet_type)) {
+    return send_packet_data_real(pc, data, len, packet_type);
+  }
+
+  conn_list_iterate(conn_delta_group_members(pc), pmember) {
+    if (pmember == pc) {
+      result = send_packet_data_real(pc, data, len, packet_type);
+    } else {
+      (void) send_packet_data_real(pmember, data, len, packet_type);
+    }
+  } conn_list_iterate_end;
+
+  return result;
+}
+
 /**************************************************************************
   Read and return a packet from the connection 'pc'. The type of the
   packet is written in 'ptype'. On error, the connection is closed and
@@ -422,20 +706,14 @@ void *get_packet_from_connection(struct connection *pc,
 
   if (compressed_packet) {
     uLong compressed_size = whole_packet_len - header_size;
-    /* 
-     * We don't know the decompressed size. We assume a bad case
-     * here: an expansion by an factor of 100. 
-     */
-    unsigned long int decompressed_size = 100 * compressed_size;
-    void *decompressed = fc_malloc(decompressed_size);
-    int error;
+    unsigned long int decompressed_size;
+    void *decompressed;
     struct socket_packet_buffer *buffer = pc->buffer;
-    
-    error =
-	uncompress(decompressed, &decompressed_size,
-		   ADD_TO_POINTER(buffer->data, header_size), 
-		   compressed_size);
-    if (error != Z_OK) {
+
+    decompressed = conn_compression_inflate(pc, buffer->data + header_size,
+                                            compressed_size,
+                                            &decompressed_size);
+    if (NULL == decompressed) {
       log_verbose("Uncompressing of the packet stream failed. "
                   "The connection will be closed now.");
       connection_close(pc, _("decoding error"));
@@ -605,6 +883,19 @@ void post_send_packet_server_join_reply(struct connection *pconn,
 {
   if (packet->you_can_join) {
     packet_header_set(&pconn->packet_header);
+
+#ifdef USE_COMPRESSION
+    if (has_capability(STREAM_CAPABILITY, packet->capability)
+        && has_capability(STREAM_CAPABILITY, pconn->capability)) {
+      if (conn_compression_frozen(pconn)) {
+        /* The reply is still queued; the other end inflates the queue
+         * alone before it reads the reply. */
+        pconn->compression.stream_pending = TRUE;
+      } else {
+        conn_compression_start_stream(pconn);
+      }
+    }
+#endif /* USE_COMPRESSION */
   }
 }
 
@@ -617,6 +908,20 @@ void post_receive_packet_server_join_reply(struct connection *pconn,
 {
   if (packet->you_can_join) {
     packet_header_set(&pconn->packet_header);
+
+#ifdef USE_COMPRESSION
+    if (has_capability(STREAM_CAPABILITY, packet->capability)
+        && has_capability(STREAM_CAPABILITY, our_capability)) {
+      z_stream *strm = fc_calloc(1, sizeof(*strm));
+
+      if (Z_OK != inflateInit(strm)) {
+        free(strm);
+        connection_close(pconn, _("decoding error"));
+        return;
+      }
+      pconn->compression.inflate_stream = strm;
+    }
+#endif /* USE_COMPRESSION */
   }
 }
 
@@ -25,6 +25,7 @@
 
 /* common */
 #include "city.h"
+#include "effects.h"
 #include "fc_interface.h"
 #include "featured_text.h"
 #include "game.h"
@@ -466,6 +467,7 @@ struct player *player_new(struct player_slot *pslot)
   pplayer = fc_calloc(1, sizeof(*pplayer));
   pplayer->slot = pslot;
   pslot->player = pplayer;
+  pplayer->effect_cache = effect_cache_new();
 
   pplayer->diplstates = fc_calloc(player_slot_count(),
                                   sizeof(*pplayer->diplstates));
@@ -696,6 +698,7 @@ void player_destroy(struct player *pplayer)
   }
 
   dbv_free(&pplayer->tile_known);
+  effect_cache_destroy(pplayer->effect_cache);
 
   free(pplayer);
   pslot->player = NULL;
@@ -759,6 +762,7 @@ bool player_set_nation(struct player *pplayer, struct nation_type *pnation)
       pnation->player = pplayer;
     }
     pplayer->nation = pnation;
+    effect_cache_invalidate();
     return TRUE;
   }
   return FALSE;
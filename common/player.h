@@ -249,6 +249,8 @@ struct player {
 
   struct rgbcolor *rgb;
 
+  struct effect_cache *effect_cache; /* see effects.c */
+
   union {
     struct {
       /* Only used in the server (./ai/ and ./server/). */
@@ -257,6 +259,9 @@ struct player {
       bool capital; /* used to give player init_buildings in first city. */
 
       struct player_tile *private_map;
+      /* Seen counts of the tiles, indexed like 'private_map'. */
+      v_radius_t *seen_count;
+      v_radius_t *own_seen;
 
       bv_player really_gives_vision; /* takes into account that p3 may see
                                       * what p1 has via p2 */
@@ -283,7 +288,7 @@ struct player {
       /* Only used at the client (the server is omniscient; ./client/). */
 
       /* Corresponds to the result of
-         (player:server:private_map[tile_index]:seen_count[vlayer] != 0). */
+         (player:server:seen_count[tile_index][vlayer] != 0). */
       struct dbv tile_vision[V_COUNT];
     } client;
   };
@@ -1958,6 +1958,73 @@ bool is_req_unchanging(const struct requirement *req)
   return TRUE;
 }
 
+/****************************************************************************
+  Return the REQ_TARGET_* targets without which is_req_active() can't
+  be certain that the requirement is active (or, if 'active' is FALSE,
+  that it is inactive). When one of them is missing, the answer is
+  "maybe" at best.
+
+  This only lists the targets is_req_active() is known to check for
+  NULL; it is fine to return too few of them, never too many.
+*****************************************************************************/
+int req_needed_targets(const struct requirement *req, bool active)
+{
+  switch (req->source.kind) {
+  case VUT_GOVERNMENT:
+  case VUT_AI_LEVEL:
+    return REQ_TARGET_PLAYER;
+  case VUT_ADVANCE:
+  case VUT_TECHFLAG:
+  case VUT_NATION:
+    if (req->range == REQ_RANGE_PLAYER || req->range == REQ_RANGE_ALLIANCE) {
+      return REQ_TARGET_PLAYER;
+    }
+    return 0;
+  case VUT_ACHIEVEMENT:
+    return req->range == REQ_RANGE_WORLD ? 0 : REQ_TARGET_PLAYER;
+  case VUT_IMPROVEMENT:
+    if (req->range == REQ_RANGE_PLAYER) {
+      return REQ_TARGET_PLAYER;
+    } else if (req->range == REQ_RANGE_CITY) {
+      return REQ_TARGET_CITY;
+    }
+    return 0;
+  case VUT_MINSIZE:
+    return REQ_TARGET_CITY;
+  case VUT_NATIONALITY:
+    return req->range == REQ_RANGE_CITY ? REQ_TARGET_CITY : 0;
+  case VUT_TERRAINALTER:
+  case VUT_CITYTILE:
+    return REQ_TARGET_TILE;
+  case VUT_UTYPE:
+  case VUT_UCLASS:
+  case VUT_UCFLAG:
+    return REQ_TARGET_UNITTYPE;
+  case VUT_UTFLAG:
+    return req->range == REQ_RANGE_LOCAL ? REQ_TARGET_UNITTYPE : 0;
+  case VUT_OTYPE:
+    /* A missing output type is certainly not the required one. */
+    return req->present == active ? REQ_TARGET_OUTPUT : 0;
+  case VUT_SPECIALIST:
+    return req->present == active ? REQ_TARGET_SPECIALIST : 0;
+  case VUT_NONE:
+  case VUT_EXTRA:
+  case VUT_TERRAIN:
+  case VUT_TERRFLAG:
+  case VUT_RESOURCE:
+  case VUT_DIPLREL:
+  case VUT_MAXTILEUNITS:
+  case VUT_TERRAINCLASS:
+  case VUT_BASEFLAG:
+  case VUT_ROADFLAG:
+  case VUT_MINYEAR:
+  case VUT_COUNT:
+    break;
+  }
+
+  return 0;
+}
+
 /****************************************************************************
   Return TRUE iff the two sources are equivalent.  Note this isn't the
   same as an == or memcmp check.
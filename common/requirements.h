@@ -113,6 +113,16 @@ bool are_reqs_active(const struct player *target_player,
 
 bool is_req_unchanging(const struct requirement *req);
 
+/* Targets given to is_req_active(), see req_needed_targets(). */
+#define REQ_TARGET_PLAYER     (1 << 0)
+#define REQ_TARGET_CITY       (1 << 1)
+#define REQ_TARGET_TILE       (1 << 2)
+#define REQ_TARGET_UNITTYPE   (1 << 3)
+#define REQ_TARGET_OUTPUT     (1 << 4)
+#define REQ_TARGET_SPECIALIST (1 << 5)
+
+int req_needed_targets(const struct requirement *req, bool active);
+
 /* General universal functions. */
 int universal_number(const struct universal *source);
 
@@ -105,11 +105,13 @@ static luaL_Reg luascript_lualibs[] = {
 #endif /* LUA_VERSION_NUM */
  
 static int luascript_report(struct fc_lua *fcl, int status, const char *code);
-static void luascript_traceback_func_save(lua_State *L);
-static void luascript_traceback_func_push(lua_State *L);
+static void luascript_traceback_func_save(struct fc_lua *fcl);
+static void luascript_traceback_func_push(struct fc_lua *fcl);
 static void luascript_exec_check(lua_State *L, lua_Debug *ar);
-static void luascript_hook_start(lua_State *L);
-static void luascript_hook_end(lua_State *L);
+static void *luascript_alloc(void *ud, void *ptr, size_t osize,
+                             size_t nsize);
+static void luascript_hook_start(struct fc_lua *fcl);
+static void luascript_hook_end(struct fc_lua *fcl);
 static void luascript_openlibs(lua_State *L, const luaL_Reg *llib);
 static void luascript_blacklist(lua_State *L, const char *lsymbols[]);
 
@@ -186,63 +188,92 @@ static int luascript_report(struct fc_lua *fcl, int status, const char *code)
 }
 
 /*****************************************************************************
-  Find the debug.traceback function and store in the registry
+  Find the debug.traceback function and keep a reference to it in the
+  registry
 *****************************************************************************/
-static void luascript_traceback_func_save(lua_State *L)
+static void luascript_traceback_func_save(struct fc_lua *fcl)
 {
+  lua_State *L = fcl->state;
+
   /* Find the debug.traceback function, if available */
+  fcl->traceback_ref = LUA_NOREF;
   lua_getglobal(L, "debug");
   if (lua_istable(L, -1)) {
     lua_getfield(L, -1, "traceback");
-    lua_setfield(L, LUA_REGISTRYINDEX, "freeciv_traceback");
+    fcl->traceback_ref = luaL_ref(L, LUA_REGISTRYINDEX);
   }
   lua_pop(L, 1);       /* pop debug */
 }
 
 /*****************************************************************************
-  Push the traceback function to the stack
+  Push the traceback function to the stack (nil if there is none)
 *****************************************************************************/
-static void luascript_traceback_func_push(lua_State *L)
+static void luascript_traceback_func_push(struct fc_lua *fcl)
 {
-  lua_getfield(L, LUA_REGISTRYINDEX, "freeciv_traceback");
+  lua_rawgeti(fcl->state, LUA_REGISTRYINDEX, fcl->traceback_ref);
 }
 
 /*****************************************************************************
-  Check currently excecuting lua function for execution time limit
+  Check currently excecuting lua function for execution time limit.
+
+  The clock is read at the first check rather than when the execution
+  starts, so that the many short calls (e.g. signal callbacks) don't pay
+  for it; this only shifts the limit by LUASCRIPT_CHECKINTERVAL
+  instructions.
 *****************************************************************************/
 static void luascript_exec_check(lua_State *L, lua_Debug *ar)
 {
-  lua_Number exec_clock;
+  struct fc_lua *fcl = luascript_get_fcl(L);
 
-  lua_getfield(L, LUA_REGISTRYINDEX, "freeciv_exec_clock");
-  exec_clock = lua_tonumber(L, -1);
-  lua_pop(L, 1);
-  if ((float)(clock() - exec_clock)/CLOCKS_PER_SEC
-      > LUASCRIPT_MAX_EXECUTION_TIME_SEC) {
+  fc_assert_ret(fcl != NULL);
+
+  if (!fcl->exec_clock_set) {
+    fcl->exec_clock = clock();
+    fcl->exec_clock_set = TRUE;
+  } else if ((float)(clock() - fcl->exec_clock)/CLOCKS_PER_SEC
+             > LUASCRIPT_MAX_EXECUTION_TIME_SEC) {
     luaL_error(L, "Execution time limit exceeded in script");
   }
 }
 
+/*****************************************************************************
+  Memory allocation function of the lua state. Counts the allocated bytes
+  for the profiling, and passes the request on to the original allocator.
+*****************************************************************************/
+static void *luascript_alloc(void *ud, void *ptr, size_t osize,
+                             size_t nsize)
+{
+  struct fc_lua *fcl = ud;
+
+  /* For a new block, 'osize' is the type of the object, not its size. */
+  if (NULL == ptr) {
+    fcl->alloc_bytes += nsize;
+  } else if (nsize > osize) {
+    fcl->alloc_bytes += nsize - osize;
+  }
+
+  return fcl->alloc_func(fcl->alloc_ud, ptr, osize, nsize);
+}
+
 /*****************************************************************************
   Setup function execution guard
 *****************************************************************************/
-static void luascript_hook_start(lua_State *L)
+static void luascript_hook_start(struct fc_lua *fcl)
 {
 #if LUASCRIPT_CHECKINTERVAL
-  /* Store clock timestamp in the registry */
-  lua_pushnumber(L, clock());
-  lua_setfield(L, LUA_REGISTRYINDEX, "freeciv_exec_clock");
-  lua_sethook(L, luascript_exec_check, LUA_MASKCOUNT, LUASCRIPT_CHECKINTERVAL);
+  fcl->exec_clock_set = FALSE;
+  lua_sethook(fcl->state, luascript_exec_check, LUA_MASKCOUNT,
+              LUASCRIPT_CHECKINTERVAL);
 #endif
 }
 
 /*****************************************************************************
   Clear function execution guard
 *****************************************************************************/
-static void luascript_hook_end(lua_State *L)
+static void luascript_hook_end(struct fc_lua *fcl)
 {
 #if LUASCRIPT_CHECKINTERVAL
-  lua_sethook(L, luascript_exec_check, 0, 0);
+  lua_sethook(fcl->state, luascript_exec_check, 0, 0);
 #endif
 }
 
@@ -334,8 +365,11 @@ struct fc_lua *luascript_new(luascript_log_func_t output_fct)
   fcl->output_fct = output_fct;
   fcl->caller = NULL;
 
+  fcl->alloc_func = lua_getallocf(fcl->state, &fcl->alloc_ud);
+  lua_setallocf(fcl->state, luascript_alloc, fcl);
+
   luascript_openlibs(fcl->state, luascript_lualibs);
-  luascript_traceback_func_save(fcl->state);
+  luascript_traceback_func_save(fcl);
   luascript_blacklist(fcl->state, luascript_unsafe_symbols);
 
   /* Save the freeciv lua struct in the lua state. */
@@ -413,6 +447,12 @@ void luascript_log_vargs(struct fc_lua *fcl, enum log_level level,
   fc_assert_ret(fcl);
   fc_assert_ret(0 <= level && level <= LOG_DEBUG);
 
+  if (!fcl->output_fct && !log_do_output_for_level(level)) {
+    /* Don't format messages nobody will see, e.g. the debug message
+     * of every callback invocation. */
+    return;
+  }
+
   fc_vsnprintf(buf, sizeof(buf), format, args);
 
   if (fcl->output_fct) {
@@ -521,7 +561,7 @@ int luascript_call(struct fc_lua *fcl, int narg, int nret, const char *code)
   base = lua_gettop(fcl->state) - narg;
 
   /* Find the traceback function, if available */
-  luascript_traceback_func_push(fcl->state);
+  luascript_traceback_func_push(fcl);
   if (lua_isfunction(fcl->state, -1)) {
     lua_insert(fcl->state, base);  /* insert traceback before function */
     traceback = base;
@@ -529,9 +569,9 @@ int luascript_call(struct fc_lua *fcl, int narg, int nret, const char *code)
     lua_pop(fcl->state, 1);   /* pop non-function traceback */
   }
 
-  luascript_hook_start(fcl->state);
+  luascript_hook_start(fcl);
   status = lua_pcall(fcl->state, narg, nret, traceback);
-  luascript_hook_end(fcl->state);
+  luascript_hook_end(fcl);
 
   if (status) {
     luascript_report(fcl, status, code);
@@ -52,6 +52,22 @@ struct fc_lua {
 
   struct luascript_signal_hash *signals;
   struct luascript_signal_name_list *signal_names;
+
+  /* Registry reference of debug.traceback. */
+  int traceback_ref;
+
+  /* Start of the current execution, see luascript_exec_check(). */
+  bool exec_clock_set;
+  lua_Number exec_clock;
+
+  /* Allocator of the lua state; luascript_alloc() wraps it. */
+  lua_Alloc alloc_func;
+  void *alloc_ud;
+  size_t alloc_bytes;           /* Bytes allocated so far. */
+
+  /* Profiling of the signal callbacks, see luascript_signal.c. */
+  bool profiling;
+  int profile_budget;           /* msec per callback and turn, 0 for none */
 };
 
 /* Error functions for lua scripts. */
@@ -35,6 +35,14 @@
     return false
 
   If the value is 'true' the current signal emission will be stopped.
+
+  Callbacks are looked up by name each time they are invoked, so a script
+  may connect a function before defining it, or redefine it later on.
+
+  While fcl->profiling is set, the emissions of each signal and the calls
+  of each callback are counted, together with the wall and CPU time and
+  the bytes allocated by Lua meanwhile. The times of a signal include its
+  callbacks; those of a callback include the signals it emits.
 *****************************************************************************/
 
 #ifdef HAVE_CONFIG_H
@@ -44,7 +52,9 @@
 #include <stdarg.h>
 
 /* utility */
+#include "astring.h"
 #include "log.h"
+#include "timing.h"
 
 /* common/scriptcore */
 #include "luascript.h"
@@ -54,6 +64,7 @@
 
 struct signal;
 struct signal_callback;
+struct signal_profile;
 
 /* get 'struct signal_callback_list' and related functions: */
 #define SPECLIST_TAG signal_callback
@@ -69,17 +80,37 @@ static struct signal_callback *signal_callback_new(const char *name);
 static void signal_callback_destroy(struct signal_callback *pcallback);
 static struct signal *signal_new(int nargs, enum api_types *parg_types);
 static void signal_destroy(struct signal *psignal);
+static void signal_profile_begin(struct fc_lua *fcl,
+                                 struct signal_profile *profile);
+static void signal_profile_end(struct fc_lua *fcl,
+                               struct signal_profile *profile);
+static void signal_profile_clear(struct signal_profile *profile);
+static void signal_profile_free(struct signal_profile *profile);
+
+/* Profiling data of a signal or callback. */
+struct signal_profile {
+  int calls;
+  int depth;                    /* number of calls running */
+  struct timer *wall;           /* NULL until first profiled */
+  struct timer *cpu;
+  size_t alloc_bytes;
+  size_t alloc_start;           /* fcl->alloc_bytes when depth became 1 */
+  double turn_start;            /* 'wall' at the start of the turn */
+};
 
 /* Signal datastructure. */
 struct signal {
   int nargs;                              /* number of arguments to pass */
   enum api_types *arg_types;              /* argument types */
   struct signal_callback_list *callbacks; /* connected callbacks */
+  struct signal_profile profile;
 };
 
 /* Signal callback datastructure. */
 struct signal_callback {
   char *name;                             /* callback function name */
+  struct signal_profile profile;
+  bool disconnected;                      /* see signal_callback_destroy() */
 };
 
 /*****************************************************************************
@@ -99,6 +130,10 @@ struct signal_callback {
   TYPED_HASH_ITERATE(char *, struct signal *, phash, key, data)
 #define signal_hash_iterate_end                                              \
   HASH_ITERATE_END
+#define signal_hash_data_iterate(phash, data)                                \
+  TYPED_HASH_DATA_ITERATE(struct signal *, phash, data)
+#define signal_hash_data_iterate_end                                         \
+  HASH_DATA_ITERATE_END
 
 /* get 'struct luascript_signal_name_list' and related functions: */
 #define SPECLIST_TAG luascript_signal_name
@@ -106,7 +141,7 @@ struct signal_callback {
 #include "speclist.h"
 
 #define luascript_signal_name_list_iterate(list, pname)                      \
-  TYPED_LIST_ITERATE(struct signal_callback, list, pcallback)
+  TYPED_LIST_ITERATE(char, list, pname)
 #define luascript_signal_name_list_iterate_end                               \
   LIST_ITERATE_END
 
@@ -115,7 +150,7 @@ struct signal_callback {
 *****************************************************************************/
 static struct signal_callback *signal_callback_new(const char *name)
 {
-  struct signal_callback *pcallback = fc_malloc(sizeof(*pcallback));
+  struct signal_callback *pcallback = fc_calloc(1, sizeof(*pcallback));
 
   pcallback->name = fc_strdup(name);
   return pcallback;
@@ -126,6 +161,14 @@ static struct signal_callback *signal_callback_new(const char *name)
 *****************************************************************************/
 static void signal_callback_destroy(struct signal_callback *pcallback)
 {
+  if (0 < pcallback->profile.depth) {
+    /* It disconnected itself while being profiled; it is freed in
+     * luascript_signal_emit_valist() when the call is over. */
+    pcallback->disconnected = TRUE;
+    return;
+  }
+
+  signal_profile_free(&pcallback->profile);
   free(pcallback->name);
   free(pcallback);
 }
@@ -135,7 +178,7 @@ static void signal_callback_destroy(struct signal_callback *pcallback)
 *****************************************************************************/
 static struct signal *signal_new(int nargs, enum api_types *parg_types)
 {
-  struct signal *psignal = fc_malloc(sizeof(*psignal));
+  struct signal *psignal = fc_calloc(1, sizeof(*psignal));
 
   psignal->nargs = nargs;
   psignal->arg_types = parg_types;
@@ -153,9 +196,73 @@ static void signal_destroy(struct signal *psignal)
     free(psignal->arg_types);
   }
   signal_callback_list_destroy(psignal->callbacks);
+  signal_profile_free(&psignal->profile);
   free(psignal);
 }
 
+/*****************************************************************************
+  Start measuring a call of a signal or callback.
+*****************************************************************************/
+static void signal_profile_begin(struct fc_lua *fcl,
+                                 struct signal_profile *profile)
+{
+  if (0 < profile->depth++) {
+    /* Recursive call; the outer one is measured. */
+    return;
+  }
+
+  if (NULL == profile->wall) {
+    profile->wall = timer_new(TIMER_USER, TIMER_ACTIVE);
+    profile->cpu = timer_new(TIMER_CPU, TIMER_ACTIVE);
+  }
+  profile->alloc_start = fcl->alloc_bytes;
+  timer_start(profile->wall);
+  timer_start(profile->cpu);
+}
+
+/*****************************************************************************
+  Finish measuring a call of a signal or callback.
+*****************************************************************************/
+static void signal_profile_end(struct fc_lua *fcl,
+                               struct signal_profile *profile)
+{
+  profile->calls++;
+  if (0 < --profile->depth) {
+    return;
+  }
+
+  timer_stop(profile->cpu);
+  timer_stop(profile->wall);
+  profile->alloc_bytes += fcl->alloc_bytes - profile->alloc_start;
+}
+
+/*****************************************************************************
+  Forget the profiling data collected so far.
+*****************************************************************************/
+static void signal_profile_clear(struct signal_profile *profile)
+{
+  profile->calls = 0;
+  profile->alloc_bytes = 0;
+  profile->turn_start = 0.0;
+  if (NULL != profile->wall) {
+    timer_clear(profile->wall);
+    timer_clear(profile->cpu);
+  }
+}
+
+/*****************************************************************************
+  Free the profiling data.
+*****************************************************************************/
+static void signal_profile_free(struct signal_profile *profile)
+{
+  if (NULL != profile->wall) {
+    timer_destroy(profile->wall);
+    timer_destroy(profile->cpu);
+    profile->wall = NULL;
+    profile->cpu = NULL;
+  }
+}
+
 /*****************************************************************************
   Invoke all the callback functions attached to a given signal.
 *****************************************************************************/
@@ -172,6 +279,27 @@ void luascript_signal_emit_valist(struct fc_lua *fcl, const char *signal_name,
       luascript_log(fcl, LOG_ERROR, "Signal \"%s\" requires %d args but was "
                                     "passed %d on invoke.", signal_name,
                     psignal->nargs, nargs);
+    } else if (fcl->profiling) {
+      bool stop = FALSE;
+
+      signal_profile_begin(fcl, &psignal->profile);
+      signal_callback_list_iterate(psignal->callbacks, pcallback) {
+        va_list args_cb;
+
+        va_copy(args_cb, args);
+        signal_profile_begin(fcl, &pcallback->profile);
+        stop = luascript_callback_invoke(fcl, pcallback->name, nargs,
+                                         psignal->arg_types, args_cb);
+        signal_profile_end(fcl, &pcallback->profile);
+        va_end(args_cb);
+        if (pcallback->disconnected && 0 == pcallback->profile.depth) {
+          signal_callback_destroy(pcallback);
+        }
+        if (stop) {
+          break;
+        }
+      } signal_callback_list_iterate_end;
+      signal_profile_end(fcl, &psignal->profile);
     } else {
       signal_callback_list_iterate(psignal->callbacks, pcallback) {
         va_list args_cb;
@@ -382,3 +510,100 @@ const char *luascript_signal_callback_by_index(struct fc_lua *fcl,
 
   return NULL;
 }
+
+/*****************************************************************************
+  Forget the profiling data of all signals and callbacks.
+*****************************************************************************/
+void luascript_signal_profile_reset(struct fc_lua *fcl)
+{
+  fc_assert_ret(fcl != NULL);
+  fc_assert_ret(fcl->signals != NULL);
+
+  signal_hash_data_iterate(fcl->signals, psignal) {
+    signal_profile_clear(&psignal->profile);
+    signal_callback_list_iterate(psignal->callbacks, pcallback) {
+      signal_profile_clear(&pcallback->profile);
+    } signal_callback_list_iterate_end;
+  } signal_hash_data_iterate_end;
+}
+
+/*****************************************************************************
+  Called at the end of each turn while profiling. Logs the callbacks
+  which took more than fcl->profile_budget milliseconds this turn.
+*****************************************************************************/
+void luascript_signal_profile_turn(struct fc_lua *fcl)
+{
+  fc_assert_ret(fcl != NULL);
+  fc_assert_ret(fcl->signals != NULL);
+
+  if (!fcl->profiling) {
+    return;
+  }
+
+  signal_hash_iterate(fcl->signals, name, psignal) {
+    signal_callback_list_iterate(psignal->callbacks, pcallback) {
+      struct signal_profile *profile = &pcallback->profile;
+      double total, msec;
+
+      if (NULL == profile->wall) {
+        continue;
+      }
+
+      total = timer_read_seconds(profile->wall);
+      msec = 1000.0 * (total - profile->turn_start);
+      if (0 < fcl->profile_budget && msec > fcl->profile_budget) {
+        luascript_log(fcl, LOG_NORMAL, "Callback \"%s\" of signal \"%s\" "
+                                       "took %.1f ms this turn (budget: "
+                                       "%d ms).", pcallback->name, name,
+                      msec, fcl->profile_budget);
+      }
+      profile->turn_start = total;
+    } signal_callback_list_iterate_end;
+  } signal_hash_iterate_end;
+}
+
+/*****************************************************************************
+  Append a line for the profiling data to the report.
+*****************************************************************************/
+static void signal_profile_report_line(struct astring *report,
+                                       const char *indent, const char *name,
+                                       const struct signal_profile *profile)
+{
+  astr_add_line(report, "%s%-*s %8d %10.2f %10.2f %10.1f", indent,
+                (int) (32 - strlen(indent)), name, profile->calls,
+                1000.0 * timer_read_seconds(profile->wall),
+                1000.0 * timer_read_seconds(profile->cpu),
+                profile->alloc_bytes / 1024.0);
+}
+
+/*****************************************************************************
+  Write the profiling data of the signals and callbacks which have been
+  called to 'report', one line each.
+*****************************************************************************/
+void luascript_signal_profile_report(struct fc_lua *fcl,
+                                     struct astring *report)
+{
+  fc_assert_ret(fcl != NULL);
+  fc_assert_ret(fcl->signals != NULL);
+
+  astr_add_line(report, "%-32s %8s %10s %10s %10s", "signal / callback",
+                "calls", "wall ms", "cpu ms", "alloc kB");
+
+  /* In the order the signals were created. */
+  luascript_signal_name_list_iterate(fcl->signal_names, signal_name) {
+    struct signal *psignal;
+
+    if (!luascript_signal_hash_lookup(fcl->signals, signal_name, &psignal)
+        || 0 == psignal->profile.calls) {
+      continue;
+    }
+
+    signal_profile_report_line(report, "", signal_name, &psignal->profile);
+    signal_callback_list_iterate(psignal->callbacks, pcallback) {
+      if (0 < pcallback->profile.calls) {
+        signal_profile_report_line(report, "  ", pcallback->name,
+                                   &pcallback->profile);
+      }
+    } signal_callback_list_iterate_end;
+  } luascript_signal_name_list_iterate_end;
+}
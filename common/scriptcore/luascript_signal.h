@@ -20,6 +20,7 @@ extern "C" {
 /* utility */
 #include "support.h"
 
+struct astring;
 struct fc_lua;
 
 void luascript_signal_init(struct fc_lua *fcl);
@@ -45,6 +46,11 @@ const char *luascript_signal_callback_by_index(struct fc_lua *fcl,
                                                const char *signal_name,
                                                int index);
 
+void luascript_signal_profile_reset(struct fc_lua *fcl);
+void luascript_signal_profile_turn(struct fc_lua *fcl);
+void luascript_signal_profile_report(struct fc_lua *fcl,
+                                     struct astring *report);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -29,6 +29,7 @@
 #include "support.h"
 
 /* common */
+#include "city.h"
 #include "research.h"
 
 
@@ -152,6 +153,7 @@ enum tech_state player_invention_set(struct player *pplayer,
     return old;
   }
   research->inventions[tech].state = value;
+  city_refresh_generation_bump();
 
   if (value == TECH_KNOWN) {
     game.info.global_advances[tech] = TRUE;
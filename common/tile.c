@@ -22,6 +22,7 @@
 
 /* common */
 #include "fc_interface.h"
+#include "city.h"
 #include "game.h"
 #include "movement.h"
 #include "road.h"
@@ -30,6 +31,19 @@
 
 #include "tile.h"
 
+static unsigned int tile_move_cost_gen = 1;
+
+/****************************************************************************
+  Return whether the tile is one of the map, not a virtual tile.
+****************************************************************************/
+static bool tile_is_on_map(const struct tile *ptile)
+{
+  int tindex = tile_index(ptile);
+
+  return (0 <= tindex && tindex < map_num_tiles()
+          && ptile == map.tiles + tindex);
+}
+
 #ifndef tile_index
 /****************************************************************************
   Return the tile index.
@@ -67,6 +81,9 @@ void tile_set_owner(struct tile *ptile, struct player *pplayer,
                     struct tile *claimer)
 {
   if (BORDERS_DISABLED != game.info.borders) {
+    if (ptile->owner != pplayer) {
+      city_refresh_generation_bump();
+    }
     ptile->owner = pplayer;
     ptile->extras_owner = pplayer;
     ptile->claimer = claimer;
@@ -137,6 +154,12 @@ void tile_set_terrain(struct tile *ptile, struct terrain *pterrain)
                 terrain_number(pterrain), city_name(tile_city(ptile)),
                 tile_city(ptile)->id);
 
+  if (ptile->terrain != pterrain) {
+    city_refresh_generation_bump();
+    if (tile_is_on_map(ptile)) {
+      tile_move_cost_generation_bump();
+    }
+  }
   ptile->terrain = pterrain;
   if (NULL != pterrain
       && NULL != ptile->resource
@@ -366,6 +389,9 @@ const struct resource *tile_resource(const struct tile *ptile)
 ****************************************************************************/
 void tile_set_resource(struct tile *ptile, struct resource *presource)
 {
+  if (ptile->resource != presource) {
+    city_refresh_generation_bump();
+  }
   ptile->resource = presource;
   if (NULL != ptile->terrain
    && NULL != presource
@@ -404,6 +430,9 @@ Continent_id tile_continent(const struct tile *ptile)
 ****************************************************************************/
 void tile_set_continent(struct tile *ptile, Continent_id val)
 {
+  if (ptile->continent != val) {
+    city_refresh_generation_bump();
+  }
   ptile->continent = val;
 }
 
@@ -916,6 +945,10 @@ bool tile_has_cause_extra(const struct tile *ptile, enum extra_cause cause)
 void tile_add_extra(struct tile *ptile, const struct extra_type *pextra)
 {
   if (pextra != NULL) {
+    city_refresh_generation_bump();
+    if (is_extra_caused_by(pextra, EC_ROAD) && tile_is_on_map(ptile)) {
+      tile_move_cost_generation_bump();
+    }
     BV_SET(ptile->extras, extra_index(pextra));
   }
 }
@@ -926,10 +959,32 @@ void tile_add_extra(struct tile *ptile, const struct extra_type *pextra)
 void tile_remove_extra(struct tile *ptile, const struct extra_type *pextra)
 {
   if (pextra != NULL) {
+    city_refresh_generation_bump();
+    if (is_extra_caused_by(pextra, EC_ROAD) && tile_is_on_map(ptile)) {
+      tile_move_cost_generation_bump();
+    }
     BV_CLR(ptile->extras, extra_index(pextra));
   }
 }
 
+/****************************************************************************
+  Return a number which changes whenever the move costs between the tiles
+  of the map may have changed: the terrain or the roads of a tile, or the
+  ruleset. Virtual tiles don't count.
+****************************************************************************/
+unsigned int tile_move_cost_generation(void)
+{
+  return tile_move_cost_gen;
+}
+
+/****************************************************************************
+  Note a change of the move costs, see tile_move_cost_generation().
+****************************************************************************/
+void tile_move_cost_generation_bump(void)
+{
+  tile_move_cost_gen++;
+}
+
 /****************************************************************************
   Returns a virtual tile. If ptile is given, the properties of this tile are
   copied, else it is completely blank (except for the unit list
@@ -151,6 +151,9 @@ bool tile_has_cause_extra(const struct tile *ptile, enum extra_cause cause);
 void tile_add_extra(struct tile *ptile, const struct extra_type *pextra);
 void tile_remove_extra(struct tile *ptile, const struct extra_type *pextra);
 
+unsigned int tile_move_cost_generation(void);
+void tile_move_cost_generation_bump(void);
+
 /* Vision related */
 enum known_type tile_get_known(const struct tile *ptile,
 			      const struct player *pplayer);
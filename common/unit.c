@@ -1567,6 +1567,9 @@ struct tile *unit_tile(const struct unit *punit)
 void unit_tile_set(struct unit *punit, struct tile *ptile)
 {
   fc_assert_ret(NULL != punit);
+  if (punit->tile != ptile) {
+    city_refresh_generation_bump();
+  }
   punit->tile = ptile;
 }
 
@@ -797,6 +797,7 @@ void adv_best_government(struct player *pplayer)
         continue; /* we have better governments available */
       }
       pplayer->government = gov;
+      city_refresh_generation_bump();
       /* Ideally we should change tax rates here, but since
        * this is a rather big CPU operation, we'd rather not. */
       check_player_max_rates(pplayer);
@@ -838,6 +839,7 @@ void adv_best_government(struct player *pplayer)
     } governments_iterate_end;
     /* Now reset our gov to it's real state. */
     pplayer->government = current_gov;
+    city_refresh_generation_bump();
     city_list_iterate(pplayer->cities, acity) {
       auto_arrange_workers(acity);
     } city_list_iterate_end;
@@ -865,7 +865,8 @@ void auto_settler_setup_work(struct player *pplayer, struct unit *punit,
       pft_fill_unit_parameter(&parameter, punit);
       parameter.omniscience = !has_handicap(pplayer, H_MAP);
       parameter.can_invade_tile = autosettler_enter_territory;
-      pfm = pf_map_new(&parameter);
+      pfm = pf_map_new_to_tile(&parameter, best_tile,
+                               pft_min_move_cost(&parameter));
       path = pf_map_path(pfm, best_tile);
     }
 
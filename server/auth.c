@@ -21,8 +21,10 @@
 
 /* utility */
 #include "fcintl.h"
+#include "fcthread.h"
 #include "log.h"
 #include "md5.h"
+#include "mem.h"
 #include "registry.h"
 #include "shared.h"
 #include "support.h"
@@ -59,11 +61,47 @@
  * many seconds to reply to the client */
 static const int auth_fail_wait[] = { 1, 1, 2, 3 };
 
+/* A call of the fcdb script for a connection. The worker thread works
+ * on a copy of the connection, as the real one may change or go away
+ * meanwhile. */
+struct auth_request {
+  int conn_id;
+  const char *func_name;        /* "user_load", "user_save" or "user_log". */
+  bool login_ok;                /* Second argument of "user_log". */
+  struct connection conn;       /* What the script may see of it. */
+  enum fcdb_status status;
+  struct script_fcdb_msg_list *msgs; /* Script output of the worker call. */
+};
+
+#define SPECLIST_TAG auth_request
+#define SPECLIST_TYPE struct auth_request
+#include "speclist.h"
+
+#define auth_request_list_iterate(reqlist, preq) \
+    TYPED_LIST_ITERATE(struct auth_request, reqlist, preq)
+#define auth_request_list_iterate_end  LIST_ITERATE_END
+
+/* The thread running the fcdb script calls, so that a slow database does
+ * not hold up the other connections. Finished requests go back to the
+ * main thread through 'done', see auth_poll(). */
+static struct {
+  bool running;
+  bool quit;
+  fc_thread thread;
+  fc_mutex mutex;
+  fc_thread_cond cond;
+  struct auth_request_list *todo;
+  struct auth_request_list *done;
+  int pending;                  /* Requests not handled by auth_poll(). */
+} auth_worker;
+
 static bool auth_check_password(struct connection *pconn,
                                 const char *password, int len);
 static bool is_guest_name(const char *name);
 static void get_unique_guest_name(char *name);
 static bool is_good_password(const char *password, char *msg);
+static void auth_fcdb_request(struct connection *pconn,
+                              const char *func_name, bool login_ok);
 
 /****************************************************************************
   Handle authentication of a user; called by handle_login_request() if
@@ -98,65 +136,95 @@ bool auth_user(struct connection *pconn, char *username)
     }
   } else {
     /* we are not a guest, we need an extra check as to whether a 
-     * connection can be established: the client must authenticate itself */
-    char buffer[MAX_LEN_MSG];
-
+     * connection can be established: the client must authenticate itself;
+     * auth_user_loaded() goes on once the database has answered. */
     sz_strlcpy(pconn->username, username);
+    pconn->server.status = AS_WAITING_FCDB;
+    pconn->server.auth_settime = time(NULL);
+    auth_fcdb_request(pconn, "user_load", FALSE);
+  }
 
-    switch(script_fcdb_call("user_load", 1, API_TYPE_CONNECTION, pconn)) {
-    case FCDB_ERROR:
-      if (srvarg.auth_allow_guests) {
-        sz_strlcpy(tmpname, pconn->username);
-        get_unique_guest_name(tmpname); /* don't pass pconn->username here */
-        sz_strlcpy(pconn->username, tmpname);
+  return TRUE;
+}
 
-        log_error("Error reading database; connection -> guest");
-        notify_conn(pconn->self, NULL, E_CONNECTION, ftc_warning,
-                    _("There was an error reading the user "
-                      "database, logging in as guest connection '%s'."),
-                    pconn->username);
-        establish_new_connection(pconn);
-      } else {
-        reject_new_connection(_("There was an error reading the user database "
-                                "and guest logins are not allowed. Sorry"),
-                              pconn);
-        log_normal(_("%s was rejected: Database error and guests not "
-                     "allowed."), pconn->username);
-        return FALSE;
-      }
-      break;
-    case FCDB_SUCCESS_TRUE:
-      /* we found a user */
-      fc_snprintf(buffer, sizeof(buffer), _("Enter password for %s:"),
+/****************************************************************************
+  Carry on with the login of a user who is not a guest, after the
+  database has been asked about them.
+****************************************************************************/
+static void auth_user_loaded(struct connection *pconn,
+                             enum fcdb_status status, const char *password)
+{
+  char tmpname[MAX_LEN_NAME] = "\0";
+  char buffer[MAX_LEN_MSG];
+
+  switch (status) {
+  case FCDB_ERROR:
+    if (srvarg.auth_allow_guests) {
+      sz_strlcpy(tmpname, pconn->username);
+      get_unique_guest_name(tmpname); /* don't pass pconn->username here */
+      sz_strlcpy(pconn->username, tmpname);
+
+      log_error("Error reading database; connection -> guest");
+      notify_conn(pconn->self, NULL, E_CONNECTION, ftc_warning,
+                  _("There was an error reading the user "
+                    "database, logging in as guest connection '%s'."),
                   pconn->username);
-      dsend_packet_authentication_req(pconn, AUTH_LOGIN_FIRST, buffer);
+      establish_new_connection(pconn);
+    } else {
+      pconn->server.status = AS_NOT_ESTABLISHED;
+      reject_new_connection(_("There was an error reading the user database "
+                              "and guest logins are not allowed. Sorry"),
+                            pconn);
+      log_normal(_("%s was rejected: Database error and guests not "
+                   "allowed."), pconn->username);
+      connection_close_server(pconn, _("auth failed"));
+    }
+    break;
+  case FCDB_SUCCESS_TRUE:
+    /* we found a user */
+    sz_strlcpy(pconn->server.password, password);
+    fc_snprintf(buffer, sizeof(buffer), _("Enter password for %s:"),
+                pconn->username);
+    dsend_packet_authentication_req(pconn, AUTH_LOGIN_FIRST, buffer);
+    pconn->server.auth_settime = time(NULL);
+    pconn->server.status = AS_REQUESTING_OLD_PASS;
+    break;
+  case FCDB_SUCCESS_FALSE:
+    /* we couldn't find the user, he is new */
+    if (srvarg.auth_allow_newusers) {
+      sz_strlcpy(buffer, _("Enter a new password (and remember it)."));
+      dsend_packet_authentication_req(pconn, AUTH_NEWUSER_FIRST, buffer);
       pconn->server.auth_settime = time(NULL);
-      pconn->server.status = AS_REQUESTING_OLD_PASS;
-      break;
-    case FCDB_SUCCESS_FALSE:
-      /* we couldn't find the user, he is new */
-      if (srvarg.auth_allow_newusers) {
-        sz_strlcpy(buffer, _("Enter a new password (and remember it)."));
-        dsend_packet_authentication_req(pconn, AUTH_NEWUSER_FIRST, buffer);
-        pconn->server.auth_settime = time(NULL);
-        pconn->server.status = AS_REQUESTING_NEW_PASS;
-      } else {
-        reject_new_connection(_("This server allows only preregistered "
-                                "users. Sorry."), pconn);
-        log_normal(_("%s was rejected: Only preregistered users allowed."),
-                   pconn->username);
-
-        return FALSE;
-      }
-      break;
-    default:
-      fc_assert(FALSE);
-      break;
+      pconn->server.status = AS_REQUESTING_NEW_PASS;
+    } else {
+      pconn->server.status = AS_NOT_ESTABLISHED;
+      reject_new_connection(_("This server allows only preregistered "
+                              "users. Sorry."), pconn);
+      log_normal(_("%s was rejected: Only preregistered users allowed."),
+                 pconn->username);
+      connection_close_server(pconn, _("auth failed"));
     }
-    return TRUE;
+    break;
+  default:
+    fc_assert(FALSE);
+    break;
   }
+}
 
-  return TRUE;
+/****************************************************************************
+  Finish the login of a new user, after their password has been saved.
+****************************************************************************/
+static void auth_user_saved(struct connection *pconn,
+                            enum fcdb_status status)
+{
+  if (status != FCDB_SUCCESS_TRUE) {
+    notify_conn(pconn->self, NULL, E_CONNECTION, ftc_warning,
+                _("Warning: There was an error in saving to the database. "
+                  "Continuing, but your stats will not be saved."));
+    log_error("Error writing to database for: %s", pconn->username);
+  }
+
+  establish_new_connection(pconn);
 }
 
 /****************************************************************************
@@ -183,19 +251,13 @@ bool auth_handle_reply(struct connection *pconn, char *password)
     }
 
     /* the new password is good, create a database entry for
-     * this user; we establish the connection in handle_db_lookup */
+     * this user; we establish the connection in auth_user_saved() */
     create_md5sum((unsigned char *)password, strlen(password),
                   pconn->server.password);
 
-    if (script_fcdb_call("user_save", 1, API_TYPE_CONNECTION, pconn)
-        != FCDB_SUCCESS_TRUE) {
-      notify_conn(pconn->self, NULL, E_CONNECTION, ftc_warning,
-                  _("Warning: There was an error in saving to the database. "
-                    "Continuing, but your stats will not be saved."));
-      log_error("Error writing to database for: %s", pconn->username);
-    }
-
-    establish_new_connection(pconn);
+    pconn->server.status = AS_WAITING_FCDB;
+    pconn->server.auth_settime = time(NULL);
+    auth_fcdb_request(pconn, "user_save", FALSE);
   } else if (pconn->server.status == AS_REQUESTING_OLD_PASS) {
     if (auth_check_password(pconn, password, strlen(password)) == 1) {
       establish_new_connection(pconn);
@@ -256,6 +318,17 @@ void auth_process_status(struct connection *pconn)
       connection_close_server(pconn, _("auth failed"));
     }
     break;
+  case AS_WAITING_FCDB:
+    /* the database doesn't answer; the late answer will be ignored */
+    if (time(NULL) >= pconn->server.auth_settime + MAX_WAIT_TIME) {
+      pconn->server.status = AS_NOT_ESTABLISHED;
+      reject_new_connection(_("Sorry, the user database does not "
+                              "answer..."), pconn);
+      log_normal(_("%s was rejected: Timeout waiting for the user "
+                   "database."), pconn->username);
+      connection_close_server(pconn, _("auth failed"));
+    }
+    break;
   case AS_ESTABLISHED:
     /* this better fail bigtime */
     fc_assert(pconn->server.status != AS_ESTABLISHED);
@@ -278,8 +351,7 @@ static bool auth_check_password(struct connection *pconn,
   ok = (strncmp(checksum, pconn->server.password, MD5_HEX_BYTES) == 0)
                                                               ? TRUE : FALSE;
 
-  script_fcdb_call("user_log", 2, API_TYPE_CONNECTION, pconn, API_TYPE_BOOL,
-                   ok);
+  auth_fcdb_request(pconn, "user_log", ok);
 
   return ok;
 }
@@ -375,6 +447,236 @@ static bool is_good_password(const char *password, char *msg)
   return TRUE;
 }
 
+/****************************************************************************
+  Make the fcdb script call of the request. Run by the auth worker thread,
+  or by the main thread when there is none.
+****************************************************************************/
+static void auth_request_run(struct auth_request *preq)
+{
+  if (0 == strcmp(preq->func_name, "user_log")) {
+    preq->status = script_fcdb_call_queued(preq->msgs, preq->func_name, 2,
+                                           API_TYPE_CONNECTION, &preq->conn,
+                                           API_TYPE_BOOL, preq->login_ok);
+  } else {
+    preq->status = script_fcdb_call_queued(preq->msgs, preq->func_name, 1,
+                                           API_TYPE_CONNECTION, &preq->conn);
+  }
+}
+
+/****************************************************************************
+  Free the request, after logging what the script said while running it
+  and has not been logged yet. Must be called from the main thread.
+****************************************************************************/
+static void auth_request_destroy(struct auth_request *preq)
+{
+  script_fcdb_msgs_output(preq->msgs);
+  script_fcdb_msg_list_destroy(preq->msgs);
+  free(preq);
+}
+
+/****************************************************************************
+  Hand the result of a request to its connection, if it still waits for
+  it. Must be called from the main thread.
+****************************************************************************/
+static void auth_request_finish(struct auth_request *preq)
+{
+  struct connection *pconn = conn_by_number(preq->conn_id);
+
+  /* The script messages first, as the answer may disconnect. */
+  script_fcdb_msgs_output(preq->msgs);
+
+  if (0 == strcmp(preq->func_name, "user_log")) {
+    /* Nothing waits for the log entry. */
+    return;
+  }
+
+  if (NULL == pconn || !conn_is_valid(pconn)
+      || AS_WAITING_FCDB != pconn->server.status) {
+    log_verbose("Dropping the answer to '%s' for %s, which is gone.",
+                preq->func_name, preq->conn.username);
+    return;
+  }
+
+  if (0 == strcmp(preq->func_name, "user_load")) {
+    auth_user_loaded(pconn, preq->status, preq->conn.server.password);
+  } else {
+    auth_user_saved(pconn, preq->status);
+  }
+}
+
+/****************************************************************************
+  Main function of the auth worker thread.
+****************************************************************************/
+static void auth_worker_main(void *arg)
+{
+  fc_allocate_mutex(&auth_worker.mutex);
+  while (TRUE) {
+    struct auth_request *preq;
+
+    while (!auth_worker.quit
+           && 0 == auth_request_list_size(auth_worker.todo)) {
+      fc_thread_cond_wait(&auth_worker.cond, &auth_worker.mutex);
+    }
+    if (auth_worker.quit) {
+      break;
+    }
+
+    preq = auth_request_list_front(auth_worker.todo);
+    auth_request_list_pop_front(auth_worker.todo);
+    fc_release_mutex(&auth_worker.mutex);
+
+    auth_request_run(preq);
+
+    fc_allocate_mutex(&auth_worker.mutex);
+    auth_request_list_append(auth_worker.done, preq);
+  }
+  fc_release_mutex(&auth_worker.mutex);
+}
+
+/****************************************************************************
+  Start the auth worker thread if it isn't running. Returns FALSE if it
+  can't be.
+****************************************************************************/
+static bool auth_worker_start(void)
+{
+  if (auth_worker.running) {
+    return TRUE;
+  }
+
+  if (!has_thread_cond_impl()) {
+    return FALSE;
+  }
+
+  fc_init_mutex(&auth_worker.mutex);
+  fc_thread_cond_init(&auth_worker.cond);
+  auth_worker.todo = auth_request_list_new();
+  auth_worker.done = auth_request_list_new();
+  auth_worker.quit = FALSE;
+  auth_worker.pending = 0;
+
+  if (0 != fc_thread_start(&auth_worker.thread, auth_worker_main, NULL)) {
+    log_error("Failed to start the authentication thread, "
+              "the database will be used from the main thread.");
+    auth_request_list_destroy(auth_worker.todo);
+    auth_request_list_destroy(auth_worker.done);
+    fc_thread_cond_destroy(&auth_worker.cond);
+    fc_destroy_mutex(&auth_worker.mutex);
+    return FALSE;
+  }
+
+  auth_worker.running = TRUE;
+  return TRUE;
+}
+
+/****************************************************************************
+  Call 'func_name' of the fcdb script for the connection. The answer
+  comes back through auth_poll(), or at once if there is no auth worker
+  thread.
+****************************************************************************/
+static void auth_fcdb_request(struct connection *pconn,
+                              const char *func_name, bool login_ok)
+{
+  struct auth_request *preq = fc_calloc(1, sizeof(*preq));
+
+  preq->conn_id = pconn->id;
+  preq->func_name = func_name;
+  preq->login_ok = login_ok;
+  preq->msgs = script_fcdb_msg_list_new();
+  preq->conn.id = pconn->id;
+  preq->conn.used = TRUE;
+  sz_strlcpy(preq->conn.username, pconn->username);
+  sz_strlcpy(preq->conn.server.ipaddr, pconn->server.ipaddr);
+  memcpy(preq->conn.server.password, pconn->server.password,
+         sizeof(preq->conn.server.password));
+
+  if (!auth_worker_start()) {
+    auth_request_run(preq);
+    auth_request_finish(preq);
+    auth_request_destroy(preq);
+    return;
+  }
+
+  fc_allocate_mutex(&auth_worker.mutex);
+  auth_request_list_append(auth_worker.todo, preq);
+  auth_worker.pending++;
+  fc_thread_cond_signal(&auth_worker.cond);
+  fc_release_mutex(&auth_worker.mutex);
+}
+
+/****************************************************************************
+  Handle the answers of the database which have come in. Called regularly
+  from the main loop.
+****************************************************************************/
+void auth_poll(void)
+{
+  struct auth_request_list *done;
+
+  if (!auth_worker.running) {
+    return;
+  }
+
+  fc_allocate_mutex(&auth_worker.mutex);
+  done = auth_worker.done;
+  auth_worker.done = auth_request_list_new();
+  auth_worker.pending -= auth_request_list_size(done);
+  fc_release_mutex(&auth_worker.mutex);
+
+  auth_request_list_iterate(done, preq) {
+    auth_request_finish(preq);
+    auth_request_destroy(preq);
+  } auth_request_list_iterate_end;
+  auth_request_list_destroy(done);
+}
+
+/****************************************************************************
+  Returns whether some database requests have not been answered yet, so
+  that the main loop should call auth_poll() again soon.
+****************************************************************************/
+bool auth_pending(void)
+{
+  bool pending;
+
+  if (!auth_worker.running) {
+    return FALSE;
+  }
+
+  fc_allocate_mutex(&auth_worker.mutex);
+  pending = (0 < auth_worker.pending);
+  fc_release_mutex(&auth_worker.mutex);
+
+  return pending;
+}
+
+/****************************************************************************
+  Stop the auth worker thread. The requests it has not made yet are
+  dropped.
+****************************************************************************/
+void auth_free(void)
+{
+  if (!auth_worker.running) {
+    return;
+  }
+
+  fc_allocate_mutex(&auth_worker.mutex);
+  auth_worker.quit = TRUE;
+  fc_thread_cond_signal(&auth_worker.cond);
+  fc_release_mutex(&auth_worker.mutex);
+  fc_thread_wait(&auth_worker.thread);
+
+  auth_request_list_iterate(auth_worker.todo, preq) {
+    auth_request_destroy(preq);
+  } auth_request_list_iterate_end;
+  auth_request_list_destroy(auth_worker.todo);
+  auth_request_list_iterate(auth_worker.done, preq) {
+    auth_request_destroy(preq);
+  } auth_request_list_iterate_end;
+  auth_request_list_destroy(auth_worker.done);
+
+  fc_thread_cond_destroy(&auth_worker.cond);
+  fc_destroy_mutex(&auth_worker.mutex);
+  auth_worker.running = FALSE;
+}
+
 /**************************************************************************
   Get username for connection
 **************************************************************************/
@@ -20,6 +20,9 @@ struct connection;
 bool auth_user(struct connection *pconn, char *username);
 void auth_process_status(struct connection *pconn);
 bool auth_handle_reply(struct connection *pconn, char *password);
+void auth_poll(void);
+bool auth_pending(void);
+void auth_free(void);
 
 const char *auth_get_username(struct connection *pconn);
 const char *auth_get_ipaddr(struct connection *pconn);
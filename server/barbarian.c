@@ -32,6 +32,7 @@
 #include "support.h"
 
 /* common */
+#include "city.h"
 #include "effects.h"
 #include "events.h"
 #include "game.h"
@@ -137,6 +138,7 @@ struct player *create_barbarian_player(enum barbarian_type type)
   sz_strlcpy(barbarians->username, ANON_USER_NAME);
   barbarians->is_connected = FALSE;
   barbarians->government = nation->init_government;
+  city_refresh_generation_bump();
   fc_assert(barbarians->revolution_finishes < 0);
   barbarians->server.capital = FALSE;
   barbarians->economic.gold = 100;
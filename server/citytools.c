@@ -1027,6 +1027,7 @@ void transfer_city(struct player *ptaker, struct city *pcity,
   /* city_thaw_workers_queue() later */
 
   pcity->owner = ptaker;
+  city_refresh_generation_bump();
   map_claim_ownership(pcenter, ptaker, pcenter, TRUE);
   city_list_prepend(ptaker->cities, pcity);
 
@@ -1268,6 +1269,7 @@ void create_city(struct player *pplayer, struct tile *ptile,
   log_debug("create_city() %s", name);
 
   pcity = create_city_virtual(pplayer, ptile, name);
+  city_refresh_generation_bump();
 
   adv_city_alloc(pcity);
 
@@ -1402,6 +1404,8 @@ void remove_city(struct city *pcity)
   struct dbv tile_processed;
   struct tile_list *process_queue;
 
+  city_refresh_generation_bump();
+
   BV_CLR_ALL(had_small_wonders);
   city_built_iterate(pcity, pimprove) {
     city_remove_improvement(pcity, pimprove);
@@ -1875,7 +1879,8 @@ static void broadcast_city_info(struct city *pcity)
 
   /* Send to global observers. */
   conn_list_iterate(game.est_connections, pconn) {
-    if (conn_is_global_observer(pconn)) {
+    if (conn_is_global_observer(pconn)
+        && !conn_delta_group_follower(pconn)) {
       send_packet_city_info(pconn, &packet, FALSE);
     }
   } conn_list_iterate_end;
@@ -2405,17 +2410,19 @@ void building_lost(struct city *pcity, const struct impr_type *pimprove)
     * building created (via city_refresh() in in city_build_building())
 
   If the upkeep for a unit changes, an update is send to the player.
+  Returns whether the upkeep of any unit changed.
 **************************************************************************/
-void city_units_upkeep(const struct city *pcity)
+bool city_units_upkeep(const struct city *pcity)
 {
   int free[O_LAST], cost;
   struct unit_type *ut;
   struct player *plr;
   bool update;
+  bool changed = FALSE;
 
   if (!pcity || !pcity->units_supported
       || unit_list_size(pcity->units_supported) < 1) {
-    return;
+    return FALSE;
   }
 
   memset(free, 0, O_LAST * sizeof(*free));
@@ -2451,8 +2458,11 @@ void city_units_upkeep(const struct city *pcity)
     if (update) {
       /* update unit information to the player */
       send_unit_info(plr, punit);
+      changed = TRUE;
     }
   } unit_list_iterate_end;
+
+  return changed;
 }
 
 /**************************************************************************
@@ -2707,14 +2717,12 @@ void city_refresh_vision(struct city *pcity)
 }
 
 /**************************************************************************
-  Updates the squared city radius. Returns if the radius is changed.
+  Returns the squared city radius the city should have according to the
+  current effects. If the new radius would not change the number of city
+  tiles, the current radius is returned.
 **************************************************************************/
-bool city_map_update_radius_sq(struct city *pcity)
+int city_map_radius_sq_wanted(const struct city *pcity)
 {
-
-  fc_assert_ret_val(pcity != NULL, FALSE);
-
-  int city_tiles_old, city_tiles_new;
   int city_radius_sq_old = city_map_radius_sq_get(pcity);
   int city_radius_sq_new = game.info.init_city_radius_sq
                            + get_city_bonus(pcity, EFT_CITY_RADIUS_SQ);
@@ -2723,6 +2731,28 @@ bool city_map_update_radius_sq(struct city *pcity)
   city_radius_sq_new = CLIP(CITY_MAP_MIN_RADIUS_SQ, city_radius_sq_new,
                             CITY_MAP_MAX_RADIUS_SQ);
 
+  if (city_map_tiles(city_radius_sq_old)
+      == city_map_tiles(city_radius_sq_new)) {
+    /* no change, or a change of the squared city radius but no change of
+     * the number of city tiles */
+    return city_radius_sq_old;
+  }
+
+  return city_radius_sq_new;
+}
+
+/**************************************************************************
+  Updates the squared city radius. Returns if the radius is changed.
+**************************************************************************/
+bool city_map_update_radius_sq(struct city *pcity)
+{
+
+  fc_assert_ret_val(pcity != NULL, FALSE);
+
+  int city_tiles_old, city_tiles_new;
+  int city_radius_sq_old = city_map_radius_sq_get(pcity);
+  int city_radius_sq_new = city_map_radius_sq_wanted(pcity);
+
   if (city_radius_sq_new == city_radius_sq_old) {
     /* no change */
     return FALSE;
@@ -2732,12 +2762,6 @@ bool city_map_update_radius_sq(struct city *pcity)
   city_tiles_old = city_map_tiles(city_radius_sq_old);
   city_tiles_new = city_map_tiles(city_radius_sq_new);
 
-  if (city_tiles_old == city_tiles_new) {
-    /* a change of the squared city radius but no change of the number of
-     * city tiles */
-    return FALSE;;
-  }
-
   log_debug("[%s (%d)] city_map_radius_sq: %d => %d", city_name(pcity),
             pcity->id, city_radius_sq_old, city_radius_sq_new);
 
@@ -75,7 +75,7 @@ void remove_trade_route(struct city *pc1, struct city *pc2);
 void do_sell_building(struct player *pplayer, struct city *pcity,
 		      struct impr_type *pimprove);
 void building_lost(struct city *pcity, const struct impr_type *pimprove);
-void city_units_upkeep(const struct city *pcity);
+bool city_units_upkeep(const struct city *pcity);
 
 bool is_production_equal(const struct universal *one,
 			 const struct universal *two);
@@ -102,6 +102,7 @@ bool city_map_update_tile_now(struct tile *ptile);
 void city_map_update_all(struct city *pcity);
 void city_map_update_all_cities_for_player(struct player *pplayer);
 
+int city_map_radius_sq_wanted(const struct city *pcity);
 bool city_map_update_radius_sq(struct city *pcity);
 
 void city_landlocked_sell_coastal_improvements(struct tile *ptile);
@@ -22,6 +22,7 @@
 
 /* utility */
 #include "fcintl.h"
+#include "fcthreadpool.h"
 #include "log.h"
 #include "mem.h"
 #include "rand.h"
@@ -37,6 +38,7 @@
 #include "city.h"
 #include "events.h"
 #include "disaster.h"
+#include "effects.h"
 #include "game.h"
 #include "government.h"
 #include "map.h"
@@ -127,7 +129,7 @@ static bool player_balance_treasury_units(struct player *pplayer);
 static bool disband_city(struct city *pcity);
 
 static void define_orig_production_values(struct city *pcity);
-static void update_city_activity(struct city *pcity);
+static void update_city_activity(struct city *pcity, bool refreshed);
 static void nullify_caravan_and_disband_plus(struct city *pcity);
 static bool city_illness_check(const struct city * pcity);
 
@@ -158,6 +160,81 @@ bool city_refresh(struct city *pcity)
   return retval;
 }
 
+/* Cities of a player refreshed by worker threads before their end of
+ * turn update. */
+struct city_refresh_ahead {
+  struct city **cities;
+  bool *refreshed;
+};
+
+/**************************************************************************
+  Worker thread part of city_refresh_ahead(): do the read-only part of
+  city_refresh() for one city. Cities whose radius is about to change
+  are left alone, as changing it modifies the map.
+**************************************************************************/
+static void city_refresh_ahead_one(int idx, void *data)
+{
+  struct city_refresh_ahead *ahead = data;
+  struct city *pcity = ahead->cities[idx];
+
+  if (city_map_radius_sq_wanted(pcity) == city_map_radius_sq_get(pcity)) {
+    city_refresh_from_main_map(pcity, NULL);
+    ahead->refreshed[idx] = TRUE;
+  } else {
+    ahead->refreshed[idx] = FALSE;
+  }
+}
+
+/**************************************************************************
+  Refresh the given cities in the worker threads of 'pool'. 'refreshed'
+  tells for which cities this was done. The result is valid as long as
+  city_refresh_generation() keeps the value it has when this returns,
+  and the city's own data is not changed.
+**************************************************************************/
+static void city_refresh_ahead(struct fc_threadpool *pool,
+                               struct city **cities, bool *refreshed,
+                               int count)
+{
+  struct city_refresh_ahead ahead = {
+    .cities = cities,
+    .refreshed = refreshed
+  };
+
+  effect_cache_set_read_only(TRUE);
+  fc_threadpool_run(pool, count, city_refresh_ahead_one, &ahead);
+  effect_cache_set_read_only(FALSE);
+}
+
+#ifdef DEBUG
+/**************************************************************************
+  Check that a city refreshed ahead of time is still up to date.
+**************************************************************************/
+static void city_refresh_ahead_check(struct city *pcity)
+{
+  int surplus[O_LAST], prod[O_LAST], usage[O_LAST], waste[O_LAST];
+  citizens feel[CITIZEN_LAST][FEELING_LAST];
+  int pollution = pcity->pollution;
+
+  memcpy(surplus, pcity->surplus, sizeof(surplus));
+  memcpy(prod, pcity->prod, sizeof(prod));
+  memcpy(usage, pcity->usage, sizeof(usage));
+  memcpy(waste, pcity->waste, sizeof(waste));
+  memcpy(feel, pcity->feel, sizeof(feel));
+
+  city_refresh_from_main_map(pcity, NULL);
+
+  if (0 != memcmp(surplus, pcity->surplus, sizeof(surplus))
+      || 0 != memcmp(prod, pcity->prod, sizeof(prod))
+      || 0 != memcmp(usage, pcity->usage, sizeof(usage))
+      || 0 != memcmp(waste, pcity->waste, sizeof(waste))
+      || 0 != memcmp(feel, pcity->feel, sizeof(feel))
+      || pollution != pcity->pollution) {
+    log_error("%s (%d): refresh done ahead of time was out of date.",
+              city_name(pcity), pcity->id);
+  }
+}
+#endif /* DEBUG */
+
 /**************************************************************************
   Called on government change or wonder completion or stuff like that
   -- Syela
@@ -530,6 +607,9 @@ void update_city_activities(struct player *pplayer)
 
   if (n > 0) {
     struct city *cities[n];
+    bool refreshed[n];
+    struct fc_threadpool *pool = server_threadpool();
+    unsigned int refresh_gen = 0;
     int i = 0, r;
 
     city_list_iterate(pplayer->cities, pcity) {
@@ -564,13 +644,31 @@ void update_city_activities(struct player *pplayer)
      * 2 - The nation as a whole balances the treasury. If the treasury is
      *     not balance units and buildings are sold. */
 
+    /* The first refresh of each city doesn't change anything but the
+     * city itself, so it can be done for all of them at once in worker
+     * threads. Whatever the update of one city changes that the others
+     * depend on bumps the refresh generation; the cities not handled yet
+     * are then refreshed serially as usual. Refreshing them ahead again
+     * would redo all of them for each of the many such changes. */
+    memset(refreshed, 0, sizeof(refreshed));
+    if (pool != NULL) {
+      city_refresh_ahead(pool, cities, refreshed, i);
+      refresh_gen = city_refresh_generation();
+    }
+
     /* Iterate over cities in a random order. */
     while (i > 0) {
       r = fc_rand(i);
+      if (refreshed[r] && refresh_gen != city_refresh_generation()) {
+        memset(refreshed, 0, sizeof(refreshed));
+      }
       /* update unit upkeep */
-      city_units_upkeep(cities[r]);
-      update_city_activity(cities[r]);
+      if (city_units_upkeep(cities[r])) {
+        refreshed[r] = FALSE;
+      }
+      update_city_activity(cities[r], refreshed[r]);
       cities[r] = cities[--i];
+      refreshed[r] = refreshed[i];
     }
 
     if (pplayer->economic.gold < 0 && game.info.gold_upkeep_style > 0) {
@@ -2415,9 +2513,10 @@ void nullify_prechange_production(struct city *pcity)
 }
 
 /**************************************************************************
- Called every turn, at end of turn, for every city.
+ Called every turn, at end of turn, for every city. If 'refreshed' is set,
+ the city has already been refreshed by city_refresh_ahead().
 **************************************************************************/
-static void update_city_activity(struct city *pcity)
+static void update_city_activity(struct city *pcity, bool refreshed)
 {
   struct player *pplayer;
   struct government *gov;
@@ -2429,7 +2528,12 @@ static void update_city_activity(struct city *pcity)
   pplayer = city_owner(pcity);
   gov = government_of_city(pcity);
 
-  if (city_refresh(pcity)) {
+  if (refreshed) {
+    pcity->server.needs_refresh = FALSE;
+#ifdef DEBUG
+    city_refresh_ahead_check(pcity);
+#endif
+  } else if (city_refresh(pcity)) {
     auto_arrange_workers(pcity);
   }
 
@@ -73,6 +73,7 @@ static void Mac_options(int argc);  /* don't need argv */
 if (S_S_RUNNING == server_state()) {    \
   save_game_auto(#sig, AS_INTERRUPT);   \
 }                                       \
+save_game_wait();                       \
 exit(EXIT_SUCCESS);
 
 /**************************************************************************
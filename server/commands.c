@@ -203,7 +203,8 @@ static struct command commands[] = {
       "debug units <x> <y>\n"
       "debug unit <id>\n"
       "debug timing\n"
-      "debug info"),
+      "debug info\n"
+      "debug memory"),
    N_("Turn on or off AI debugging of given entity."),
    N_("Print AI debug information about given entity and turn continuous "
       "debugging output for this entity on or off."), NULL,
@@ -510,6 +511,19 @@ static struct command commands[] = {
       "To list the player colors, use 'list colors'."), NULL,
    CMD_ECHO_NONE, VCF_NONE, 0
   },
+  {"netcompress", ALLOW_ADMIN,
+   /* TRANS: translate text between <> only */
+   N_("netcompress <connection-name> <level>"),
+   N_("Set the compression level of a connection."),
+   N_("This command sets the zlib compression level of the packets sent "
+      "to the given connection, from 0 (fastest, no compression) to 9 "
+      "(best compression), or -1 for the default level. Higher levels "
+      "save bandwidth on slow links at the cost of server CPU time. "
+      "New connections start with the level given by the "
+      "FREECIV_COMPRESSION_LEVEL environment variable of the server, "
+      "if set."), NULL,
+   CMD_ECHO_ADMINS, VCF_NONE, 0
+  },
   {"endgame",	ALLOW_ADMIN,
    /* no translatable parameters */
    SYN_ORIG_("endgame"),
@@ -598,9 +612,19 @@ static struct command commands[] = {
    /* TRANS: translate text between <> only */
    N_("lua cmd <script line>\n"
       "lua file <script file>\n"
+      "lua profile [on|off|reset|show]\n"
+      "lua profile dump <file>\n"
+      "lua profile budget <milliseconds>\n"
       "lua <script line> (deprecated)"),
    N_("Evaluate a line of Freeciv script or a Freeciv script file in the "
-      "current game."), NULL, NULL,
+      "current game."),
+   N_("'lua profile on' starts counting the calls of each script signal "
+      "and callback, and the wall clock time, CPU time and memory they "
+      "use. 'lua profile show' lists the results, 'lua profile dump' "
+      "writes them to a file, and 'lua profile reset' clears them.\n"
+      "With 'lua profile budget', the callbacks which take more than the "
+      "given time in a turn are logged while profiling; 0 turns the "
+      "check off."), NULL,
    CMD_ECHO_ADMINS, VCF_NONE, 0
   },
   {"kick", ALLOW_CTRL,
@@ -74,6 +74,7 @@ enum command_id {
   CMD_IGNORE,
   CMD_UNIGNORE,
   CMD_PLAYERCOLOR,
+  CMD_NETCOMPRESS,
 
   /* potentially harmful: */
   CMD_END_GAME,
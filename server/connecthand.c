@@ -548,6 +548,30 @@ struct player *find_uncontrolled_player(void)
   return NULL;
 }
 
+/****************************************************************************
+  Global observers all get the same game info packets. Make pconn share
+  their delta-state with the other global observers using the same
+  packet variants, so these packets are encoded once for all of them.
+****************************************************************************/
+static void join_global_observers(struct connection *pconn)
+{
+  struct connection *peer = NULL;
+
+  conn_list_iterate(game.est_connections, aconn) {
+    if (aconn != pconn
+        && NULL != aconn->delta_group
+        && conn_is_global_observer(aconn)
+        && aconn->packet_header.length == pconn->packet_header.length
+        && aconn->packet_header.type == pconn->packet_header.type
+        && 0 == strcmp(aconn->capability, pconn->capability)) {
+      peer = aconn;
+      break;
+    }
+  } conn_list_iterate_end;
+
+  conn_delta_group_join(pconn, peer);
+}
+
 /****************************************************************************
   Setup pconn as a client connected to pplayer or observer:
   Updates pconn->playing, pplayer->connections, pplayer->is_connected
@@ -680,6 +704,10 @@ static bool connection_attach_real(struct connection *pconn,
     break;
   }
 
+  if (conn_is_global_observer(pconn)) {
+    join_global_observers(pconn);
+  }
+
   send_updated_vote_totals(NULL);
 
   return TRUE;
@@ -710,6 +738,10 @@ void connection_detach(struct connection *pconn, bool remove_unused_player)
 
   fc_assert_ret(pconn != NULL);
 
+  /* Its view won't be the one of the other global observers anymore. The
+   * delta-state is reset on both sides when it is attached again. */
+  conn_delta_group_leave(pconn);
+
   if (NULL != (pplayer = pconn->playing)) {
     bool was_connected = pplayer->is_connected;
 
@@ -25,6 +25,8 @@
 #include "support.h"
 
 /* common */
+#include "city.h"
+#include "effects.h"
 #include "events.h"
 #include "game.h"
 #include "government.h"
@@ -1106,6 +1108,7 @@ void handle_edit_player_create(struct connection *pc, int tag)
   sz_strlcpy(pplayer->username, ANON_USER_NAME);
   pplayer->is_connected = FALSE;
   pplayer->government = pnation->init_government;
+  city_refresh_generation_bump();
   pplayer->server.capital = FALSE;
 
   pplayer->economic.gold = 0;
@@ -1517,6 +1520,7 @@ void handle_edit_game(struct connection *pc,
                   packet->year, min_year, max_year);
     } else {
       game.info.year = packet->year;
+      effect_cache_invalidate();
       changed = TRUE;
     }
   }
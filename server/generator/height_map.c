@@ -68,6 +68,20 @@ void renormalize_hmap_poles(void)
   } whole_map_iterate_end;
 }
 
+/**********************************************************************
+  Fill the native rows [nat_y0, nat_y1) of the height map with random
+  values in [0, *max).
+ **********************************************************************/
+static void random_hmap_stripe(int nat_y0, int nat_y1,
+                               RANDOM_STATE *rstate, void *data)
+{
+  const int max = *(const int *) data;
+
+  stripe_tiles_iterate(nat_y0, nat_y1, ptile) {
+    hmap(ptile) = fc_rand_stream(rstate, max);
+  } stripe_tiles_iterate_end;
+}
+
 /**********************************************************************
  Create uncorrelated rand map and do some call to smoth to correlate 
  it a little and creante randoms shapes
@@ -75,9 +89,11 @@ void renormalize_hmap_poles(void)
 void make_random_hmap(int smooth)
 {
   int i = 0;
+  int max = 1000 * smooth;
+
   height_map = fc_malloc(sizeof(*height_map) * MAP_INDEX_SIZE);
 
-  INITIALIZE_ARRAY(height_map, MAP_INDEX_SIZE, fc_rand(1000 * smooth));
+  map_stripes_run(random_hmap_stripe, TRUE, &max);
 
   for (; i < smooth; i++) {
     smooth_int_map(height_map, TRUE);
@@ -149,6 +165,18 @@ static void gen5rec(int step, int x0, int y0, int x1, int y1)
   gen5rec(2 * step / 3, (x1 + x0) / 2, (y1 + y0) / 2, x1, y1);
 }
 
+/**************************************************************************
+  Scale up the native rows [nat_y0, nat_y1) of the height map and put in
+  some random fuzz.
+**************************************************************************/
+static void fuzz_hmap_stripe(int nat_y0, int nat_y1,
+                             RANDOM_STATE *rstate, void *data)
+{
+  stripe_tiles_iterate(nat_y0, nat_y1, ptile) {
+    hmap(ptile) = 8 * hmap(ptile) + fc_rand_stream(rstate, 4) - 2;
+  } stripe_tiles_iterate_end;
+}
+
 /**************************************************************************
 Generator 5 makes earthlike worlds with one or more large continents and
 a scattering of smaller islands. It does so by dividing the world into
@@ -220,9 +248,7 @@ void make_pseudofractal1_hmap(int extra_div)
   }
 
   /* put in some random fuzz */
-  whole_map_iterate(ptile) {
-    hmap(ptile) = 8 * hmap(ptile) + fc_rand(4) - 2;
-  } whole_map_iterate_end;
+  map_stripes_run(fuzz_hmap_stripe, TRUE, NULL);
 
   adjust_int_map(height_map, hmap_max_level);
 }
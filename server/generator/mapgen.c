@@ -28,6 +28,7 @@
 #include "mem.h"
 #include "rand.h"
 #include "shared.h"
+#include "timing.h"
 
 /* common */
 #include "game.h"
@@ -360,10 +361,15 @@ static struct terrain *pick_terrain_by_flag(enum terrain_flag_id flag)
   property will be avoided.
 
   This function must always return a valid terrain.
+
+  The random choice is made from 'rstate' if it is not NULL, else from
+  the global random state.
 ****************************************************************************/
-static struct terrain *pick_terrain(enum mapgen_terrain_property target,
-				    enum mapgen_terrain_property prefer,
-				    enum mapgen_terrain_property avoid)
+static struct terrain *
+pick_terrain_full(RANDOM_STATE *rstate,
+                  enum mapgen_terrain_property target,
+                  enum mapgen_terrain_property prefer,
+                  enum mapgen_terrain_property avoid)
 {
   int sum = 0;
 
@@ -386,7 +392,7 @@ static struct terrain *pick_terrain(enum mapgen_terrain_property target,
   } terrain_type_iterate_end;
 
   /* Now pick. */
-  sum = fc_rand(sum);
+  sum = (NULL != rstate ? fc_rand_stream(rstate, sum) : fc_rand(sum));
 
   /* Finally figure out which one we picked. */
   terrain_type_iterate(pterrain) {
@@ -419,57 +425,114 @@ static struct terrain *pick_terrain(enum mapgen_terrain_property target,
               mapgen_terrain_property_name(target),
               mapgen_terrain_property_name(prefer),
               mapgen_terrain_property_name(avoid));
-    return pick_terrain(target, MG_UNUSED, avoid);
+    return pick_terrain_full(rstate, target, MG_UNUSED, avoid);
   } else if (avoid != MG_UNUSED) {
     log_debug("pick_terrain(target: %s, prefer: %s, [dropping avoid: %s])",
               mapgen_terrain_property_name(target),
               mapgen_terrain_property_name(prefer),
               mapgen_terrain_property_name(avoid));
-    return pick_terrain(target, prefer, MG_UNUSED);
+    return pick_terrain_full(rstate, target, prefer, MG_UNUSED);
   } else {
     log_debug("pick_terrain([dropping target: %s], prefer: %s, avoid: %s)",
               mapgen_terrain_property_name(target),
               mapgen_terrain_property_name(prefer),
               mapgen_terrain_property_name(avoid));
-    return pick_terrain(MG_UNUSED, prefer, avoid);
+    return pick_terrain_full(rstate, MG_UNUSED, prefer, avoid);
   }
 }
 
+#define pick_terrain(target, prefer, avoid)                                 \
+  pick_terrain_full(NULL, (target), (prefer), (avoid))
+
 /**************************************************************************
-  make_relief() will convert all squares that are higher than thill to
-  mountains and hills. Note that thill will be adjusted according to
-  the map.server.steepness value, so increasing map.mountains will result
-  in more hills and mountains.
+  Set the terrains chosen by a stripe pass: 'terrains' is indexed by tile
+  index, NULL meaning no change. The terrains are set here, in the main
+  thread, as tile_set_terrain() updates global caches. Frees 'terrains'.
 **************************************************************************/
-static void make_relief(void)
+static void apply_stripe_terrains(struct terrain **terrains)
 {
-  /* Calculate the mountain level.  map.server.mountains specifies the
-   * percentage of land that is turned into hills and mountains. */
-  hmap_mountain_level = (((hmap_max_level - hmap_shore_level)
-                          * (100 - map.server.steepness))
-                         / 100 + hmap_shore_level);
-
   whole_map_iterate(ptile) {
+    if (NULL != terrains[tile_index(ptile)]) {
+      tile_set_terrain(ptile, terrains[tile_index(ptile)]);
+    }
+  } whole_map_iterate_end;
+
+  free(terrains);
+}
+
+/**************************************************************************
+  make_relief() for the native rows [nat_y0, nat_y1). It only reads the
+  height and temperature maps, so the stripes are independent.
+**************************************************************************/
+static void make_relief_stripe(int nat_y0, int nat_y1,
+                               RANDOM_STATE *rstate, void *data)
+{
+  struct terrain **terrains = data;
+
+  stripe_tiles_iterate(nat_y0, nat_y1, ptile) {
     if (not_placed(ptile) &&
         ((hmap_mountain_level < hmap(ptile)
-          && (fc_rand(10) > 5
+          && (fc_rand_stream(rstate, 10) > 5
               || !terrain_is_too_high(ptile, hmap_mountain_level,
                                       hmap(ptile))))
          || terrain_is_too_flat(ptile, hmap_mountain_level, hmap(ptile)))) {
       if (tmap_is(ptile, TT_HOT)) {
         /* Prefer hills to mountains in hot regions. */
-        tile_set_terrain(ptile,
-                         pick_terrain(MG_MOUNTAINOUS, fc_rand(10) < 4
-                                      ? MG_UNUSED : MG_GREEN, MG_UNUSED));
+        terrains[tile_index(ptile)] =
+            pick_terrain_full(rstate, MG_MOUNTAINOUS,
+                              fc_rand_stream(rstate, 10) < 4
+                              ? MG_UNUSED : MG_GREEN, MG_UNUSED);
       } else {
         /* Prefer mountains hills to in cold regions. */
-        tile_set_terrain(ptile,
-                         pick_terrain(MG_MOUNTAINOUS, MG_UNUSED,
-                                      fc_rand(10) < 8 ? MG_GREEN : MG_UNUSED));
+        terrains[tile_index(ptile)] =
+            pick_terrain_full(rstate, MG_MOUNTAINOUS, MG_UNUSED,
+                              fc_rand_stream(rstate, 10) < 8
+                              ? MG_GREEN : MG_UNUSED);
       }
       map_set_placed(ptile);
     }
-  } whole_map_iterate_end;
+  } stripe_tiles_iterate_end;
+}
+
+/**************************************************************************
+  make_relief() will convert all squares that are higher than thill to
+  mountains and hills. Note that thill will be adjusted according to
+  the map.server.steepness value, so increasing map.mountains will result
+  in more hills and mountains.
+**************************************************************************/
+static void make_relief(void)
+{
+  struct terrain **terrains;
+
+  /* Calculate the mountain level.  map.server.mountains specifies the
+   * percentage of land that is turned into hills and mountains. */
+  hmap_mountain_level = (((hmap_max_level - hmap_shore_level)
+                          * (100 - map.server.steepness))
+                         / 100 + hmap_shore_level);
+
+  terrains = fc_calloc(MAP_INDEX_SIZE, sizeof(*terrains));
+  map_stripes_run(make_relief_stripe, TRUE, terrains);
+  apply_stripe_terrains(terrains);
+}
+
+/****************************************************************************
+  make_polar() for the native rows [nat_y0, nat_y1). It only reads the
+  temperature map, so the stripes are independent.
+****************************************************************************/
+static void make_polar_stripe(int nat_y0, int nat_y1,
+                              RANDOM_STATE *rstate, void *data)
+{
+  struct terrain **terrains = data;
+
+  stripe_tiles_iterate(nat_y0, nat_y1, ptile) {
+    if (tmap_is(ptile, TT_FROZEN)
+        || (tmap_is(ptile, TT_COLD)
+            && (fc_rand_stream(rstate, 10) > 7)
+            && is_temperature_type_near(ptile, TT_FROZEN))) {
+      terrains[tile_index(ptile)] =
+          pick_terrain_full(rstate, MG_FROZEN, MG_UNUSED, MG_TROPICAL);
+    }
+  } stripe_tiles_iterate_end;
 }
 
 /****************************************************************************
@@ -479,14 +542,10 @@ static void make_relief(void)
 ****************************************************************************/
 static void make_polar(void)
 {
-  whole_map_iterate(ptile) {  
-    if (tmap_is(ptile, TT_FROZEN)
-        || (tmap_is(ptile, TT_COLD)
-            && (fc_rand(10) > 7)
-            && is_temperature_type_near(ptile, TT_FROZEN))) { 
-      tile_set_terrain(ptile, pick_terrain(MG_FROZEN, MG_UNUSED, MG_TROPICAL));
-    }
-  } whole_map_iterate_end;
+  struct terrain **terrains = fc_calloc(MAP_INDEX_SIZE, sizeof(*terrains));
+
+  map_stripes_run(make_polar_stripe, TRUE, terrains);
+  apply_stripe_terrains(terrains);
 }
 
 /*************************************************************************
@@ -1353,6 +1412,25 @@ static void print_mapgen_map(void)
   } terrain_type_iterate_end;
 }
 
+#ifdef DEBUG_TIMERS
+/**************************************************************************
+  Log the time spent in the map generator phase which just ended, and
+  start timing the next one.
+**************************************************************************/
+static void mapgen_phase_done(struct timer *phase_timer, const char *phase)
+{
+  timer_stop(phase_timer);
+  log_verbose("Map generator: %s done in %.3f ms (%d tiles).", phase,
+              1000.0 * timer_read_seconds(phase_timer), MAP_INDEX_SIZE);
+  timer_clear(phase_timer);
+  timer_start(phase_timer);
+}
+
+#define MAPGEN_PHASE_DONE(_phase) mapgen_phase_done(phase_timer, _phase)
+#else  /* DEBUG_TIMERS */
+#define MAPGEN_PHASE_DONE(_phase)
+#endif /* DEBUG_TIMERS */
+
 /**************************************************************************
   See stdinhand.c for information on map generation methods.
 
@@ -1371,6 +1449,11 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
   /* save the current random state: */
   RANDOM_STATE rstate;
   RANDOM_TYPE seed_rand;
+#ifdef DEBUG_TIMERS
+  struct timer *phase_timer = timer_new(TIMER_USER, TIMER_DEBUG);
+
+  timer_start(phase_timer);
+#endif /* DEBUG_TIMERS */
 
   /* Call fc_rand() even when result is not needed to make sure
    * random state proceeds equally for random seeds and explicitly
@@ -1398,11 +1481,13 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
       map_allocate();
     }
     adjust_terrain_param();
+    MAPGEN_PHASE_DONE("map setup");
     /* if one mapgenerator fails, it will choose another mapgenerator */
     /* with a lower number to try again */
 
     /* create a temperature map */
     create_tmap(FALSE);
+    MAPGEN_PHASE_DONE("temperature map");
 
     if (MAPGEN_ISLAND == map.server.generator) {
       /* initialise terrain selection lists used by make_island() */
@@ -1425,6 +1510,7 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
 
       /* free terrain selection lists used by make_island() */
       island_terrain_free();
+      MAPGEN_PHASE_DONE("islands");
     }
 
     if (MAPGEN_FRACTAL == map.server.generator) {
@@ -1432,12 +1518,14 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
                                ((MAPSTARTPOS_DEFAULT == map.server.startpos
                                  || MAPSTARTPOS_ALL == map.server.startpos)
                                 ? 0 : player_count()));
+      MAPGEN_PHASE_DONE("fractal height map");
     }
 
     if (MAPGEN_RANDOM == map.server.generator) {
       make_random_hmap(MAX(1, 1 + get_sqsize()
                            - (MAPSTARTPOS_DEFAULT != map.server.startpos
                               ? player_count() / 4 : 0)));
+      MAPGEN_PHASE_DONE("random height map");
     }
 
     /* if hmap only generator make anything else */
@@ -1446,12 +1534,14 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
       make_land();
       free(height_map);
       height_map = NULL;
+      MAPGEN_PHASE_DONE("land");
     }
     if (!map.server.tinyisles) {
       remove_tiny_islands();
     }
 
     smooth_water_depth();
+    MAPGEN_PHASE_DONE("water depth");
 
     /* Continent numbers must be assigned before regenerate_lakes() */
     assign_continent_numbers();
@@ -1461,6 +1551,7 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
   } else {
     assign_continent_numbers();
   }
+  MAPGEN_PHASE_DONE("continents");
 
   /* create a temperature map if it was not done before */
   if (!temperature_is_initialized()) {
@@ -1475,6 +1566,10 @@ bool map_fractal_generate(bool autosize, struct unit_type *initial_unit)
   if (!map.server.have_huts) {
     make_huts(map.server.huts); 
   }
+  MAPGEN_PHASE_DONE("resources and huts");
+#ifdef DEBUG_TIMERS
+  timer_destroy(phase_timer);
+#endif /* DEBUG_TIMERS */
 
   /* restore previous random state: */
   fc_rand_set_state(rstate);
@@ -109,21 +109,15 @@ void destroy_tmap(void)
 }
 
 /***************************************************************************
- * create_tmap initialize the temperature_map
- * if arg is FALSE, create a dumy tmap == map_colattitude
- * to be used if hmap or oceans are not placed gen 2-4
- ***************************************************************************/
-void create_tmap(bool real)
+  Compute the temperature of the native rows [nat_y0, nat_y1). If *real
+  is FALSE, this is just the colatitude.
+***************************************************************************/
+static void tmap_stripe(int nat_y0, int nat_y1, RANDOM_STATE *rstate,
+                        void *data)
 {
-  int i;
+  const bool real = *(const bool *) data;
 
-  /* if map is defined this is not changed */
-  /* TO DO load if from scenario game with tmap */
-  /* to debug, never load a this time */
-  fc_assert_ret(NULL == temperature_map);
-
-  temperature_map = fc_malloc(sizeof(*temperature_map) * MAP_INDEX_SIZE);
-  whole_map_iterate(ptile) {
+  stripe_tiles_iterate(nat_y0, nat_y1, ptile) {
      /* the base temperature is equal to base map_colatitude */
     int t = map_colatitude(ptile);
     if (!real) {
@@ -143,7 +137,47 @@ void create_tmap(bool real)
 
       tmap(ptile) =  t * (1.0 + temperate) * (1.0 + height);
     }
-  } whole_map_iterate_end;
+  } stripe_tiles_iterate_end;
+}
+
+/***************************************************************************
+  Simplify the temperatures of the native rows [nat_y0, nat_y1) to the
+  4 base values.
+***************************************************************************/
+static void tmap_simplify_stripe(int nat_y0, int nat_y1,
+                                 RANDOM_STATE *rstate, void *data)
+{
+  stripe_tiles_iterate(nat_y0, nat_y1, ptile) {
+    int t = tmap(ptile);
+
+    if (t >= TROPICAL_LEVEL) {
+      tmap(ptile) = TT_TROPICAL;
+    } else if (t >= COLD_LEVEL) {
+      tmap(ptile) = TT_TEMPERATE;
+    } else if (t >= 2 * ICE_BASE_LEVEL) {
+      tmap(ptile) = TT_COLD;
+    } else {
+      tmap(ptile) = TT_FROZEN;
+    }
+  } stripe_tiles_iterate_end;
+}
+
+/***************************************************************************
+ * create_tmap initialize the temperature_map
+ * if arg is FALSE, create a dumy tmap == map_colattitude
+ * to be used if hmap or oceans are not placed gen 2-4
+ ***************************************************************************/
+void create_tmap(bool real)
+{
+  int i;
+
+  /* if map is defined this is not changed */
+  /* TO DO load if from scenario game with tmap */
+  /* to debug, never load a this time */
+  fc_assert_ret(NULL == temperature_map);
+
+  temperature_map = fc_malloc(sizeof(*temperature_map) * MAP_INDEX_SIZE);
+  map_stripes_run(tmap_stripe, FALSE, &real);
   /* adjust to get well sizes frequencies */
   /* Notice: if colatitude is load from a scenario never call adjust has
              scenario maybe has a odd colatitude ditribution and adjust will
@@ -152,19 +186,7 @@ void create_tmap(bool real)
     adjust_int_map(temperature_map, MAX_COLATITUDE);
   }
   /* now simplify to 4 base values */ 
-  for (i = 0; i < MAP_INDEX_SIZE; i++) {
-    int t = temperature_map[i];
-
-    if (t >= TROPICAL_LEVEL) {
-      temperature_map[i] = TT_TROPICAL;
-    } else if (t >= COLD_LEVEL) {
-      temperature_map[i] = TT_TEMPERATE;
-    } else if (t >= 2 * ICE_BASE_LEVEL) {
-      temperature_map[i] = TT_COLD;
-    } else {
-      temperature_map[i] = TT_FROZEN;
-    }
-  }
+  map_stripes_run(tmap_simplify_stripe, FALSE, NULL);
 
   log_debug("%stemperature map ({f}rozen, {c}old, {m}edium, {t}ropical):",
             real ? "real " : "");
@@ -14,8 +14,21 @@
 #include <fc_config.h>
 #endif
 
+#include <float.h>
+
+/* The vectorized smoothing kernel must round exactly like the scalar
+ * code: that is only the case when float expressions are evaluated in
+ * float (no x87) and when the compiler can not fuse the scalar multiply
+ * and add. */
+#if defined(__SSE2__) && defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0 \
+    && !defined(__FMA__)
+#define SMOOTH_SSE2
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
 /* utility */
 #include "fcintl.h"
+#include "fcthreadpool.h"
 #include "log.h"
 #include "rand.h"
 #include "support.h"            /* bool type */
@@ -26,6 +39,9 @@
 #include "terrain.h"
 #include "tile.h"
 
+/* server */
+#include "srv_main.h"
+
 #include "utilities.h"
 
 /****************************************************************************
@@ -171,6 +187,60 @@ void adjust_int_map_filtered(int *int_map, int int_map_max, void *data,
   }
 }
 
+struct map_stripes {
+  map_stripe_func func;
+  bool random;
+  RANDOM_TYPE seed;
+  void *data;
+};
+
+/****************************************************************************
+  Handle the stripe number 'index' for map_stripes_run().
+****************************************************************************/
+static void map_stripe_run(int index, void *data)
+{
+  const struct map_stripes *stripes = data;
+  RANDOM_STATE rstate;
+  int nat_y0 = index * MAP_STRIPE_ROWS;
+
+  if (stripes->random) {
+    /* Knuth's multiplicative hash spreads the seeds of the stripes. */
+    fc_srand_stream(&rstate, stripes->seed + index * 2654435761U);
+  }
+  stripes->func(nat_y0, MIN(nat_y0 + MAP_STRIPE_ROWS, map.ysize),
+                stripes->random ? &rstate : NULL, stripes->data);
+}
+
+/****************************************************************************
+  Call 'func' for every stripe of MAP_STRIPE_ROWS native rows of the map,
+  in the worker threads if the server has some. 'func' may write the
+  tiles or map arrays of its stripe only.
+
+  If 'random' is set, 'func' gets a random stream of its own; the streams
+  are seeded from one value of the main one. Else it gets NULL.
+****************************************************************************/
+void map_stripes_run(map_stripe_func func, bool random, void *data)
+{
+  struct fc_threadpool *pool = server_threadpool();
+  struct map_stripes stripes = {
+    .func = func,
+    .random = random,
+    .seed = random ? fc_rand(MAX_UINT32) : 0,
+    .data = data
+  };
+  int count = (map.ysize + MAP_STRIPE_ROWS - 1) / MAP_STRIPE_ROWS;
+
+  if (NULL != pool) {
+    fc_threadpool_run(pool, count, map_stripe_run, &stripes);
+  } else {
+    int i;
+
+    for (i = 0; i < count; i++) {
+      map_stripe_run(i, &stripes);
+    }
+  }
+}
+
 /****************************************************************************
   Is given native position normal position
 ****************************************************************************/
@@ -180,6 +250,129 @@ bool is_normal_nat_pos(int x, int y)
   return is_normal_map_pos(x, y);
 }
 
+struct smooth_pass {
+  const float *weight;
+  bool axe;
+  bool zeroes_at_edges;
+  const int *source_map;
+  int *target_map;
+};
+
+/****************************************************************************
+  Smooth 'count' consecutive tiles of a native row, whose neighbours along
+  the smoothing axis are all real: they are 'step' indices away from each
+  other. The sum is made in the same order as in smooth_tiles_generic(),
+  so that the results are identical.
+****************************************************************************/
+static void smooth_row_scalar(int *target, const int *source, int count,
+                              int step, const float *weight, float D)
+{
+  int i, j;
+
+  for (i = 0; i < count; i++) {
+    float N = 0;
+
+    for (j = -2; j <= 2; j++) {
+      N += weight[j + 2] * source[i + j * step];
+    }
+    target[i] = (float)N / D;
+  }
+}
+
+#ifdef SMOOTH_SSE2
+/****************************************************************************
+  SSE2 version of smooth_row_scalar(), 4 tiles at a time.
+****************************************************************************/
+static void smooth_row_sse2(int *target, const int *source, int count,
+                            int step, const float *weight, float D)
+{
+  const __m128 vD = _mm_set1_ps(D);
+  int i = 0, j;
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 N = _mm_setzero_ps();
+
+    for (j = -2; j <= 2; j++) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (source + i + j * step));
+
+      N = _mm_add_ps(N, _mm_mul_ps(_mm_set1_ps(weight[j + 2]),
+                                   _mm_cvtepi32_ps(v)));
+    }
+    _mm_storeu_si128((__m128i *) (target + i),
+                     _mm_cvttps_epi32(_mm_div_ps(N, vD)));
+  }
+
+  smooth_row_scalar(target + i, source + i, count - i, step, weight, D);
+}
+#endif /* SMOOTH_SSE2 */
+
+#ifdef SMOOTH_SSE2
+#define smooth_row smooth_row_sse2
+#else  /* SMOOTH_SSE2 */
+#define smooth_row smooth_row_scalar
+#endif /* SMOOTH_SSE2 */
+
+/****************************************************************************
+  Smooth the tiles of native row nat_y with nat_x in [nat_x0, nat_x1),
+  the generic way. This handles the map edges and the wrapping.
+****************************************************************************/
+static void smooth_tiles_generic(const struct smooth_pass *pass, int nat_y,
+                                 int nat_x0, int nat_x1)
+{
+  int nat_x;
+
+  for (nat_x = nat_x0; nat_x < nat_x1; nat_x++) {
+    struct tile *ptile = native_pos_to_tile(nat_x, nat_y);
+    float N = 0, D = 0;
+
+    axis_iterate(ptile, pnear, i, 2, pass->axe) {
+      D += pass->weight[i + 2];
+      N += pass->weight[i + 2] * pass->source_map[tile_index(pnear)];
+    } axis_iterate_end;
+    if (pass->zeroes_at_edges) {
+      D = 1;
+    }
+    pass->target_map[tile_index(ptile)] = (float)N / D;
+  }
+}
+
+/****************************************************************************
+  One pass of smooth_int_map() over the native rows [nat_y0, nat_y1).
+  The tiles whose neighbours are all real without wrapping are handled
+  by smooth_row(); the others go the generic way.
+****************************************************************************/
+static void smooth_int_map_stripe(int nat_y0, int nat_y1,
+                                  RANDOM_STATE *rstate, void *data)
+{
+  const struct smooth_pass *pass = data;
+  float D = 0;
+  int nat_y, i;
+
+  if (pass->zeroes_at_edges) {
+    D = 1;
+  } else {
+    for (i = 0; i < 5; i++) {
+      D += pass->weight[i];
+    }
+  }
+
+  for (nat_y = nat_y0; nat_y < nat_y1; nat_y++) {
+    int row = native_pos_to_index(0, nat_y);
+
+    if (pass->axe && map.xsize > 4) {
+      smooth_tiles_generic(pass, nat_y, 0, 2);
+      smooth_row(pass->target_map + row + 2, pass->source_map + row + 2,
+                 map.xsize - 4, 1, pass->weight, D);
+      smooth_tiles_generic(pass, nat_y, map.xsize - 2, map.xsize);
+    } else if (!pass->axe && nat_y >= 2 && nat_y < map.ysize - 2) {
+      smooth_row(pass->target_map + row, pass->source_map + row,
+                 map.xsize, map.xsize, pass->weight, D);
+    } else {
+      smooth_tiles_generic(pass, nat_y, 0, map.xsize);
+    }
+  }
+}
+
 /*******************************************************************************
   Apply a Gaussian diffusion filter on the map. The size of the map is
   MAP_INDEX_SIZE and the map is indexed by native_pos_to_index function.
@@ -190,41 +383,31 @@ void smooth_int_map(int *int_map, bool zeroes_at_edges)
 {
   static const float weight_standard[5] = { 0.13, 0.19, 0.37, 0.19, 0.13 };
   static const float weight_isometric[5] = { 0.15, 0.21, 0.29, 0.21, 0.15 };
-  const float *weight;
-  bool axe = TRUE;
-  int *target_map, *source_map;
+  struct smooth_pass pass;
   int *alt_int_map = fc_calloc(MAP_INDEX_SIZE, sizeof(*alt_int_map));
 
   fc_assert_ret(NULL != int_map);
 
-  weight = weight_standard;
-  target_map = alt_int_map;
-  source_map = int_map;
+  pass.weight = weight_standard;
+  pass.axe = TRUE;
+  pass.zeroes_at_edges = zeroes_at_edges;
+  pass.target_map = alt_int_map;
+  pass.source_map = int_map;
 
   do {
-    whole_map_iterate(ptile) {
-      float N = 0, D = 0;
-
-      axis_iterate(ptile, pnear, i, 2, axe) {
-        D += weight[i + 2];
-        N += weight[i + 2] * source_map[tile_index(pnear)];
-      } axis_iterate_end;
-      if (zeroes_at_edges) {
-        D = 1;
-      }
-      target_map[tile_index(ptile)] = (float)N / D;
-    } whole_map_iterate_end;
+    /* Each tile of the target depends on the source only. */
+    map_stripes_run(smooth_int_map_stripe, FALSE, &pass);
 
     if (MAP_IS_ISOMETRIC) {
-      weight = weight_isometric;
+      pass.weight = weight_isometric;
     }
 
-    axe = !axe;
+    pass.axe = !pass.axe;
 
-    source_map = alt_int_map;
-    target_map = int_map;
+    pass.source_map = alt_int_map;
+    pass.target_map = int_map;
 
-  } while (!axe);
+  } while (!pass.axe);
 
   FC_FREE(alt_int_map);
 }
@@ -13,6 +13,9 @@
 #ifndef FC__UTILITIES_H
 #define FC__UTILITIES_H
 
+/* utility */
+#include "rand.h"
+
 typedef void (*tile_knowledge_cb)(struct tile *ptile);
 
 void regenerate_lakes(tile_knowledge_cb knowledge_cb);
@@ -87,6 +90,34 @@ struct terrain *pick_ocean(int depth);
 
 bool is_normal_nat_pos(int x, int y);
 
+/* Grid-wide passes can be split in stripes of native rows, which are
+ * handled by the worker threads of the server. The stripes have a fixed
+ * height, and each one draws from its own random stream, seeded from the
+ * main one. So a given map seed gives the same map whatever the number
+ * of threads is. */
+#define MAP_STRIPE_ROWS 8
+
+typedef void (*map_stripe_func)(int nat_y0, int nat_y1,
+                                RANDOM_STATE *rstate, void *data);
+void map_stripes_run(map_stripe_func func, bool random, void *data);
+
+/* Iterate over the tiles of the native rows [nat_y0, nat_y1), in the
+ * same order as whole_map_iterate(). */
+#define stripe_tiles_iterate(nat_y0, nat_y1, _tile)                         \
+{                                                                           \
+  int _tile##_nat_x, _tile##_nat_y;                                         \
+                                                                            \
+  for (_tile##_nat_y = (nat_y0); _tile##_nat_y < (nat_y1);                 \
+       _tile##_nat_y++) {                                                   \
+    for (_tile##_nat_x = 0; _tile##_nat_x < map.xsize; _tile##_nat_x++) {   \
+      struct tile *_tile = native_pos_to_tile(_tile##_nat_x,                \
+                                              _tile##_nat_y);
+
+#define stripe_tiles_iterate_end                                            \
+    }                                                                       \
+  }                                                                         \
+}
+
 /* int maps tools */
 void adjust_int_map_filtered(int *int_map, int int_map_max, void *data,
 				   bool (*filter)(const struct tile *ptile,
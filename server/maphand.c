@@ -59,6 +59,9 @@
 /* Suppress send_tile_info() during game_load() */
 static bool send_tile_suppressed = FALSE;
 
+static void really_send_tile_info(struct conn_list *dest, struct tile *ptile,
+                                  bool send_unknown);
+
 static void player_tile_init(struct tile *ptile, struct player *pplayer);
 static void give_tile_info_from_player_to_player(struct player *pfrom,
 						 struct player *pdest,
@@ -130,6 +133,8 @@ void climate_change(bool warming, int effect)
   log_verbose("Climate change: %s (%d)",
               warming ? "Global warming" : "Nuclear winter", effect);
 
+  send_tile_info_freeze();
+
   while (effect > 0 && (k--) > 0) {
     struct terrain *old, *candidates[2], *new;
     struct tile *ptile;
@@ -209,6 +214,8 @@ void climate_change(bool warming, int effect)
       effect--;
     }
   }
+
+  send_tile_info_thaw();
 }
 
 /***************************************************************
@@ -397,7 +404,7 @@ void send_all_known_tiles(struct conn_list *dest)
       conn_list_do_buffer(dest);
     }
 
-    send_tile_info(dest, ptile, FALSE);
+    really_send_tile_info(dest, ptile, FALSE);
   } whole_map_iterate_end;
 
   conn_list_do_unbuffer(dest);
@@ -415,6 +422,178 @@ bool send_tile_suppression(bool now)
   return formerly;
 }
 
+/****************************************************************************
+  Tile info held back while send_tile_info() is frozen, for one player or
+  for the global observers. 'dirty' marks the tiles to send, 'unknown' the
+  ones which must be sent even when not known; 'order' lists the dirty
+  tiles in the order they were first sent.
+****************************************************************************/
+struct tile_info_batch {
+  struct dbv dirty;
+  struct dbv unknown;
+  int *order;
+  int order_num;
+  int order_alloc;
+};
+
+static int tile_info_freeze_count = 0;
+static struct tile_info_batch *tile_info_batches[MAX_NUM_PLAYER_SLOTS];
+static struct tile_info_batch *tile_info_observer_batch = NULL;
+
+/* Tile info packets asked for while frozen, and really sent at thaw,
+ * counted per connection. */
+static int tile_info_requested = 0;
+static int tile_info_sent = 0;
+
+/****************************************************************************
+  Hold back send_tile_info() until the matching send_tile_info_thaw().
+  Calls can be nested.
+
+  Use this around operations which may change the same tiles many times,
+  like border updates: each tile is then sent at most once per
+  connection, with its final state. The packets the client needs in order
+  (tiles getting fogged or unfogged) are still sent at once.
+****************************************************************************/
+void send_tile_info_freeze(void)
+{
+  tile_info_freeze_count++;
+}
+
+/****************************************************************************
+  Mark a tile to be sent to the connection when thawing.
+****************************************************************************/
+static void tile_info_batch_mark(struct tile_info_batch **ppbatch,
+                                 const struct tile *ptile,
+                                 bool send_unknown)
+{
+  struct tile_info_batch *pbatch = *ppbatch;
+  int tindex = tile_index(ptile);
+
+  if (NULL == pbatch) {
+    pbatch = fc_calloc(1, sizeof(*pbatch));
+    dbv_init(&pbatch->dirty, MAP_INDEX_SIZE);
+    dbv_init(&pbatch->unknown, MAP_INDEX_SIZE);
+    *ppbatch = pbatch;
+  }
+
+  tile_info_requested++;
+  if (!dbv_isset(&pbatch->dirty, tindex)) {
+    dbv_set(&pbatch->dirty, tindex);
+    if (pbatch->order_num == pbatch->order_alloc) {
+      pbatch->order_alloc = MAX(64, 2 * pbatch->order_alloc);
+      pbatch->order = fc_realloc(pbatch->order, pbatch->order_alloc
+                                                * sizeof(*pbatch->order));
+    }
+    pbatch->order[pbatch->order_num++] = tindex;
+  }
+  if (send_unknown) {
+    dbv_set(&pbatch->unknown, tindex);
+  }
+}
+
+/****************************************************************************
+  Record a send_tile_info() call made while frozen.
+****************************************************************************/
+static void tile_info_batch_add(struct conn_list *dest,
+                                const struct tile *ptile,
+                                bool send_unknown)
+{
+  if (!dest) {
+    dest = game.est_connections;
+  }
+
+  conn_list_iterate(dest, pconn) {
+    struct player *pplayer = pconn->playing;
+
+    if (NULL != pplayer) {
+      tile_info_batch_mark(&tile_info_batches[player_index(pplayer)],
+                           ptile, send_unknown);
+    } else if (pconn->observer) {
+      tile_info_batch_mark(&tile_info_observer_batch, ptile, send_unknown);
+    }
+  } conn_list_iterate_end;
+}
+
+/****************************************************************************
+  Send the tiles of a batch to dest, and free it.
+****************************************************************************/
+static void tile_info_batch_send(struct tile_info_batch *pbatch,
+                                 struct conn_list *dest)
+{
+  int i;
+
+  conn_list_do_buffer(dest);
+  for (i = 0; i < pbatch->order_num; i++) {
+    int tindex = pbatch->order[i];
+
+    really_send_tile_info(dest, index_to_tile(tindex),
+                          dbv_isset(&pbatch->unknown, tindex));
+  }
+  conn_list_do_unbuffer(dest);
+
+  tile_info_sent += pbatch->order_num * conn_list_size(dest);
+}
+
+/****************************************************************************
+  Free a tile info batch.
+****************************************************************************/
+static void tile_info_batch_free(struct tile_info_batch *pbatch)
+{
+  dbv_free(&pbatch->dirty);
+  dbv_free(&pbatch->unknown);
+  free(pbatch->order);
+  free(pbatch);
+}
+
+/****************************************************************************
+  Send the tiles held back since the matching send_tile_info_freeze(),
+  each one once per connection.
+****************************************************************************/
+void send_tile_info_thaw(void)
+{
+  int i;
+
+  fc_assert_ret(0 < tile_info_freeze_count);
+
+  if (0 < --tile_info_freeze_count) {
+    return;
+  }
+
+  for (i = 0; i < ARRAY_SIZE(tile_info_batches); i++) {
+    struct tile_info_batch *pbatch = tile_info_batches[i];
+    struct player *pplayer = player_by_number(i);
+
+    if (NULL == pbatch) {
+      continue;
+    }
+    tile_info_batches[i] = NULL;
+
+    if (NULL != pplayer) {
+      tile_info_batch_send(pbatch, pplayer->connections);
+    }
+    tile_info_batch_free(pbatch);
+  }
+
+  if (NULL != tile_info_observer_batch) {
+    struct tile_info_batch *pbatch = tile_info_observer_batch;
+
+    tile_info_observer_batch = NULL;
+    conn_list_iterate(game.est_connections, pconn) {
+      if (NULL == pconn->playing && pconn->observer
+          && !conn_delta_group_follower(pconn)) {
+        tile_info_batch_send(pbatch, pconn->self);
+      }
+    } conn_list_iterate_end;
+    tile_info_batch_free(pbatch);
+  }
+
+  log_debug("send_tile_info_thaw(): %d tile info packets sent, "
+            "%d duplicates suppressed.", tile_info_sent,
+            tile_info_requested - tile_info_sent);
+  tile_info_requested = 0;
+  tile_info_sent = 0;
+}
+
 /**************************************************************************
   Send tile information to all the clients in dest which know and see
   the tile. If dest is NULL, sends to all clients (game.est_connections)
@@ -422,9 +601,32 @@ bool send_tile_suppression(bool now)
 
   Note that this function does not update the playermap.  For that call
   update_tile_knowledge().
+
+  While send_tile_info() is frozen, the tile is only marked to be sent at
+  the matching send_tile_info_thaw().
 **************************************************************************/
 void send_tile_info(struct conn_list *dest, struct tile *ptile,
                     bool send_unknown)
+{
+  if (send_tile_suppressed) {
+    return;
+  }
+
+  if (0 < tile_info_freeze_count) {
+    tile_info_batch_add(dest, ptile, send_unknown);
+    return;
+  }
+
+  really_send_tile_info(dest, ptile, send_unknown);
+}
+
+/**************************************************************************
+  Send tile information to all the clients in dest right now, see
+  send_tile_info(). This is used when the client needs the tile before
+  the packets which follow, for instance when it gets (un)fogged.
+**************************************************************************/
+static void really_send_tile_info(struct conn_list *dest, struct tile *ptile,
+                                  bool send_unknown)
 {
   struct packet_tile_info info;
   const struct player *owner;
@@ -453,6 +655,11 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
       continue;
     }
 
+    if (dest == game.est_connections && conn_delta_group_follower(pconn)) {
+      /* Gets what is sent to the first global observer. */
+      continue;
+    }
+
     if (!pplayer || map_is_known_and_seen(ptile, pplayer, V_MAIN)) {
       info.known = TILE_KNOWN_SEEN;
       info.continent = tile_continent(ptile);
@@ -487,21 +694,19 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
       info.known = TILE_KNOWN_UNSEEN;
       info.continent = tile_continent(ptile);
       owner = (game.server.foggedborders
-               ? plrtile->owner
+               ? player_tile_owner(plrtile)
                : tile_owner(ptile));
-      eowner = plrtile->extras_owner;
+      eowner = player_tile_extras_owner(plrtile);
       info.owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
       info.extras_owner = (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
       info.worked = (NULL != psite)
                     ? psite->identity
                     : IDENTITY_NUMBER_ZERO;
 
-      info.terrain = (NULL != plrtile->terrain)
-                      ? terrain_number(plrtile->terrain)
-                      : terrain_count();
-      info.resource = (NULL != plrtile->resource)
-                       ? resource_number(plrtile->resource)
-                       : resource_count();
+      info.terrain = (0 <= plrtile->terrain
+                      ? plrtile->terrain : terrain_count());
+      info.resource = (0 <= plrtile->resource
+                       ? plrtile->resource : resource_count());
 
       info.extras = plrtile->extras;
 
@@ -556,6 +761,139 @@ void send_map_info(struct conn_list *dest)
   lsend_packet_map_info(dest, &minfo);
 }
 
+/****************************************************************************
+  Vision changes held back while the vision is frozen, for one player.
+  'touched' marks the tiles with a pending change, which is accumulated in
+  'change'; 'order' lists those tiles in the order they were first changed.
+****************************************************************************/
+struct vision_batch {
+  struct dbv touched;
+  struct dbv reveal;            /* Some change could reveal the tile. */
+  v_radius_t *change;           /* Indexed by tile_index(). */
+  int *order;
+  int order_num;
+  int order_alloc;
+};
+
+static int vision_freeze_count = 0;
+static struct vision_batch *vision_batches[MAX_NUM_PLAYER_SLOTS];
+
+/****************************************************************************
+  Hold back the fog of war changes of map_vision_update() until the
+  matching map_vision_thaw(). Calls can be nested.
+
+  Use this around operations changing many vision sources without looking
+  at the visibility in between, like refreshing the vision of a whole
+  unit stack: the tiles get their net change applied only once, so a tile
+  covered by several sources is fogged or unfogged at most once.
+****************************************************************************/
+void map_vision_freeze(void)
+{
+  vision_freeze_count++;
+}
+
+/****************************************************************************
+  Free a vision batch without applying it.
+****************************************************************************/
+static void vision_batch_free(struct vision_batch *pbatch)
+{
+  dbv_free(&pbatch->touched);
+  dbv_free(&pbatch->reveal);
+  free(pbatch->change);
+  free(pbatch->order);
+  free(pbatch);
+}
+
+/****************************************************************************
+  Change the seen count of a tile for a player, or record the change for
+  map_vision_thaw() if the vision is frozen.
+****************************************************************************/
+static void vision_batch_change_seen(struct player *pplayer,
+                                     struct tile *ptile,
+                                     const v_radius_t change,
+                                     bool can_reveal_tiles)
+{
+  struct vision_batch *pbatch;
+  int tindex;
+
+  if (0 == vision_freeze_count) {
+    map_change_seen(pplayer, ptile, change, can_reveal_tiles);
+    return;
+  }
+
+  pbatch = vision_batches[player_index(pplayer)];
+  if (NULL == pbatch) {
+    pbatch = fc_calloc(1, sizeof(*pbatch));
+    dbv_init(&pbatch->touched, MAP_INDEX_SIZE);
+    dbv_init(&pbatch->reveal, MAP_INDEX_SIZE);
+    pbatch->change = fc_calloc(MAP_INDEX_SIZE, sizeof(*pbatch->change));
+    vision_batches[player_index(pplayer)] = pbatch;
+  }
+
+  tindex = tile_index(ptile);
+  if (!dbv_isset(&pbatch->touched, tindex)) {
+    dbv_set(&pbatch->touched, tindex);
+    if (pbatch->order_num == pbatch->order_alloc) {
+      pbatch->order_alloc = MAX(64, 2 * pbatch->order_alloc);
+      pbatch->order = fc_realloc(pbatch->order, pbatch->order_alloc
+                                                * sizeof(*pbatch->order));
+    }
+    pbatch->order[pbatch->order_num++] = tindex;
+  }
+
+  vision_layer_iterate(v) {
+    pbatch->change[tindex][v] += change[v];
+  } vision_layer_iterate_end;
+  if (can_reveal_tiles) {
+    dbv_set(&pbatch->reveal, tindex);
+  }
+}
+
+/****************************************************************************
+  Apply the changes held back since the matching map_vision_freeze(), one
+  player and one tile at a time. Tiles whose seen counts did not change
+  overall are left alone, unless they get revealed.
+****************************************************************************/
+void map_vision_thaw(void)
+{
+  fc_assert_ret(0 < vision_freeze_count);
+
+  if (0 < --vision_freeze_count) {
+    return;
+  }
+
+  players_iterate(pplayer) {
+    struct vision_batch *pbatch = vision_batches[player_index(pplayer)];
+    int i;
+
+    if (NULL == pbatch) {
+      continue;
+    }
+    /* Anything changed while applying goes to the map directly. */
+    vision_batches[player_index(pplayer)] = NULL;
+
+    conn_list_compression_freeze(pplayer->connections);
+    conn_list_do_buffer(pplayer->connections);
+    for (i = 0; i < pbatch->order_num; i++) {
+      int tindex = pbatch->order[i];
+      struct tile *ptile = index_to_tile(tindex);
+      bool can_reveal_tiles = dbv_isset(&pbatch->reveal, tindex);
+
+      if (0 == pbatch->change[tindex][V_MAIN]
+          && 0 == pbatch->change[tindex][V_INVIS]
+          && (!can_reveal_tiles || map_is_known(ptile, pplayer))) {
+        continue;
+      }
+      map_change_seen(pplayer, ptile, pbatch->change[tindex],
+                      can_reveal_tiles);
+    }
+    conn_list_do_unbuffer(pplayer->connections);
+    conn_list_compression_thaw(pplayer->connections);
+
+    vision_batch_free(pbatch);
+  } players_iterate_end;
+}
+
 /****************************************************************************
   Change the seen count of a tile for a pplayer. It will automatically
   handle the shared visions.
@@ -566,11 +904,11 @@ static void shared_vision_change_seen(struct player *pplayer,
                                       bool can_reveal_tiles)
 {
   map_change_own_seen(pplayer, ptile, change);
-  map_change_seen(pplayer, ptile, change, can_reveal_tiles);
+  vision_batch_change_seen(pplayer, ptile, change, can_reveal_tiles);
 
   players_iterate(pplayer2) {
     if (really_gives_vision(pplayer, pplayer2)) {
-      map_change_seen(pplayer2, ptile, change, can_reveal_tiles);
+      vision_batch_change_seen(pplayer2, ptile, change, can_reveal_tiles);
     }
   } players_iterate_end;
 }
@@ -673,7 +1011,7 @@ void map_show_tile(struct player *src_player, struct tile *ptile)
 	update_player_tile_knowledge(pplayer, ptile);
 	update_player_tile_last_seen(pplayer, ptile);
 
-        send_tile_info(pplayer->connections, ptile, FALSE);
+        really_send_tile_info(pplayer->connections, ptile, FALSE);
 
 	/* remove old cities that exist no more */
 	reality_check_city(pplayer, ptile);
@@ -722,7 +1060,7 @@ void map_hide_tile(struct player *src_player, struct tile *ptile)
 
       map_clear_known(ptile, pplayer);
 
-      send_tile_info(pplayer->connections, ptile, TRUE);
+      really_send_tile_info(pplayer->connections, ptile, TRUE);
     }
   } players_iterate_end;
 
@@ -791,7 +1129,7 @@ static inline int map_get_seen(const struct player *pplayer,
                                const struct tile *ptile,
                                enum vision_layer vlayer)
 {
-  return map_get_player_tile(ptile, pplayer)->seen_count[vlayer];
+  return pplayer->server.seen_count[tile_index(ptile)][vlayer];
 }
 
 /****************************************************************************
@@ -806,6 +1144,7 @@ void map_change_seen(struct player *pplayer,
                      bool can_reveal_tiles)
 {
   struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
+  short int *seen_count = pplayer->server.seen_count[tile_index(ptile)];
   bool revealing_tile = FALSE;
 
 #ifdef DEBUG
@@ -814,14 +1153,14 @@ void map_change_seen(struct player *pplayer,
             TILE_XY(ptile));
   vision_layer_iterate(v) {
     log_debug("  vision layer %d is changing from %d to %d.",
-              v, plrtile->seen_count[v], plrtile->seen_count[v] + change[v]);
+              v, seen_count[v], seen_count[v] + change[v]);
   } vision_layer_iterate_end;
 #endif /* DEBUG */
 
   vision_layer_iterate(v) {
     /* Avoid underflow. */
-    fc_assert(0 <= change[v] || -change[v] <= plrtile->seen_count[v]);
-    plrtile->seen_count[v] += change[v];
+    fc_assert(0 <= change[v] || -change[v] <= seen_count[v]);
+    seen_count[v] += change[v];
   } vision_layer_iterate_end;
 
   /* V_MAIN vision ranges must always be more than V_INVIS ranges
@@ -829,11 +1168,11 @@ void map_change_seen(struct player *pplayer,
    * seen count cannot be inferior to V_INVIS seen count.
    * Moreover, when the fog of war is disabled, V_MAIN has an extra
    * seen count point. */
-  fc_assert(plrtile->seen_count[V_INVIS] + !game.info.fogofwar
-            <= plrtile->seen_count[V_MAIN]);
+  fc_assert(seen_count[V_INVIS] + !game.info.fogofwar
+            <= seen_count[V_MAIN]);
 
   if (!map_is_known(ptile, pplayer)) {
-    if (0 < plrtile->seen_count[V_MAIN] && can_reveal_tiles) {
+    if (0 < seen_count[V_MAIN] && can_reveal_tiles) {
       log_debug("(%d, %d): revealing tile to player %s (nb %d).",
                 TILE_XY(ptile), player_name(pplayer),
                 player_number(pplayer));
@@ -848,7 +1187,7 @@ void map_change_seen(struct player *pplayer,
   /* Removes units out of vision. First, check V_INVIS layer because
    * we must remove all units before fog of war because clients expect
    * the tile is empty when it is fogged. */
-  if (0 > change[V_INVIS] && 0 == plrtile->seen_count[V_INVIS]) {
+  if (0 > change[V_INVIS] && 0 == seen_count[V_INVIS]) {
     log_debug("(%d, %d): hiding invisible units to player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer), player_number(pplayer));
 
@@ -859,7 +1198,7 @@ void map_change_seen(struct player *pplayer,
     } unit_list_iterate_end;
   }
 
-  if (0 > change[V_MAIN] && 0 == plrtile->seen_count[V_MAIN]) {
+  if (0 > change[V_MAIN] && 0 == seen_count[V_MAIN]) {
     log_debug("(%d, %d): fogging tile for player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer), player_number(pplayer));
 
@@ -871,19 +1210,19 @@ void map_change_seen(struct player *pplayer,
 
     /* Fog the tile. */
     update_player_tile_last_seen(pplayer, ptile);
-    send_tile_info(pplayer->connections, ptile, FALSE);
+    really_send_tile_info(pplayer->connections, ptile, FALSE);
     if (game.server.foggedborders) {
-      plrtile->owner = tile_owner(ptile);
+      player_tile_set_owner(plrtile, tile_owner(ptile));
     }
-    plrtile->extras_owner = base_owner(ptile);
+    player_tile_set_extras_owner(plrtile, base_owner(ptile));
   }
 
-  if ((revealing_tile && 0 < plrtile->seen_count[V_MAIN])
+  if ((revealing_tile && 0 < seen_count[V_MAIN])
       || (0 < change[V_MAIN]
-          /* plrtile->seen_count[V_MAIN] Always set to 1
+          /* seen_count[V_MAIN] Always set to 1
             * when the fog of war is disabled. */
           && (change[V_MAIN] + !game.info.fogofwar
-              == (plrtile->seen_count[V_MAIN])))) {
+              == (seen_count[V_MAIN])))) {
     struct city *pcity;
 
     log_debug("(%d, %d): unfogging tile for player %s (nb %d).",
@@ -894,7 +1233,7 @@ void map_change_seen(struct player *pplayer,
      * continent number before it can handle following packets
      */
     update_player_tile_knowledge(pplayer, ptile);
-    send_tile_info(pplayer->connections, ptile, FALSE);
+    really_send_tile_info(pplayer->connections, ptile, FALSE);
 
     /* Discover units. */
     unit_list_iterate(ptile->units, punit) {
@@ -911,9 +1250,9 @@ void map_change_seen(struct player *pplayer,
     }
   }
 
-  if ((revealing_tile && 0 < plrtile->seen_count[V_INVIS])
+  if ((revealing_tile && 0 < seen_count[V_INVIS])
       || (0 < change[V_INVIS]
-          && change[V_INVIS] == plrtile->seen_count[V_INVIS])) {
+          && change[V_INVIS] == seen_count[V_INVIS])) {
     log_debug("(%d, %d): revealing invisible units to player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer),
               player_number(pplayer));
@@ -936,7 +1275,7 @@ static inline int map_get_own_seen(const struct player *pplayer,
                                    const struct tile *ptile,
                                    enum vision_layer vlayer)
 {
-  return map_get_player_tile(ptile, pplayer)->own_seen[vlayer];
+  return pplayer->server.own_seen[tile_index(ptile)][vlayer];
 }
 
 /***************************************************************
@@ -946,10 +1285,10 @@ static void map_change_own_seen(struct player *pplayer,
                                 struct tile *ptile,
                                 const v_radius_t change)
 {
-  struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
+  short int *own_seen = pplayer->server.own_seen[tile_index(ptile)];
 
   vision_layer_iterate(v) {
-    plrtile->own_seen[v] += change[v];
+    own_seen[v] += change[v];
   } vision_layer_iterate_end;
 }
 
@@ -1023,6 +1362,12 @@ void player_map_init(struct player *pplayer)
   pplayer->server.private_map
     = fc_realloc(pplayer->server.private_map,
                  MAP_INDEX_SIZE * sizeof(*pplayer->server.private_map));
+  pplayer->server.seen_count
+    = fc_realloc(pplayer->server.seen_count,
+                 MAP_INDEX_SIZE * sizeof(*pplayer->server.seen_count));
+  pplayer->server.own_seen
+    = fc_realloc(pplayer->server.own_seen,
+                 MAP_INDEX_SIZE * sizeof(*pplayer->server.own_seen));
 
   whole_map_iterate(ptile) {
     player_tile_init(ptile, pplayer);
@@ -1053,6 +1398,13 @@ void player_map_free(struct player *pplayer)
           vision_site_owner(aplrtile->site) == pplayer) {
         change_playertile_site(aplrtile, NULL);
       }
+      /* Owners are remembered by player number, which may be reused. */
+      if (aplrtile && player_tile_owner(aplrtile) == pplayer) {
+        player_tile_set_owner(aplrtile, NULL);
+      }
+      if (aplrtile && player_tile_extras_owner(aplrtile) == pplayer) {
+        player_tile_set_extras_owner(aplrtile, NULL);
+      }
     } players_iterate_end;
 
     /* clear players knowledge */
@@ -1064,12 +1416,50 @@ void player_map_free(struct player *pplayer)
     }
   } whole_map_iterate_end;
 
+  if (NULL != vision_batches[player_index(pplayer)]) {
+    vision_batch_free(vision_batches[player_index(pplayer)]);
+    vision_batches[player_index(pplayer)] = NULL;
+  }
+
   free(pplayer->server.private_map);
   pplayer->server.private_map = NULL;
+  free(pplayer->server.seen_count);
+  pplayer->server.seen_count = NULL;
+  free(pplayer->server.own_seen);
+  pplayer->server.own_seen = NULL;
 
   dbv_free(&pplayer->tile_known);
 }
 
+/***************************************************************
+  Return the number of bytes used by the player's map: the
+  remembered tiles, the seen counts, the known tiles and the
+  remembered cities, whose number is returned in 'num_sites'.
+***************************************************************/
+size_t player_map_memory(const struct player *pplayer, int *num_sites)
+{
+  size_t bytes = 0;
+
+  *num_sites = 0;
+  if (!pplayer->server.private_map) {
+    return 0;
+  }
+
+  bytes += MAP_INDEX_SIZE * sizeof(*pplayer->server.private_map);
+  bytes += MAP_INDEX_SIZE * sizeof(*pplayer->server.seen_count);
+  bytes += MAP_INDEX_SIZE * sizeof(*pplayer->server.own_seen);
+  bytes += _BV_BYTES(MAP_INDEX_SIZE);
+
+  whole_map_iterate(ptile) {
+    if (NULL != map_get_player_tile(ptile, pplayer)->site) {
+      (*num_sites)++;
+    }
+  } whole_map_iterate_end;
+  bytes += *num_sites * sizeof(struct vision_site);
+
+  return bytes;
+}
+
 /***************************************************************
   We need to use fogofwar_old here, so the player's tiles get
   in the same state as the other players' tiles.
@@ -1077,18 +1467,58 @@ void player_map_free(struct player *pplayer)
 static void player_tile_init(struct tile *ptile, struct player *pplayer)
 {
   struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
+  short int *seen_count = pplayer->server.seen_count[tile_index(ptile)];
 
-  plrtile->terrain = T_UNKNOWN;
-  plrtile->resource = NULL;
-  plrtile->owner = NULL;
-  plrtile->extras_owner = NULL;
+  player_tile_set_terrain(plrtile, T_UNKNOWN);
+  player_tile_set_resource(plrtile, NULL);
+  player_tile_set_owner(plrtile, NULL);
+  player_tile_set_extras_owner(plrtile, NULL);
   plrtile->site = NULL;
   BV_CLR_ALL(plrtile->extras);
   plrtile->last_updated = game.info.year;
 
-  plrtile->seen_count[V_MAIN] = !game.server.fogofwar_old;
-  plrtile->seen_count[V_INVIS] = 0;
-  memcpy(plrtile->own_seen, plrtile->seen_count, sizeof(v_radius_t));
+  seen_count[V_MAIN] = !game.server.fogofwar_old;
+  seen_count[V_INVIS] = 0;
+  memcpy(pplayer->server.own_seen[tile_index(ptile)], seen_count,
+         sizeof(v_radius_t));
+}
+
+/****************************************************************************
+  Set the terrain remembered by the player.
+****************************************************************************/
+void player_tile_set_terrain(struct player_tile *plrtile,
+                             const struct terrain *pterrain)
+{
+  plrtile->terrain = (NULL != pterrain ? terrain_number(pterrain) : -1);
+}
+
+/****************************************************************************
+  Set the resource remembered by the player.
+****************************************************************************/
+void player_tile_set_resource(struct player_tile *plrtile,
+                              const struct resource *presource)
+{
+  plrtile->resource = (NULL != presource ? resource_number(presource) : -1);
+}
+
+/****************************************************************************
+  Set the tile owner remembered by the player.
+****************************************************************************/
+void player_tile_set_owner(struct player_tile *plrtile,
+                           const struct player *powner)
+{
+  plrtile->owner = (NULL != powner ? player_index(powner)
+                                   : PLAYER_TILE_NOBODY);
+}
+
+/****************************************************************************
+  Set the owner of the tile's extras remembered by the player.
+****************************************************************************/
+void player_tile_set_extras_owner(struct player_tile *plrtile,
+                                  const struct player *powner)
+{
+  plrtile->extras_owner = (NULL != powner ? player_index(powner)
+                                          : PLAYER_TILE_NOBODY);
 }
 
 /****************************************************************************
@@ -1139,20 +1569,20 @@ bool update_player_tile_knowledge(struct player *pplayer, struct tile *ptile)
   struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
   struct player *owner = (game.server.foggedborders
                           && !map_is_known_and_seen(ptile, pplayer, V_MAIN)
-                          ? plrtile->owner
+                          ? player_tile_owner(plrtile)
                           : tile_owner(ptile));
   struct player *eowner = base_owner(ptile);
 
-  if (plrtile->terrain != ptile->terrain
+  if (player_tile_terrain(plrtile) != tile_terrain(ptile)
       || !BV_ARE_EQUAL(plrtile->extras, ptile->extras)
-      || plrtile->resource != ptile->resource
-      || plrtile->owner != owner
-      || plrtile->extras_owner != eowner) {
-    plrtile->terrain = ptile->terrain;
+      || player_tile_resource(plrtile) != tile_resource(ptile)
+      || player_tile_owner(plrtile) != owner
+      || player_tile_extras_owner(plrtile) != eowner) {
+    player_tile_set_terrain(plrtile, tile_terrain(ptile));
     plrtile->extras = ptile->extras;
-    plrtile->resource = ptile->resource;
-    plrtile->owner = owner;
-    plrtile->extras_owner = eowner;
+    player_tile_set_resource(plrtile, tile_resource(ptile));
+    player_tile_set_owner(plrtile, owner);
+    player_tile_set_extras_owner(plrtile, eowner);
 
     return TRUE;
   }
@@ -1231,7 +1661,7 @@ static void really_give_tile_info_from_player_to_player(struct player *pfrom,
       dest_tile->extras   = from_tile->extras;
       dest_tile->resource = from_tile->resource;
       dest_tile->last_updated = from_tile->last_updated;
-      send_tile_info(pdest->connections, ptile, FALSE);
+      really_send_tile_info(pdest->connections, ptile, FALSE);
 
       /* update and send city knowledge */
       /* remove outdated cities */
@@ -1850,6 +2280,8 @@ void map_claim_border(struct tile *ptile, struct player *owner)
     return;
   }
 
+  send_tile_info_freeze();
+
   circle_dxyr_iterate(ptile, radius_sq, dtile, dx, dy, dr) {
     struct tile *dclaimer = tile_claimer(dtile);
 
@@ -1904,6 +2336,8 @@ void map_claim_border(struct tile *ptile, struct player *owner)
       }
     }
   } circle_dxyr_iterate_end;
+
+  send_tile_info_thaw();
 }
 
 /*************************************************************************
@@ -1922,6 +2356,9 @@ void map_calculate_borders(void)
 
   log_verbose("map_calculate_borders()");
 
+  /* Overlapping sources claim the same tiles: send them once at the end. */
+  send_tile_info_freeze();
+
   whole_map_iterate(ptile) {
     if (is_border_source(ptile)) {
       map_claim_border(ptile, ptile->owner);
@@ -1931,6 +2368,8 @@ void map_calculate_borders(void)
   log_verbose("map_calculate_borders() workers");
   city_thaw_workers_queue();
   city_refresh_queue_processing();
+
+  send_tile_info_thaw();
 }
 
 /****************************************************************************
@@ -26,23 +26,43 @@ struct section_file;
 struct conn_list;
 
 
+/* What a player remembers about a tile. There is one of these for every
+ * player and tile, so it is kept small: types and players are stored as
+ * their numbers; use the accessors below. The seen counts are kept apart,
+ * in player->server.seen_count and player->server.own_seen. */
 struct player_tile {
   struct vision_site *site;		/* NULL for no vision site */
-  struct resource *resource;		/* NULL for no resource */
-  struct terrain *terrain;		/* NULL for unknown tiles */
-  struct player *owner; 		/* NULL for unowned */
-  struct player *extras_owner;
   bv_extras extras;
-
-  /* If you build a city with an unknown square within city radius
-     the square stays unknown. However, we still have to keep count
-     of the seen points, so they are kept in here. When the tile
-     then becomes known they are moved to seen. */
-  v_radius_t own_seen;
-  v_radius_t seen_count;
   short last_updated;
+  signed char terrain;                  /* -1 for unknown tiles */
+  signed char resource;                 /* -1 for no resource */
+  unsigned char owner;                  /* PLAYER_TILE_NOBODY for unowned */
+  unsigned char extras_owner;           /* PLAYER_TILE_NOBODY for none */
 };
 
+#define PLAYER_TILE_NOBODY 255
+
+FC_STATIC_ASSERT(MAX_NUM_TERRAINS <= 127, player_tile_terrain_too_small);
+FC_STATIC_ASSERT(MAX_NUM_RESOURCES <= 127, player_tile_resource_too_small);
+FC_STATIC_ASSERT(MAX_NUM_PLAYER_SLOTS < PLAYER_TILE_NOBODY,
+                 player_tile_owner_too_small);
+
+#define player_tile_terrain(_plrtile) terrain_by_number((_plrtile)->terrain)
+#define player_tile_resource(_plrtile)                                      \
+  resource_by_number((_plrtile)->resource)
+#define player_tile_owner(_plrtile) player_by_number((_plrtile)->owner)
+#define player_tile_extras_owner(_plrtile)                                  \
+  player_by_number((_plrtile)->extras_owner)
+
+void player_tile_set_terrain(struct player_tile *plrtile,
+                             const struct terrain *pterrain);
+void player_tile_set_resource(struct player_tile *plrtile,
+                              const struct resource *presource);
+void player_tile_set_owner(struct player_tile *plrtile,
+                           const struct player *powner);
+void player_tile_set_extras_owner(struct player_tile *plrtile,
+                                  const struct player *powner);
+
 void global_warming(int effect);
 void nuclear_winter(int effect);
 void climate_change(bool warming, int effect);
@@ -58,6 +78,8 @@ void send_all_known_tiles(struct conn_list *dest);
 bool send_tile_suppression(bool now);
 void send_tile_info(struct conn_list *dest, struct tile *ptile,
                     bool send_unknown);
+void send_tile_info_freeze(void);
+void send_tile_info_thaw(void);
 
 void send_map_info(struct conn_list *dest);
 
@@ -69,6 +91,8 @@ void map_vision_update(struct player *pplayer, struct tile *ptile,
                        const v_radius_t old_radius_sq,
                        const v_radius_t new_radius_sq,
                        bool can_reveal_tiles);
+void map_vision_freeze(void);
+void map_vision_thaw(void);
 void map_show_all(struct player *pplayer);
 
 bool map_is_known_and_seen(const struct tile *ptile,
@@ -82,6 +106,7 @@ void show_map_to_all(void);
 
 void player_map_init(struct player *pplayer);
 void player_map_free(struct player *pplayer);
+size_t player_map_memory(const struct player *pplayer, int *num_sites);
 
 struct vision_site *map_get_player_city(const struct tile *ptile,
 					const struct player *pplayer);
@@ -28,6 +28,7 @@
 
 /* common */
 #include "citizens.h"
+#include "city.h"
 #include "diptreaty.h"
 #include "game.h"
 #include "government.h"
@@ -323,6 +324,7 @@ static void finish_revolution(struct player *pplayer)
 
   pplayer->government = government;
   pplayer->target_government = NULL;
+  city_refresh_generation_bump();
 
   log_debug("Revolution finished for %s. Government is %s. "
             "Revofin %d (%d).", player_name(pplayer),
@@ -406,6 +408,7 @@ void handle_player_change_government(struct player *pplayer, int government)
 
   pplayer->government = game.government_during_revolution;
   pplayer->target_government = gov;
+  city_refresh_generation_bump();
   pplayer->revolution_finishes = game.info.turn + turns;
 
   log_debug("Revolution started for %s. Target government is %s. "
@@ -1257,6 +1260,8 @@ void server_player_init(struct player *pplayer, bool initmap,
 
   player_map_free(pplayer);
   pplayer->server.private_map = NULL;
+  pplayer->server.seen_count = NULL;
+  pplayer->server.own_seen = NULL;
 
   if (initmap) {
     player_map_init(pplayer);
@@ -2227,6 +2232,7 @@ static struct player *split_player(struct player *pplayer)
   sz_strlcpy(cplayer->username, ANON_USER_NAME);
   cplayer->is_connected = FALSE;
   cplayer->government = nation_of_player(cplayer)->init_government;
+  city_refresh_generation_bump();
   fc_assert(cplayer->revolution_finishes < 0);
   /* No capital for the splitted player. */
   cplayer->server.capital = FALSE;
@@ -2299,6 +2305,7 @@ static struct player *split_player(struct player *pplayer)
     pplayer->target_government = pplayer->government;
     pplayer->government = game.government_during_revolution;
     pplayer->revolution_finishes = game.info.turn + 1;
+    city_refresh_generation_bump();
   }
   player_research_get(pplayer)->bulbs_researched = 0;
   BV_CLR_ALL(pplayer->real_embassy);   /* all embassies destroyed */
@@ -117,20 +117,23 @@ static void check_fow(const char *file, const char *function, int line)
 
   whole_map_iterate(ptile) {
     players_iterate(pplayer) {
-      struct player_tile *plr_tile = map_get_player_tile(ptile, pplayer);
+      const short int *seen_count
+        = pplayer->server.seen_count[tile_index(ptile)];
+      const short int *own_seen
+        = pplayer->server.own_seen[tile_index(ptile)];
 
       vision_layer_iterate(v) {
         /* underflow of unsigned int */
-        SANITY_TILE(ptile, plr_tile->seen_count[v] < 30000);
-        SANITY_TILE(ptile, plr_tile->own_seen[v] < 30000);
-        SANITY_TILE(ptile, plr_tile->own_seen[v] <= plr_tile->seen_count[v]);
+        SANITY_TILE(ptile, seen_count[v] < 30000);
+        SANITY_TILE(ptile, own_seen[v] < 30000);
+        SANITY_TILE(ptile, own_seen[v] <= seen_count[v]);
       } vision_layer_iterate_end;
 
       /* Lots of server bits depend on this. */
-      SANITY_TILE(ptile, plr_tile->seen_count[V_INVIS]
-		   <= plr_tile->seen_count[V_MAIN]);
-      SANITY_TILE(ptile, plr_tile->own_seen[V_INVIS]
-		   <= plr_tile->own_seen[V_MAIN]);
+      SANITY_TILE(ptile, seen_count[V_INVIS]
+		   <= seen_count[V_MAIN]);
+      SANITY_TILE(ptile, own_seen[V_INVIS]
+		   <= own_seen[V_MAIN]);
     } players_iterate_end;
   } whole_map_iterate_end;
 
@@ -753,6 +753,9 @@ static void map_load_rivers_overlay(struct section_file *file,
   }
 
   load_river_overlay = FALSE;
+
+  /* The rivers were set directly. */
+  tile_move_cost_generation_bump();
 }
 
 /****************************************************************************
@@ -889,6 +892,19 @@ static void set_savegame_old_resource(struct resource **r,
   }
 }
 
+/****************************************************************************
+  As set_savegame_old_resource(), for the resource a player remembers.
+****************************************************************************/
+static void set_savegame_old_player_resource(struct player_tile *plrtile,
+					     const struct terrain *terrain,
+					     char ch, int n)
+{
+  struct resource *presource = player_tile_resource(plrtile);
+
+  set_savegame_old_resource(&presource, terrain, ch, n);
+  player_tile_set_resource(plrtile, presource);
+}
+
 /****************************************************************************
   Return the resource for the given identifier.
 ****************************************************************************/
@@ -1011,6 +1027,9 @@ static void map_load(struct section_file *file,
                     set_savegame_bases(&ptile->extras, ch, base_order + 4 * j));
     } bases_halfbyte_iterate_end;
   }
+
+  /* The terrains and extras of the tiles were set directly. */
+  tile_move_cost_generation_bump();
 }
 
 /****************************************************************************
@@ -2728,14 +2747,14 @@ static void player_load_vision(struct player *plr, int plrno,
     LOAD_MAP_DATA(ch, nat_y, ptile,
 		  secfile_lookup_str(file, "player%d.map_t%03d",
 				     plrno, nat_y),
-		  map_get_player_tile(ptile, plr)->terrain =
-		  char2terrain(ch));
+		  player_tile_set_terrain(map_get_player_tile(ptile, plr),
+		                          char2terrain(ch)));
 
     if (special_order) {
       LOAD_MAP_DATA(ch, nat_y, ptile,
 	secfile_lookup_str(file, "player%d.map_res%03d", plrno, nat_y),
-	map_get_player_tile(ptile, plr)->resource
-		    = identifier_to_resource(ch));
+	player_tile_set_resource(map_get_player_tile(ptile, plr),
+	                         identifier_to_resource(ch)));
 
       special_halfbyte_iterate(j, num_special_types) {
 	char buf[32]; /* enough for sprintf() below */
@@ -2762,12 +2781,12 @@ static void player_load_vision(struct player *plr, int plrno,
 			       ch, default_specials + 8));
       LOAD_MAP_DATA(ch, nat_y, ptile,
 	secfile_lookup_str(file, "map.l%03d", nat_y),
-	set_savegame_old_resource(&map_get_player_tile(ptile, plr)->resource,
-				  ptile->terrain, ch, 0));
+	set_savegame_old_player_resource(map_get_player_tile(ptile, plr),
+					 ptile->terrain, ch, 0));
       LOAD_MAP_DATA(ch, nat_y, ptile,
 	secfile_lookup_str(file, "map.n%03d", nat_y),
-	set_savegame_old_resource(&map_get_player_tile(ptile, plr)->resource,
-				  ptile->terrain, ch, 1));
+	set_savegame_old_player_resource(map_get_player_tile(ptile, plr),
+					 ptile->terrain, ch, 1));
     }
 
     if (has_capability("bases", savefile_options)) {
@@ -2798,7 +2817,8 @@ static void player_load_vision(struct player *plr, int plrno,
     if (game.server.foggedborders) {
       LOAD_MAP_DATA(ch, nat_y, ptile,
           secfile_lookup_str(file, "player%d.map_owner%03d", plrno, nat_y),
-          map_get_player_tile(ptile, plr)->owner = identifier_to_player(ch));
+          player_tile_set_owner(map_get_player_tile(ptile, plr),
+                                identifier_to_player(ch)));
     }
 
     /* get 4-bit segments of 16-bit "updated" field */
@@ -221,8 +221,9 @@ extern bool sg_success;
  *                  will be the the y coordinate
  * Example:
  *   LOAD_MAP_CHAR(ch, ptile,
- *                 map_get_player_tile(ptile, plr)->terrain
- *                   = char2terrain(ch), file, "player%d.map_t%04d", plrno);
+ *                 player_tile_set_terrain(map_get_player_tile(ptile, plr),
+ *                                         char2terrain(ch)),
+ *                 file, "player%d.map_t%04d", plrno);
  *
  * Note: some (but not all) of the code this is replacing used to skip over
  *       lines that did not exist. This allowed for backward-compatibility.
@@ -503,6 +504,9 @@ void savegame2_load(struct section_file *file)
     savegame2_load_real(file);
   }
 
+  /* The terrains and extras of the tiles are set directly. */
+  tile_move_cost_generation_bump();
+
 #ifdef DEBUG_TIMERS
   timer_stop(loadtimer);
   log_debug("Loading secfile in %.3f seconds.", timer_read_seconds(loadtimer));
@@ -5607,14 +5611,14 @@ static void sg_load_player_vision(struct loaddata *loading,
 
   /* Load player map (terrain). */
   LOAD_MAP_CHAR(ch, ptile,
-                map_get_player_tile(ptile, plr)->terrain
-                  = char2terrain(ch), loading->file,
+                player_tile_set_terrain(map_get_player_tile(ptile, plr),
+                                        char2terrain(ch)), loading->file,
                 "player%d.map_t%04d", plrno);
 
   /* Load player map (resources). */
   LOAD_MAP_CHAR(ch, ptile,
-                map_get_player_tile(ptile, plr)->resource
-                  = char2resource(ch), loading->file,
+                player_tile_set_resource(map_get_player_tile(ptile, plr),
+                                         char2resource(ch)), loading->file,
                 "player%d.map_res%04d", plrno);
 
   if (loading->version >= 30) {
@@ -5682,12 +5686,13 @@ static void sg_load_player_vision(struct loaddata *loading,
         sg_failure_ret('\0' != token[0],
                        "Savegame corrupt - map size not correct.");
         if (strcmp(token, "-") == 0) {
-          map_get_player_tile(ptile, plr)->owner = NULL;
+          player_tile_set_owner(map_get_player_tile(ptile, plr), NULL);
         } else  {
           sg_failure_ret(str_to_int(token, &number),
                          "Savegame corrupt - got tile owner=%s in (%d, %d).",
                          token, x, y);
-          map_get_player_tile(ptile, plr)->owner = player_by_number(number);
+          player_tile_set_owner(map_get_player_tile(ptile, plr),
+                                player_by_number(number));
         }
 
         if (loading->version >= 30) {
@@ -5695,12 +5700,14 @@ static void sg_load_player_vision(struct loaddata *loading,
           sg_failure_ret('\0' != token2[0],
                          "Savegame corrupt - map size not correct.");
           if (strcmp(token2, "-") == 0) {
-            map_get_player_tile(ptile, plr)->extras_owner = NULL;
+            player_tile_set_extras_owner(map_get_player_tile(ptile, plr),
+                                         NULL);
           } else  {
             sg_failure_ret(str_to_int(token2, &number),
                            "Savegame corrupt - got extras owner=%s in (%d, %d).",
                            token, x, y);
-            map_get_player_tile(ptile, plr)->extras_owner = player_by_number(number);
+            player_tile_set_extras_owner(map_get_player_tile(ptile, plr),
+                                         player_by_number(number));
           }
         } else {
           map_get_player_tile(ptile, plr)->extras_owner
@@ -5868,12 +5875,14 @@ static void sg_save_player_vision(struct savedata *saving,
 
   /* Save the map (terrain). */
   SAVE_MAP_CHAR(ptile,
-                terrain2char(map_get_player_tile(ptile, plr)->terrain),
+                terrain2char(player_tile_terrain(
+                                 map_get_player_tile(ptile, plr))),
                 saving->file, "player%d.map_t%04d", plrno);
 
   /* Save the map (resources). */
   SAVE_MAP_CHAR(ptile,
-                resource2char(map_get_player_tile(ptile, plr)->resource),
+                resource2char(player_tile_resource(
+                                  map_get_player_tile(ptile, plr))),
                 saving->file, "player%d.map_res%04d", plrno);
 
   if (game.server.foggedborders) {
@@ -5889,11 +5898,11 @@ static void sg_save_player_vision(struct savedata *saving,
         struct tile *ptile = native_pos_to_tile(x, y);
         struct player_tile *plrtile = map_get_player_tile(ptile, plr);
 
-        if (plrtile == NULL || plrtile->owner == NULL) {
+        if (plrtile == NULL || player_tile_owner(plrtile) == NULL) {
           strcpy(token, "-");
         } else {
           fc_snprintf(token, sizeof(token), "%d",
-                      player_number(plrtile->owner));
+                      player_number(player_tile_owner(plrtile)));
         }
         strcat(line, token);
         if (x < map.xsize) {
@@ -5913,11 +5922,11 @@ static void sg_save_player_vision(struct savedata *saving,
         struct tile *ptile = native_pos_to_tile(x, y);
         struct player_tile *plrtile = map_get_player_tile(ptile, plr);
 
-        if (plrtile == NULL || plrtile->extras_owner == NULL) {
+        if (plrtile == NULL || player_tile_extras_owner(plrtile) == NULL) {
           strcpy(token, "-");
         } else {
           fc_snprintf(token, sizeof(token), "%d",
-                      player_number(plrtile->extras_owner));
+                      player_number(player_tile_extras_owner(plrtile)));
         }
         strcat(line, token);
         if (x < map.xsize) {
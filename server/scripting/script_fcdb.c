@@ -38,8 +38,10 @@
 #endif
 
 /* utility */
+#include "fcthread.h"
 #include "log.h"
 #include "md5.h"
+#include "mem.h"
 #include "registry.h"
 #include "string_vector.h"
 
@@ -64,6 +66,7 @@
 
 #define SCRIPT_FCDB_LUA_FILE "database.lua"
 
+static bool script_fcdb_init_locked(const char *fcdb_luafile);
 static void script_fcdb_functions_define(void);
 static bool script_fcdb_functions_check(const char *fcdb_luafile);
 
@@ -72,9 +75,16 @@ static void script_fcdb_cmd_reply(struct fc_lua *lfcl, enum log_level level,
             fc__attribute((__format__ (__printf__, 3, 4)));
 
 /*****************************************************************************
-  Lua virtual machine state.
+  Lua virtual machine state. The authentication calls come from the auth
+  worker thread (see auth.c), the server commands from the main thread;
+  'fcl_mutex' keeps them apart.
 *****************************************************************************/
 static struct fc_lua *fcl = NULL;
+static fc_mutex fcl_mutex;
+static bool fcl_mutex_initialized = FALSE;
+
+/* Where script_fcdb_msg_queue() puts the messages of the current call. */
+static struct script_fcdb_msg_list *fcl_msgs = NULL;
 
 /*****************************************************************************
   Add fcdb callback functions; these must be defined in the lua script
@@ -181,6 +191,29 @@ static void script_fcdb_cmd_reply(struct fc_lua *lfcl, enum log_level level,
 bool script_fcdb_init(const char *fcdb_luafile)
 {
 #ifdef HAVE_FCDB
+  bool success;
+
+  if (!fcl_mutex_initialized) {
+    fc_init_mutex(&fcl_mutex);
+    fcl_mutex_initialized = TRUE;
+  }
+
+  fc_allocate_mutex(&fcl_mutex);
+  success = script_fcdb_init_locked(fcdb_luafile);
+  fc_release_mutex(&fcl_mutex);
+
+  return success;
+#else
+  return TRUE;
+#endif /* HAVE_FCDB */
+}
+
+#ifdef HAVE_FCDB
+/*****************************************************************************
+  script_fcdb_init() with 'fcl_mutex' held.
+*****************************************************************************/
+static bool script_fcdb_init_locked(const char *fcdb_luafile)
+{
   if (fcl != NULL) {
     fc_assert_ret_val(fcl->state != NULL, FALSE);
 
@@ -232,32 +265,123 @@ bool script_fcdb_init(const char *fcdb_luafile)
     script_fcdb_free();
     return FALSE;
   }
-#endif /* HAVE_FCDB */
 
   return TRUE;
 }
+#endif /* HAVE_FCDB */
+
+#ifdef HAVE_FCDB
+/*****************************************************************************
+  Keep the message for script_fcdb_msgs_output(), instead of logging it
+  from the thread running the script. Called with 'fcl_mutex' held.
+*****************************************************************************/
+static void script_fcdb_msg_queue(struct fc_lua *lfcl, enum log_level level,
+                                  const char *format, ...)
+{
+  struct script_fcdb_msg *pmsg;
+  va_list args;
+  char buf[1024];
+
+  fc_assert_ret(NULL != fcl_msgs);
+
+  if (!log_do_output_for_level(level)) {
+    return;
+  }
+
+  va_start(args, format);
+  fc_vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+
+  pmsg = fc_malloc(sizeof(*pmsg));
+  pmsg->level = level;
+  pmsg->text = fc_strdup(buf);
+  script_fcdb_msg_list_append(fcl_msgs, pmsg);
+}
+
+/*****************************************************************************
+  Call a lua function. If 'msgs' is not NULL, the messages of the script
+  are added to it rather than logged.
+*****************************************************************************/
+static enum fcdb_status script_fcdb_call_valist(struct script_fcdb_msg_list
+                                                *msgs,
+                                                const char *func_name,
+                                                int nargs, va_list args)
+{
+  enum fcdb_status status = FCDB_ERROR; /* Default return value. */
+  bool success = FALSE;
+  int ret;
+
+  if (!fcl_mutex_initialized) {
+    /* Not initialized. */
+    return FCDB_ERROR;
+  }
+
+  fc_allocate_mutex(&fcl_mutex);
+  if (fcl != NULL) {
+    luascript_log_func_t save_output_fct = fcl->output_fct;
+
+    if (NULL != msgs) {
+      fcl->output_fct = script_fcdb_msg_queue;
+      fcl_msgs = msgs;
+    }
+    success = luascript_func_call_valist(fcl, func_name, &ret, nargs, args);
+    fcl->output_fct = save_output_fct;
+    fcl_msgs = NULL;
+  }
+  fc_release_mutex(&fcl_mutex);
+
+  if (success && fcdb_status_is_valid(ret)) {
+    status = (enum fcdb_status) ret;
+  }
+
+  return status;
+}
+#endif /* HAVE_FCDB */
 
 /*****************************************************************************
   Call a lua function.
 
   Example call to the lua function 'user_load()':
     script_fcdb_call("user_load", 1, API_TYPE_CONNECTION, pconn);
+
+  Must be called from the main thread, as the messages of the script are
+  logged (and maybe sent to the clients) right away.
 *****************************************************************************/
 enum fcdb_status script_fcdb_call(const char *func_name, int nargs, ...)
 {
 #ifdef HAVE_FCDB
-  enum fcdb_status status = FCDB_ERROR; /* Default return value. */
-  bool success;
-  int ret;
-
+  enum fcdb_status status;
   va_list args;
+
   va_start(args, nargs);
-  success = luascript_func_call_valist(fcl, func_name, &ret, nargs, args);
+  status = script_fcdb_call_valist(NULL, func_name, nargs, args);
   va_end(args);
 
-  if (success && fcdb_status_is_valid(ret)) {
-    status = (enum fcdb_status) ret;
-  }
+  return status;
+#else
+  return FCDB_SUCCESS_TRUE;
+#endif /* HAVE_FCDB */
+}
+
+/*****************************************************************************
+  Like script_fcdb_call(), but the messages of the script are added to
+  'msgs', to be output later by script_fcdb_msgs_output() from the main
+  thread. May be called from any thread; the calls are made one at a
+  time.
+*****************************************************************************/
+enum fcdb_status script_fcdb_call_queued(struct script_fcdb_msg_list *msgs,
+                                         const char *func_name,
+                                         int nargs, ...)
+{
+#ifdef HAVE_FCDB
+  enum fcdb_status status;
+  va_list args;
+
+  fc_assert_ret_val(NULL != msgs, FCDB_ERROR);
+
+  va_start(args, nargs);
+  status = script_fcdb_call_valist(msgs, func_name, nargs, args);
+  va_end(args);
 
   return status;
 #else
@@ -265,12 +389,32 @@ enum fcdb_status script_fcdb_call(const char *func_name, int nargs, ...)
 #endif /* HAVE_FCDB */
 }
 
+/*****************************************************************************
+  Log the messages queued by script_fcdb_call_queued() and empty the
+  list. Must be called from the main thread.
+*****************************************************************************/
+void script_fcdb_msgs_output(struct script_fcdb_msg_list *msgs)
+{
+  script_fcdb_msg_list_iterate(msgs, pmsg) {
+    log_base(pmsg->level, "%s", pmsg->text);
+    free(pmsg->text);
+    free(pmsg);
+  } script_fcdb_msg_list_iterate_end;
+  script_fcdb_msg_list_clear(msgs);
+}
+
 /*****************************************************************************
   Free the scripting data.
 *****************************************************************************/
 void script_fcdb_free(void)
 {
 #ifdef HAVE_FCDB
+  if (!fcl_mutex_initialized) {
+    /* Nothing to free. */
+    return;
+  }
+
+  fc_allocate_mutex(&fcl_mutex);
   if (script_fcdb_call("database_free", 0) != FCDB_SUCCESS_TRUE) {
     log_error("Error closing the database connection. Continuing anyway ...");
   }
@@ -280,6 +424,7 @@ void script_fcdb_free(void)
     luascript_destroy(fcl);
     fcl = NULL;
   }
+  fc_release_mutex(&fcl_mutex);
 #endif /* HAVE_FCDB */
 }
 
@@ -294,6 +439,16 @@ bool script_fcdb_do_string(struct connection *caller, const char *str)
   struct connection *save_caller;
   luascript_log_func_t save_output_fct;
 
+  if (!fcl_mutex_initialized) {
+    return FALSE;
+  }
+
+  fc_allocate_mutex(&fcl_mutex);
+  if (fcl == NULL) {
+    fc_release_mutex(&fcl_mutex);
+    return FALSE;
+  }
+
   /* Set a log callback function which allows to send the results of the
    * command to the clients. */
   save_caller = fcl->caller;
@@ -306,6 +461,7 @@ bool script_fcdb_do_string(struct connection *caller, const char *str)
   /* Reset the changes. */
   fcl->caller = save_caller;
   fcl->output_fct = save_output_fct;
+  fc_release_mutex(&fcl_mutex);
 
   return (status == 0);
 #else
@@ -15,6 +15,7 @@
 #define FC__SCRIPT_FCDB_H
 
 /* utility */
+#include "log.h"                /* enum log_level */
 #include "support.h"            /* fc__attribute() */
 
 /* server */
@@ -30,9 +31,27 @@
 #define SPECENUM_VALUE2 FCDB_SUCCESS_FALSE
 #include "specenum_gen.h"
 
+/* A message of the script held back by script_fcdb_call_queued(). */
+struct script_fcdb_msg {
+  enum log_level level;
+  char *text;
+};
+
+#define SPECLIST_TAG script_fcdb_msg
+#define SPECLIST_TYPE struct script_fcdb_msg
+#include "speclist.h"
+
+#define script_fcdb_msg_list_iterate(msglist, pmsg) \
+    TYPED_LIST_ITERATE(struct script_fcdb_msg, msglist, pmsg)
+#define script_fcdb_msg_list_iterate_end  LIST_ITERATE_END
+
 /* fcdb script functions. */
 bool script_fcdb_init(const char *fcdb_luafile);
 enum fcdb_status script_fcdb_call(const char *func_name, int nargs, ...);
+enum fcdb_status script_fcdb_call_queued(struct script_fcdb_msg_list *msgs,
+                                         const char *func_name,
+                                         int nargs, ...);
+void script_fcdb_msgs_output(struct script_fcdb_msg_list *msgs);
 void script_fcdb_free(void);
 
 bool script_fcdb_do_string(struct connection *caller, const char *str);
@@ -61,6 +61,12 @@ static struct fc_lua *fcl = NULL;
 *****************************************************************************/
 static char *script_server_code = NULL;
 
+/*****************************************************************************
+  Profiling settings; they are kept when the lua state is recreated.
+*****************************************************************************/
+static bool script_server_profiling = FALSE;
+static int script_server_profile_budget = 0;
+
 static void script_server_vars_init(void);
 static void script_server_vars_free(void);
 static void script_server_vars_load(struct section_file *file);
@@ -258,6 +264,9 @@ bool script_server_init(void)
   luascript_func_init(fcl);
   script_server_functions_define();
 
+  fcl->profiling = script_server_profiling;
+  fcl->profile_budget = script_server_profile_budget;
+
   return TRUE;
 }
 
@@ -276,6 +285,68 @@ void script_server_free(void)
   }
 }
 
+/*****************************************************************************
+  Start or stop profiling the signal callbacks. The data collected so far
+  is kept.
+*****************************************************************************/
+void script_server_profile_set(bool enable)
+{
+  script_server_profiling = enable;
+  if (fcl != NULL) {
+    fcl->profiling = enable;
+  }
+}
+
+/*****************************************************************************
+  Returns whether the signal callbacks are being profiled.
+*****************************************************************************/
+bool script_server_profile_get(void)
+{
+  return script_server_profiling;
+}
+
+/*****************************************************************************
+  Set the time in milliseconds a callback may take per turn while
+  profiling before it is logged; 0 for no limit.
+*****************************************************************************/
+void script_server_profile_budget_set(int msec)
+{
+  script_server_profile_budget = msec;
+  if (fcl != NULL) {
+    fcl->profile_budget = msec;
+  }
+}
+
+/*****************************************************************************
+  Forget the profiling data collected so far.
+*****************************************************************************/
+void script_server_profile_reset(void)
+{
+  if (fcl != NULL) {
+    luascript_signal_profile_reset(fcl);
+  }
+}
+
+/*****************************************************************************
+  Write the profiling data collected so far to 'report'.
+*****************************************************************************/
+void script_server_profile_report(struct astring *report)
+{
+  if (fcl != NULL) {
+    luascript_signal_profile_report(fcl, report);
+  }
+}
+
+/*****************************************************************************
+  Update the scripting stuff every turn. Run this on turn end.
+*****************************************************************************/
+void script_server_turn(void)
+{
+  if (fcl != NULL) {
+    luascript_signal_profile_turn(fcl);
+  }
+}
+
 /*****************************************************************************
   Load the scripting state from file.
 *****************************************************************************/
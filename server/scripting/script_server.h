@@ -20,6 +20,7 @@
 /* common/scriptcore */
 #include "luascript_types.h"
 
+struct astring;
 struct section_file;
 struct connection;
 
@@ -45,5 +46,13 @@ void script_server_signal_emit(const char *signal_name, int nargs, ...);
 /* Functions */
 bool script_server_call(const char *func_name, int nargs, ...);
 
+/* Profiling. */
+void script_server_profile_set(bool enable);
+bool script_server_profile_get(void);
+void script_server_profile_budget_set(int msec);
+void script_server_profile_reset(void);
+void script_server_profile_report(struct astring *report);
+void script_server_turn(void);
+
 #endif /* FC__SCRIPT_SERVER_H */
 
@@ -63,6 +63,7 @@
 #include "capability.h"
 #include "fciconv.h"
 #include "fcintl.h"
+#include "fcpoll.h"
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
@@ -92,6 +93,18 @@
 
 static struct connection connections[MAX_NUM_CONNECTIONS];
 
+/* Readiness of the listening sockets, stdin and the client connections.
+ * The registrations persist across the main loop iterations. A connection
+ * is watched for output only while it has queued data; that's what
+ * 'num_pending_writes' counts. */
+static struct fc_poll *sernet_poll = NULL;
+static int num_pending_writes = 0;
+static struct fc_poll_event poll_events[2 * MAX_NUM_CONNECTIONS + 16];
+
+/* How long to wait for network events, in milliseconds, while the
+ * authentication thread has answers to come (see auth_poll()). */
+#define AUTH_POLL_INTERVAL 50
+
 #ifdef GENERATING_MAC      /* mac network globals */
 TEndpointInfo serv_info;
 EndpointRef serv_ep;
@@ -127,6 +140,8 @@ static void start_processing_request(struct connection *pconn,
 static void finish_processing_request(struct connection *pconn);
 static void connection_ping(struct connection *pconn);
 static void send_ping_times_to_all(void);
+static void conn_poll_set(struct connection *pconn, int events);
+static void conn_poll_update(struct connection *pconn);
 
 static void get_lanserver_announcement(void);
 static void send_lanserver_response(void);
@@ -217,6 +232,7 @@ static void close_connection(struct connection *pconn)
 
   pconn->playing = NULL;
   pconn->access_level = ALLOW_NONE;
+  conn_poll_set(pconn, 0);
   connection_common_close(pconn);
 
   send_updated_vote_totals(NULL);
@@ -243,10 +259,14 @@ void close_connections_and_socket(void)
   conn_list_destroy(game.est_connections);
 
   for (i = 0; i < listen_count; i++) {
+    fc_poll_set(sernet_poll, listen_socks[i], 0, NULL);
     fc_closesocket(listen_socks[i]);
   }
   fc_closesocket(socklan);
 
+  fc_poll_destroy(sernet_poll);
+  sernet_poll = NULL;
+
 #ifdef HAVE_LIBREADLINE
   if (history_file) {
     write_history(history_file);
@@ -304,6 +324,52 @@ static void server_conn_close_callback(struct connection *pconn)
 {
   /* Do as little as possible here to avoid recursive evil. */
   pconn->server.is_closing = TRUE;
+  conn_poll_update(pconn);
+}
+
+/****************************************************************************
+  Set the events the connection is watched for in the poll set.
+****************************************************************************/
+static void conn_poll_set(struct connection *pconn, int events)
+{
+  int old = fc_poll_get(sernet_poll, pconn->sock);
+
+  if ((old & FC_POLL_OUT) && !(events & FC_POLL_OUT)) {
+    num_pending_writes--;
+  } else if (!(old & FC_POLL_OUT) && (events & FC_POLL_OUT)) {
+    num_pending_writes++;
+  }
+
+  if (!fc_poll_set(sernet_poll, pconn->sock, events, pconn)) {
+    log_error("Can't watch connection (%s).", conn_description(pconn));
+  }
+}
+
+/****************************************************************************
+  Watch the connection for input while it's open, and for output only
+  while it has queued data.
+****************************************************************************/
+static void conn_poll_update(struct connection *pconn)
+{
+  int events = 0;
+
+  if (pconn->used && !pconn->server.is_closing) {
+    events = FC_POLL_IN | FC_POLL_EXCEPT;
+    if (NULL != pconn->send_buffer && 0 < pconn->send_buffer->ndata) {
+      events |= FC_POLL_OUT;
+    }
+  }
+
+  conn_poll_set(pconn, events);
+}
+
+/****************************************************************************
+  Called by the common code after the send buffer was flushed.
+****************************************************************************/
+static void server_conn_writable_notify(struct connection *pconn,
+                                        bool data_available_and_socket_full)
+{
+  conn_poll_update(pconn);
 }
 
 /****************************************************************************
@@ -337,62 +403,45 @@ static void cut_lagging_connection(struct connection *pconn)
 *****************************************************************************/
 void flush_packets(void)
 {
-  int i;
-  int max_desc;
-  fd_set writefs, exceptfs;
-  struct timeval tv;
+  int i, num_events;
+  int timeout;
   time_t start;
 
   (void) time(&start);
 
   for(;;) {
-    tv.tv_sec = (game.server.netwait - (time(NULL) - start));
-    tv.tv_usec=0;
+    timeout = (game.server.netwait - (time(NULL) - start));
 
-    if (tv.tv_sec < 0)
+    if (timeout < 0 || 0 == num_pending_writes) {
       return;
-
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
-    max_desc=-1;
-
-    for(i=0; i<MAX_NUM_CONNECTIONS; i++) {
-      struct connection *pconn = &connections[i];
-      if (pconn->used
-          && !pconn->server.is_closing
-          && 0 < pconn->send_buffer->ndata) {
-	FD_SET(pconn->sock, &writefs);
-	FD_SET(pconn->sock, &exceptfs);
-	max_desc=MAX(pconn->sock, max_desc);
-      }
     }
 
-    if (max_desc == -1) {
+    num_events = fc_poll_wait(sernet_poll, FC_POLL_OUT, timeout * 1000,
+                              poll_events, ARRAY_SIZE(poll_events));
+    if (num_events <= 0) {
       return;
     }
 
-    if(fc_select(max_desc+1, NULL, &writefs, &exceptfs, &tv)<=0) {
-      return;
-    }
+    for (i = 0; i < num_events; i++) {
+      struct connection *pconn = poll_events[i].data;
 
-    for(i=0; i<MAX_NUM_CONNECTIONS; i++) {   /* check for freaky players */
-      struct connection *pconn = &connections[i];
-      if (pconn->used && !pconn->server.is_closing) {
-        if(FD_ISSET(pconn->sock, &exceptfs)) {
-          log_verbose("connection (%s) cut due to exception data",
-                      conn_description(pconn));
-          connection_close_server(pconn, _("network exception"));
-        } else {
-	  if(pconn->send_buffer && pconn->send_buffer->ndata > 0) {
-	    if(FD_ISSET(pconn->sock, &writefs)) {
-	      flush_connection_send_buffer_all(pconn);
-	    } else {
-	      cut_lagging_connection(pconn);
-	    }
-	  }
-        }
+      if (NULL != pconn
+          && pconn->used
+          && !pconn->server.is_closing) {
+        flush_connection_send_buffer_all(pconn);
       }
     }
+
+    /* Check for lagging players. The ones which just got data written
+     * have a fresh last_write timer. */
+    conn_list_iterate(game.all_connections, pconn) {
+      if (pconn->used
+          && !pconn->server.is_closing
+          && pconn->send_buffer
+          && pconn->send_buffer->ndata > 0) {
+        cut_lagging_connection(pconn);
+      }
+    } conn_list_iterate_end;
   }
 }
 
@@ -401,6 +450,22 @@ struct packet_to_handle {
   enum packet_type type;
 };
 
+/*****************************************************************************
+  Is 'fd' one of the sockets we accept client connections on?
+*****************************************************************************/
+static bool is_listen_socket(int fd)
+{
+  int i;
+
+  for (i = 0; i < listen_count; i++) {
+    if (listen_socks[i] == fd) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 /*****************************************************************************
   Simplify a loop by wrapping get_packet_from_connection.
 *****************************************************************************/
@@ -477,11 +542,11 @@ functions.  That is, other functions should not need to do so.  --dwp
 *****************************************************************************/
 enum server_events server_sniff_all_input(void)
 {
-  int i, s;
-  int max_desc;
-  bool excepting;
-  fd_set readfs, writefs, exceptfs;
-  struct timeval tv;
+  int i, num_events;
+  bool excepting, stdin_ready;
+#ifdef GGZ_SERVER
+  bool ggz_ready = FALSE;
+#endif
 #ifdef SOCKET_ZERO_ISNT_STDIN
   char *bufptr;    
 #endif
@@ -526,6 +591,8 @@ enum server_events server_sniff_all_input(void)
     }
 
     get_lanserver_announcement();
+    save_game_poll();
+    auth_poll();
 
     /* end server if no players for 'srvarg.quitidle' seconds,
      * but only if at least one player has previously connected. */
@@ -616,53 +683,28 @@ enum server_events server_sniff_all_input(void)
       return S_E_END_OF_TURN_TIMEOUT;
     }
 
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-
-    FC_FD_ZERO(&readfs);
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
-
     if (!no_input) {
 #ifdef SOCKET_ZERO_ISNT_STDIN
       fc_init_console();
-#else /* SOCKET_ZERO_ISNT_STDIN */
-#   if !defined(__VMS)
-      FD_SET(0, &readfs);
-#   endif /* VMS */	
 #endif /* SOCKET_ZERO_ISNT_STDIN */
     }
-
-    max_desc = 0;
-    for (i = 0; i < listen_count; i++) {
-      FD_SET(listen_socks[i], &readfs);
-      FD_SET(listen_socks[i], &exceptfs);
-      max_desc = MAX(max_desc, listen_socks[i]);
-    }
+#if !defined(SOCKET_ZERO_ISNT_STDIN) && !defined(__VMS)
+    fc_poll_set(sernet_poll, 0, no_input ? 0 : FC_POLL_IN, NULL);
+#endif /* !SOCKET_ZERO_ISNT_STDIN && !__VMS */
 
     if (with_ggz) {
 #ifdef GGZ_SERVER
-      int ggz_sock = get_ggz_socket();
-
-      FD_SET(ggz_sock, &readfs);
-      max_desc = MAX(max_desc, ggz_sock);
+      fc_poll_set(sernet_poll, get_ggz_socket(), FC_POLL_IN, NULL);
 #endif /* GGZ_SERVER */
     }
 
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-      struct connection *pconn = connections + i;
-      if (pconn->used && !pconn->server.is_closing) {
-        FD_SET(pconn->sock, &readfs);
-        if (0 < pconn->send_buffer->ndata) {
-          FD_SET(pconn->sock, &writefs);
-        }
-        FD_SET(pconn->sock, &exceptfs);
-        max_desc = MAX(pconn->sock, max_desc);
-      }
-    }
     con_prompt_off();		/* output doesn't generate a new prompt */
 
-    if (fc_select(max_desc + 1, &readfs, &writefs, &exceptfs, &tv) == 0) {
+    stdin_ready = FALSE;
+    num_events = fc_poll_wait(sernet_poll, FC_POLL_ALL,
+                              auth_pending() ? AUTH_POLL_INTERVAL : 1000,
+                              poll_events, ARRAY_SIZE(poll_events));
+    if (num_events == 0) {
       /* timeout */
       call_ai_refresh();
       (void) send_server_info_to_metaserver(META_REFRESH);
@@ -693,7 +735,7 @@ enum server_events server_sniff_all_input(void)
 	    lib$stop(status);
 	  }
 	  if (ttchar.numchars) {
-	    FD_SET(0, &readfs);
+	    stdin_ready = TRUE;
 	  } else {
 	    continue;
 	  }
@@ -707,22 +749,41 @@ enum server_events server_sniff_all_input(void)
       }
     }
 
-    if (!with_ggz) { /* No listening socket when using GGZ. */
-      excepting = FALSE;
-      for (i = 0; i < listen_count; i++) {
-        if (FD_ISSET(listen_socks[i], &exceptfs)) {
+    /* Sort out what isn't a client connection. */
+    excepting = FALSE;
+#ifdef GGZ_SERVER
+    ggz_ready = FALSE;
+#endif
+    for (i = 0; i < num_events; i++) {
+      struct fc_poll_event *pevent = poll_events + i;
+
+      if (NULL != pevent->data) {
+        continue;
+      }
+      if (is_listen_socket(pevent->fd)) {
+        if (pevent->events & FC_POLL_EXCEPT) {
           excepting = TRUE;
-          break;
         }
+#ifdef GGZ_SERVER
+      } else if (with_ggz && pevent->fd == get_ggz_socket()) {
+        ggz_ready = TRUE;
+#endif /* GGZ_SERVER */
+      } else if (0 == pevent->fd) {
+        stdin_ready = TRUE;
       }
+    }
+
+    if (!with_ggz) { /* No listening socket when using GGZ. */
       if (excepting) {                  /* handle Ctrl-Z suspend/resume */
 	continue;
       }
-      for (i = 0; i < listen_count; i++) {
-        s = listen_socks[i];
-        if (FD_ISSET(s, &readfs)) {     /* new players connects */
+      for (i = 0; i < num_events; i++) {
+        if (NULL == poll_events[i].data
+            && (poll_events[i].events & FC_POLL_IN)
+            && is_listen_socket(poll_events[i].fd)) {
+          /* new players connects */
           log_verbose("got new connection");
-          if (-1 == server_accept_connection(s)) {
+          if (-1 == server_accept_connection(poll_events[i].fd)) {
             /* There will be a log_error() message from
              * server_accept_connection() if something
              * goes wrong, so no need to make another
@@ -732,13 +793,14 @@ enum server_events server_sniff_all_input(void)
         }
       }
     }
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
+    for (i = 0; i < num_events; i++) {
       /* check for freaky players */
-      struct connection *pconn = &connections[i];
+      struct connection *pconn = poll_events[i].data;
 
-      if (pconn->used
+      if (NULL != pconn
+          && pconn->used
           && !pconn->server.is_closing
-          && FD_ISSET(pconn->sock, &exceptfs)) {
+          && (poll_events[i].events & FC_POLL_EXCEPT)) {
         log_verbose("connection (%s) cut due to exception data",
                     conn_description(pconn));
         connection_close_server(pconn, _("network exception"));
@@ -748,10 +810,8 @@ enum server_events server_sniff_all_input(void)
     if (with_ggz) {
       /* This is intentionally after all the player socket handling because
        * it may cut a client. */
-      int ggz_sock = get_ggz_socket();
-
-      if (FD_ISSET(ggz_sock, &readfs)) {
-	input_from_ggz(ggz_sock);
+      if (ggz_ready) {
+	input_from_ggz(get_ggz_socket());
       }
     }
 #endif /* GGZ_SERVER */
@@ -765,7 +825,7 @@ enum server_events server_sniff_all_input(void)
       free(bufptr_internal);
     }
 #else  /* !SOCKET_ZERO_ISNT_STDIN */
-    if(!no_input && FD_ISSET(0, &readfs)) {    /* input from server operator */
+    if(!no_input && stdin_ready) {    /* input from server operator */
 #ifdef HAVE_LIBREADLINE
       rl_callback_read_char();
       if (readline_handled_input) {
@@ -814,13 +874,14 @@ enum server_events server_sniff_all_input(void)
 #endif /* !SOCKET_ZERO_ISNT_STDIN */
      
     {                             /* input from a player */
-      for(i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-        struct connection *pconn = connections + i;
+      for (i = 0; i < num_events; i++) {
+        struct connection *pconn = poll_events[i].data;
         int nb;
 
-        if (!pconn->used
+        if (NULL == pconn
+            || !pconn->used
             || pconn->server.is_closing
-            || !FD_ISSET(pconn->sock, &readfs)) {
+            || !(poll_events[i].events & FC_POLL_IN)) {
           continue;
 	}
 
@@ -836,20 +897,29 @@ enum server_events server_sniff_all_input(void)
         }
       }
 
-      for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-        struct connection *pconn = &connections[i];
+      for (i = 0; i < num_events; i++) {
+        struct connection *pconn = poll_events[i].data;
 
-        if (pconn->used
+        if (NULL != pconn
+            && pconn->used
             && !pconn->server.is_closing
-            && pconn->send_buffer
-	    && pconn->send_buffer->ndata > 0) {
-	  if (FD_ISSET(pconn->sock, &writefs)) {
-	    flush_connection_send_buffer_all(pconn);
-	  } else {
-	    cut_lagging_connection(pconn);
-	  }
+            && (poll_events[i].events & FC_POLL_OUT)) {
+          flush_connection_send_buffer_all(pconn);
         }
       }
+
+      if (0 < num_pending_writes) {
+        /* The ones which just got data written have a fresh last_write
+         * timer. */
+        conn_list_iterate(game.all_connections, pconn) {
+          if (pconn->used
+              && !pconn->server.is_closing
+              && pconn->send_buffer
+              && pconn->send_buffer->ndata > 0) {
+            cut_lagging_connection(pconn);
+          }
+        } conn_list_iterate_end;
+      }
     }
     really_close_connections();
     break;
@@ -995,13 +1065,20 @@ int server_make_connection(int new_sock, const char *client_addr, const char *cl
   for(i=0; i<MAX_NUM_CONNECTIONS; i++) {
     struct connection *pconn = &connections[i];
     if (!pconn->used) {
+      if (!fc_poll_set(sernet_poll, new_sock,
+                       FC_POLL_IN | FC_POLL_EXCEPT, pconn)) {
+        log_error("can't watch new connection");
+        fc_closesocket(new_sock);
+        return -1;
+      }
+
       connection_common_init(pconn);
       pconn->sock = new_sock;
       pconn->observer = FALSE;
       pconn->playing = NULL;
       pconn->capability[0] = '\0';
       pconn->access_level = access_level_for_next_connection();
-      pconn->notify_of_writable_data = NULL;
+      pconn->notify_of_writable_data = server_conn_writable_notify;
       pconn->server.currently_processed_request_id = 0;
       pconn->server.last_request_id_seen = 0;
       pconn->server.auth_tries = 0;
@@ -1124,6 +1201,7 @@ int server_open_socket(void)
          * connections. */
         fc_closesocket(s);
         for (j = 0; j < listen_count; j++) {
+          fc_poll_set(sernet_poll, listen_socks[j], 0, NULL);
           fc_closesocket(listen_socks[j]);
         }
         listen_count = 0;
@@ -1136,6 +1214,11 @@ int server_open_socket(void)
       fc_closesocket(s);
       continue;
     }
+    if (!fc_poll_set(sernet_poll, s, FC_POLL_IN | FC_POLL_EXCEPT, NULL)) {
+      cause = "poll";
+      fc_closesocket(s);
+      continue;
+    }
     listen_socks[listen_count] = s;
     listen_count++;
   } fc_sockaddr_list_iterate_end;
@@ -1150,6 +1233,9 @@ int server_open_socket(void)
 
   fc_sockaddr_list_destroy(list);
 
+  log_verbose("Using %s for network readiness.",
+              fc_poll_backend_name(sernet_poll));
+
   connections_set_close_callback(server_conn_close_callback);
 
   if (srvarg.announce == ANNOUNCE_NONE) {
@@ -1251,6 +1337,9 @@ void init_connections(void)
   game.all_connections = conn_list_new();
   game.est_connections = conn_list_new();
 
+  sernet_poll = fc_poll_new(FC_POLL_BACKEND_AUTO);
+  num_pending_writes = 0;
+
   for(i=0; i<MAX_NUM_CONNECTIONS; i++) { 
     struct connection *pconn = &connections[i];
     pconn->used = FALSE;
@@ -435,6 +435,18 @@ compresstype_name(enum fz_method compresstype)
   return NULL;
 }
 
+/****************************************************************************
+  Savegame format names accessor.
+****************************************************************************/
+static const struct sset_val_name *saveformat_name(enum secfile_format format)
+{
+  switch (format) {
+  NAME_CASE(SECFILE_FORMAT_TEXT, "TEXT", N_("Text"));
+  NAME_CASE(SECFILE_FORMAT_BINARY, "BINARY", N_("Binary"));
+  }
+  return NULL;
+}
+
 /****************************************************************************
   Names accessor for boolean settings (disable/enable).
 ****************************************************************************/
@@ -2242,6 +2254,41 @@ static struct setting settings[] = {
            N_("Compression library to use for savegames."),
            NULL, NULL, compresstype_name, GAME_DEFAULT_COMPRESS_TYPE)
 
+  GEN_ENUM("saveformat", game.server.save_format,
+           SSET_META, SSET_INTERNAL, SSET_RARE, SSET_SERVER_ONLY,
+           N_("Savegame file format"),
+           N_("Savegames are normally written in a text format which "
+              "can be read and edited by hand. The binary format "
+              "holds the same data, but is loaded much faster. The "
+              "server recognizes the format when loading a game, so "
+              "loading a game and saving it again converts between "
+              "the two."),
+           NULL, NULL, saveformat_name, GAME_DEFAULT_SAVE_FORMAT)
+
+  GEN_BOOL("asyncsave", game.server.save_async,
+           SSET_META, SSET_INTERNAL, SSET_RARE, SSET_SERVER_ONLY,
+           N_("Write savegames in the background"),
+           /* TRANS: 'compress' setting name should not be translated. */
+           N_("If this is enabled, the server only collects the game data "
+              "when saving and leaves compressing and writing the file to "
+              "a background thread, so that the game can go on meanwhile. "
+              "This mostly helps with large maps and high 'compress' "
+              "levels. The console reports when the file has been "
+              "written."),
+           NULL, NULL, GAME_DEFAULT_SAVE_ASYNC)
+
+  GEN_INT("workerthreads", game.server.worker_threads,
+          SSET_META, SSET_INTERNAL, SSET_RARE, SSET_SERVER_ONLY,
+          N_("Number of additional threads for turn processing"),
+          N_("Parts of the turn change, such as the end of turn update "
+             "of cities or the assessment of the danger to the cities of "
+             "AI players, can be spread over this many worker threads in "
+             "addition to the main server thread. The game proceeds "
+             "exactly the same way whatever the value. A value of 0 "
+             "means that everything is done in the main thread."),
+          NULL, NULL, GAME_MIN_WORKER_THREADS, GAME_MAX_WORKER_THREADS,
+          GAME_DEFAULT_WORKER_THREADS)
+
   GEN_STRING("savename", game.server.save_name,
              SSET_META, SSET_INTERNAL, SSET_VITAL, SSET_SERVER_ONLY,
              N_("Definition of the save file name"),
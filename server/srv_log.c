@@ -38,7 +38,8 @@
 
 #include "srv_log.h"
 
-static struct timer *aitimer[AIT_LAST][2];
+/* CPU time this turn, CPU time this game and real time this game. */
+static struct timer *aitimer[AIT_LAST][3];
 static int recursion[AIT_LAST];
 
 /* General AI logging functions */
@@ -154,7 +155,8 @@ void real_unit_log(const char *file, const char *function, int line,
 
 /**************************************************************************
   Measure the time between the calls.  Used to see where in the AI too
-  much CPU is being used.
+  much CPU is being used.  The CPU time includes the time of the worker
+  threads (see server_threadpool()), the real time shows what they save.
 **************************************************************************/
 void TIMING_LOG(enum ai_timer timer, enum ai_timer_activity activity)
 {
@@ -165,6 +167,7 @@ void TIMING_LOG(enum ai_timer timer, enum ai_timer_activity activity)
     for (i = 0; i < AIT_LAST; i++) {
       aitimer[i][0] = timer_new(TIMER_CPU, TIMER_ACTIVE);
       aitimer[i][1] = timer_new(TIMER_CPU, TIMER_ACTIVE);
+      aitimer[i][2] = timer_new(TIMER_USER, TIMER_ACTIVE);
       recursion[i] = 0;
     }
   }
@@ -180,10 +183,12 @@ void TIMING_LOG(enum ai_timer timer, enum ai_timer_activity activity)
   if (activity == TIMER_START && recursion[timer] == 0) {
     timer_start(aitimer[timer][0]);
     timer_start(aitimer[timer][1]);
+    timer_start(aitimer[timer][2]);
     recursion[timer]++;
   } else if (activity == TIMER_STOP && recursion[timer] == 1) {
     timer_stop(aitimer[timer][0]);
     timer_stop(aitimer[timer][1]);
+    timer_stop(aitimer[timer][2]);
     recursion[timer]--;
   }
 }
@@ -198,9 +203,11 @@ void TIMING_RESULTS(void)
 #ifdef LOG_TIMERS
 
 #define AILOG_OUT(text, which)                                              \
-  fc_snprintf(buf, sizeof(buf), "  %s: %g sec turn, %g sec game", text,     \
+  fc_snprintf(buf, sizeof(buf),                                             \
+              "  %s: %g sec turn, %g sec game (%g sec real)", text,         \
               timer_read_seconds(aitimer[which][0]),                        \
-              timer_read_seconds(aitimer[which][1]));                       \
+              timer_read_seconds(aitimer[which][1]),                        \
+              timer_read_seconds(aitimer[which][2]));                       \
   log_test("%s", buf);                                                      \
   notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log, "%s", buf);
 
@@ -209,9 +216,11 @@ void TIMING_RESULTS(void)
 #else  /* LOG_TIMERS */
 
 #define AILOG_OUT(text, which)                                          \
-  fc_snprintf(buf, sizeof(buf), "  %s: %g sec turn, %g sec game", text, \
+  fc_snprintf(buf, sizeof(buf),                                         \
+              "  %s: %g sec turn, %g sec game (%g sec real)", text,     \
               timer_read_seconds(aitimer[which][0]),                    \
-              timer_read_seconds(aitimer[which][1]));                   \
+              timer_read_seconds(aitimer[which][1]),                    \
+              timer_read_seconds(aitimer[which][2]));                   \
   notify_conn(NULL, NULL, E_AI_DEBUG, ftc_log, "%s", buf);
 
 #endif /* LOG_TIMERS */
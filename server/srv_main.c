@@ -49,6 +49,8 @@
 #include "capability.h"
 #include "fciconv.h"
 #include "fcintl.h"
+#include "fcthread.h"
+#include "fcthreadpool.h"
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
@@ -60,6 +62,7 @@
 
 /* common/aicore */
 #include "citymap.h"
+#include "path_finding.h"
 
 /* common */
 #include "achievements.h"
@@ -175,6 +178,30 @@ bv_identity_numbers identity_numbers_used;
 /* server initialized flag */
 static bool has_been_srv_init = FALSE;
 
+/* Worker threads, see server_threadpool(). */
+static struct fc_threadpool *server_pool = NULL;
+static int server_pool_size = 0;
+
+/* A save being written by a background thread, see save_game(). */
+static struct {
+  bool running;                 /* Thread started and not joined yet. */
+  fc_thread thread;
+  fc_mutex mutex;
+
+  /* Set up before the thread starts. */
+  struct section_file *file;
+  char filepath[600];
+  int compress_level;
+  enum fz_method compress_type;
+  enum secfile_format format;
+  double stall;                 /* Seconds the main thread was busy. */
+
+  /* Set by the thread, protected by 'mutex'. */
+  bool done;
+  bool success;
+  double background;            /* Seconds spent in the thread. */
+} bg_save;
+
 /**************************************************************************
   Initialize the game seed.  This may safely be called multiple times.
 **************************************************************************/
@@ -255,6 +282,7 @@ void srv_init(void)
 
   /* Initialize global mutexes */
   fc_init_mutex(&game.server.mutexes.city_list);
+  fc_init_mutex(&bg_save.mutex);
 
   /* done */
   return;
@@ -1079,6 +1107,9 @@ static void end_phase(void)
 static void end_turn(void)
 {
   int food = 0, shields = 0, trade = 0, settlers = 0;
+  unsigned long effect_hits, effect_misses;
+  int pf_maps;
+  unsigned long pf_nodes, pf_bytes;
 
   log_debug("Endturn");
 
@@ -1181,6 +1212,7 @@ static void end_turn(void)
   settings_turn();
   stdinhand_turn();
   voting_turn();
+  script_server_turn();
   send_city_turn_notifications(NULL);
 
   log_debug("Gamenextyear");
@@ -1197,12 +1229,119 @@ static void end_turn(void)
 
   log_debug("Sendyeartoclients");
   send_year_to_clients(game.info.year);
+
+  effect_cache_stats(&effect_hits, &effect_misses);
+  log_verbose("Effect cache: %lu hits, %lu misses so far.",
+              effect_hits, effect_misses);
+
+  pf_map_stats(&pf_maps, &pf_nodes, &pf_bytes);
+  log_verbose("Path-finding: %d maps using %lu nodes, %lu bytes allocated "
+              "this turn.", pf_maps, pf_nodes, pf_bytes);
+  pf_map_stats_reset();
+}
+
+/**************************************************************************
+  Write the section file of a save to disk in the given format.
+**************************************************************************/
+static bool save_game_write(const struct section_file *file,
+                            const char *filepath, int compress_level,
+                            enum fz_method compress_type,
+                            enum secfile_format format)
+{
+  if (SECFILE_FORMAT_BINARY == format) {
+    return secfile_save_bin(file, filepath, compress_level, compress_type);
+  }
+
+  return secfile_save(file, filepath, compress_level, compress_type);
+}
+
+/**************************************************************************
+  Main function of the background save thread: compress and write the
+  section file prepared by save_game().
+**************************************************************************/
+static void save_game_thread(void *arg)
+{
+  struct timer *timer_user = timer_new(TIMER_USER, TIMER_ACTIVE);
+  bool success;
+
+  timer_start(timer_user);
+  success = save_game_write(bg_save.file, bg_save.filepath,
+                            bg_save.compress_level, bg_save.compress_type,
+                            bg_save.format);
+
+  fc_allocate_mutex(&bg_save.mutex);
+  bg_save.success = success;
+  bg_save.background = timer_read_seconds(timer_user);
+  bg_save.done = TRUE;
+  fc_release_mutex(&bg_save.mutex);
+
+  timer_destroy(timer_user);
+}
+
+/**************************************************************************
+  Report and clean up the background save, if it has finished. With
+  'wait' set, block until it has. Must be called from the main thread.
+**************************************************************************/
+static void save_game_finish(bool wait)
+{
+  bool done;
+
+  if (!bg_save.running) {
+    return;
+  }
+
+  fc_allocate_mutex(&bg_save.mutex);
+  done = bg_save.done;
+  fc_release_mutex(&bg_save.mutex);
+
+  if (!done) {
+    if (!wait) {
+      return;
+    }
+    log_verbose("Waiting for the save of %s to finish.", bg_save.filepath);
+  }
+
+  fc_thread_wait(&bg_save.thread);
+  bg_save.running = FALSE;
+
+  if (bg_save.success) {
+    con_write(C_OK, _("Game saved as %s (%.2f seconds stalled, "
+                      "%.2f seconds in the background)"),
+              bg_save.filepath, bg_save.stall, bg_save.background);
+  } else {
+    con_write(C_FAIL, _("Failed saving game as %s"), bg_save.filepath);
+  }
+
+  secfile_destroy(bg_save.file);
+  bg_save.file = NULL;
+
+  ggz_game_saved(bg_save.filepath);
+}
+
+/**************************************************************************
+  Report a finished background save. Called regularly from the main loop.
+**************************************************************************/
+void save_game_poll(void)
+{
+  save_game_finish(FALSE);
+}
+
+/**************************************************************************
+  Block until a background save, if any, has been written.
+**************************************************************************/
+void save_game_wait(void)
+{
+  save_game_finish(TRUE);
 }
 
 /**************************************************************************
 Unconditionally save the game, with specified filename.
 Always prints a message: either save ok, or failed.
 
+With the 'asyncsave' setting, only the section file is built here; it is
+compressed and written by a background thread, and the message comes
+from save_game_poll() once that is done.
+
 Note that if !HAVE_LIBZ, then game.server.save_compress_level should never
 become non-zero, so no need to check HAVE_LIBZ explicitly here as well.
 **************************************************************************/
@@ -1258,6 +1397,10 @@ void save_game(const char *orig_filename, const char *save_reason,
                        sizeof(filepath) + filepath - filename, "manual");
   }
 
+  /* Only one save at a time; the previous one may still be writing to
+   * the same file name. */
+  save_game_wait();
+
   timer_cpu = timer_new(TIMER_CPU, TIMER_ACTIVE);
   timer_start(timer_cpu);
   timer_user = timer_new(TIMER_USER, TIMER_ACTIVE);
@@ -1325,8 +1468,29 @@ void save_game(const char *orig_filename, const char *save_reason,
     sz_strlcpy(filepath, tmpname);
   }
 
-  if (!secfile_save(file, filepath, game.server.save_compress_level,
-                    game.server.save_compress_type)) {
+  if (game.server.save_async) {
+    bg_save.file = file;
+    sz_strlcpy(bg_save.filepath, filepath);
+    bg_save.compress_level = game.server.save_compress_level;
+    bg_save.compress_type = game.server.save_compress_type;
+    bg_save.format = game.server.save_format;
+    bg_save.stall = timer_read_seconds(timer_user);
+    bg_save.done = FALSE;
+
+    if (0 == fc_thread_start(&bg_save.thread, save_game_thread, NULL)) {
+      bg_save.running = TRUE;
+      timer_destroy(timer_cpu);
+      timer_destroy(timer_user);
+      return;
+    }
+
+    log_error("Failed to start the save thread, saving in the foreground.");
+    bg_save.file = NULL;
+  }
+
+  if (!save_game_write(file, filepath, game.server.save_compress_level,
+                       game.server.save_compress_type,
+                       game.server.save_format)) {
     con_write(C_FAIL, _("Failed saving game as %s"), filepath);
   } else {
     con_write(C_OK, _("Game saved as %s"), filepath);
@@ -1415,18 +1579,56 @@ void start_game(void)
   /* There's no stateful packet set to client until srv_ready(). */
 }
 
+/**************************************************************************
+  Return the pool of worker threads sized by the 'workerthreads' setting,
+  or NULL if the server is to do all the work in the main thread.
+**************************************************************************/
+struct fc_threadpool *server_threadpool(void)
+{
+  if (server_pool != NULL && server_pool_size != game.server.worker_threads) {
+    fc_threadpool_destroy(server_pool);
+    server_pool = NULL;
+  }
+
+  if (game.server.worker_threads <= 0) {
+    return NULL;
+  }
+
+  if (server_pool == NULL) {
+    server_pool = fc_threadpool_new(game.server.worker_threads);
+    server_pool_size = game.server.worker_threads;
+    log_verbose("Started %d of %d worker threads.",
+                fc_threadpool_num_threads(server_pool), server_pool_size);
+  }
+
+  if (fc_threadpool_num_threads(server_pool) == 0) {
+    /* No thread support. */
+    return NULL;
+  }
+
+  return server_pool;
+}
+
 /**************************************************************************
  Quit the server and exit.
 **************************************************************************/
 void server_quit(void)
 {
+  save_game_wait();
   set_server_state(S_S_OVER);
   mapimg_free();
   server_game_free();
+  if (server_pool != NULL) {
+    fc_threadpool_destroy(server_pool);
+    server_pool = NULL;
+  }
   diplhand_free();
   voting_free();
   ai_timer_free();
 
+  /* Let the authentication thread finish before the database goes. */
+  auth_free();
+
 #ifdef HAVE_FCDB
   if (srvarg.fcdb_enabled) {
     /* If freeciv database has been initialized */
@@ -1441,6 +1643,7 @@ void server_quit(void)
   close_connections_and_socket();
   registry_module_close();
   fc_destroy_mutex(&game.server.mutexes.city_list);
+  fc_destroy_mutex(&bg_save.mutex);
   free_nls();
   con_log_close();
   exit(EXIT_SUCCESS);
@@ -2291,6 +2494,11 @@ static void srv_running(void)
   /* We may as well reset is_new_game now. */
   game.info.is_new_game = FALSE;
 
+  /* Cache effect bonuses while the game runs. Everything before, like
+   * loading a savegame, changes the game state behind the back of the
+   * cache. */
+  effect_cache_enable(TRUE);
+
   log_verbose("srv_running() mostly redundant send_server_settings()");
   send_server_settings(NULL);
 
@@ -2426,6 +2634,8 @@ static void srv_running(void)
     }
   }
 
+  effect_cache_enable(FALSE);
+
   /* This will thaw the reports and agents at the client.  */
   lsend_packet_thaw_client(game.est_connections);
 
@@ -2924,7 +3134,7 @@ static struct terrain
 {
   if (knowledge && pplayer) {
     struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
-    return plrtile->terrain;
+    return player_tile_terrain(plrtile);
   }
 
   return tile_terrain(ptile);
@@ -2940,7 +3150,7 @@ static struct player *mapimg_server_tile_owner(const struct tile *ptile,
   if (knowledge && pplayer
       && tile_get_known(ptile, pplayer) != TILE_KNOWN_SEEN) {
     struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
-    return plrtile->owner;
+    return player_tile_owner(plrtile);
   }
 
   return tile_owner(ptile);
@@ -88,6 +88,7 @@ void init_game_seed(void);
 void srv_init(void);
 void srv_main(void);
 void server_quit(void);
+struct fc_threadpool *server_threadpool(void);
 void save_game_auto(const char *save_reason, enum autosave_type type);
 
 enum server_states server_state(void);
@@ -101,6 +102,8 @@ bool server_packet_input(struct connection *pconn, void *packet, int type);
 void start_game(void);
 void save_game(const char *orig_filename, const char *save_reason,
                bool scenario);
+void save_game_poll(void);
+void save_game_wait(void);
 const char *pick_random_player_name(const struct nation_type *pnation);
 void player_nation_defaults(struct player *pplayer, struct nation_type *pnation,
                             bool set_name);
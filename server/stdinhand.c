@@ -141,6 +141,8 @@ static bool read_init_script_real(struct connection *caller,
 static bool reset_command(struct connection *caller, char *arg, bool check,
                           int read_recursion);
 static bool lua_command(struct connection *caller, char *arg, bool check);
+static bool lua_profile_command(struct connection *caller, char *arg,
+                                bool check);
 static bool kick_command(struct connection *caller, char *name, bool check);
 static bool delegate_command(struct connection *caller, char *arg,
                              bool check);
@@ -152,6 +154,8 @@ static char setting_status(struct connection *caller,
 static bool player_name_check(const char* name, char *buf, size_t buflen);
 static bool playercolor_command(struct connection *caller,
                                 char *str, bool check);
+static bool netcompress_command(struct connection *caller,
+                                char *str, bool check);
 static bool mapimg_command(struct connection *caller, char *arg, bool check);
 static const char *mapimg_accessor(int i);
 
@@ -2721,6 +2725,23 @@ static bool debug_command(struct connection *caller, char *str,
     notify_conn(game.est_connections, NULL, E_AI_DEBUG, ftc_log,
                 _("players=%d cities=%d citizens=%d units=%d"),
                 players, cities, citizens, units);
+  } else if (ntokens > 0 && strcmp(arg[0], "memory") == 0) {
+    size_t total = 0;
+
+    players_iterate(plr) {
+      int sites;
+      size_t bytes = player_map_memory(plr, &sites);
+
+      cmd_reply(CMD_DEBUG, caller, C_OK,
+                _("%s: player map uses %lu kB (%d known cities)."),
+                player_name(plr), (unsigned long) (bytes / 1024), sites);
+      total += bytes;
+    } players_iterate_end;
+    cmd_reply(CMD_DEBUG, caller, C_OK,
+              _("All player maps use %lu kB, %lu bytes per player and tile."),
+              (unsigned long) (total / 1024),
+              (unsigned long) (sizeof(struct player_tile)
+                               + 2 * sizeof(v_radius_t)));
   } else if (ntokens > 0 && strcmp(arg[0], "city") == 0) {
     int x, y;
     struct tile *ptile;
@@ -3627,6 +3648,10 @@ bool load_command(struct connection *caller, const char *filename, bool check)
     return FALSE;
   }
 
+  /* The file may be the one being written in the background, e.g. the
+   * save made at the end of the last game. */
+  save_game_wait();
+
   {
     /* it is a normal savegame or maybe a scenario */
     char testfile[MAX_LEN_PATH];
@@ -4046,6 +4071,59 @@ static bool playercolor_command(struct connection *caller,
   return ret;
 }
 
+/****************************************************************************
+  /netcompress command handler.
+****************************************************************************/
+static bool netcompress_command(struct connection *caller,
+                                char *str, bool check)
+{
+  enum m_pre_result match_result;
+  struct connection *ptarget;
+  int ntokens = 0;
+  char *token[2];
+  int level;
+  bool ret = TRUE;
+
+  ntokens = get_tokens(str, token, 2, TOKEN_DELIMITERS);
+
+  if (ntokens != 2) {
+    cmd_reply(CMD_NETCOMPRESS, caller, C_SYNTAX,
+              _("Two arguments needed. See '/help netcompress'."));
+    ret = FALSE;
+    goto cleanup;
+  }
+
+  ptarget = conn_by_user_prefix(token[0], &match_result);
+
+  if (!ptarget) {
+    cmd_reply_no_such_conn(CMD_NETCOMPRESS, caller, token[0], match_result);
+    ret = FALSE;
+    goto cleanup;
+  }
+
+  if (!str_to_int(token[1], &level) || -1 > level || 9 < level) {
+    cmd_reply(CMD_NETCOMPRESS, caller, C_SYNTAX,
+              _("The compression level must be a number from -1 to 9."));
+    ret = FALSE;
+    goto cleanup;
+  }
+
+  if (check) {
+    goto cleanup;
+  }
+
+  conn_compression_set_level(ptarget, level);
+  cmd_reply(CMD_NETCOMPRESS, caller, C_OK,
+            _("Compression level of connection %s set to %d."),
+            ptarget->username, level);
+
+ cleanup:
+
+  free_tokens(token, ntokens);
+
+  return ret;
+}
+
 /**************************************************************************
   Cutting away a trailing comment by putting a '\0' on the '#'. The
   method handles # in single or double quotes. It also takes care of
@@ -4390,6 +4468,8 @@ static bool handle_stdin_input_real(struct connection *caller,
     return unignore_command(caller, arg, check);
   case CMD_PLAYERCOLOR:
     return playercolor_command(caller, arg, check);
+  case CMD_NETCOMPRESS:
+    return netcompress_command(caller, arg, check);
   case CMD_NUM:
   case CMD_UNRECOGNIZED:
   case CMD_AMBIGUOUS:
@@ -4579,6 +4659,8 @@ static bool reset_command(struct connection *caller, char *arg, bool check,
 #define SPECENUM_VALUE0NAME "cmd"
 #define SPECENUM_VALUE1     LUA_FILE
 #define SPECENUM_VALUE1NAME "file"
+#define SPECENUM_VALUE2     LUA_PROFILE
+#define SPECENUM_VALUE2NAME "profile"
 #include "specenum_gen.h"
 
 /*****************************************************************************
@@ -4646,6 +4728,9 @@ static bool lua_command(struct connection *caller, char *arg, bool check)
   case LUA_CMD:
     /* Nothing to check. */
     break;
+  case LUA_PROFILE:
+    ret = lua_profile_command(caller, luaarg, check);
+    goto cleanup;
   case LUA_FILE:
     /* Abuse real_filename to find if we already have a .lua extension. */
     real_filename = luaarg + strlen(luaarg) - MIN(strlen(extension),
@@ -4693,6 +4778,9 @@ static bool lua_command(struct connection *caller, char *arg, bool check)
   case LUA_CMD:
     ret = script_server_do_string(caller, luaarg);
     break;
+  case LUA_PROFILE:
+    /* Handled above. */
+    break;
   case LUA_FILE:
     cmd_reply(CMD_LUA, caller, C_COMMENT,
               _("Loading Freeciv script file '%s'."), real_filename);
@@ -4714,6 +4802,177 @@ static bool lua_command(struct connection *caller, char *arg, bool check)
   return ret;
 }
 
+/* Define the possible arguments to the 'lua profile' command */
+#define SPECENUM_NAME lua_profile_args
+#define SPECENUM_VALUE0     LUA_PROFILE_BUDGET
+#define SPECENUM_VALUE0NAME "budget"
+#define SPECENUM_VALUE1     LUA_PROFILE_DUMP
+#define SPECENUM_VALUE1NAME "dump"
+#define SPECENUM_VALUE2     LUA_PROFILE_OFF
+#define SPECENUM_VALUE2NAME "off"
+#define SPECENUM_VALUE3     LUA_PROFILE_ON
+#define SPECENUM_VALUE3NAME "on"
+#define SPECENUM_VALUE4     LUA_PROFILE_RESET
+#define SPECENUM_VALUE4NAME "reset"
+#define SPECENUM_VALUE5     LUA_PROFILE_SHOW
+#define SPECENUM_VALUE5NAME "show"
+#include "specenum_gen.h"
+
+/*****************************************************************************
+  Returns possible parameters for the 'lua profile' command.
+*****************************************************************************/
+static const char *lua_profile_accessor(int i)
+{
+  i = CLIP(0, i, lua_profile_args_max());
+  return lua_profile_args_name((enum lua_profile_args) i);
+}
+
+/*****************************************************************************
+  Handle the 'lua profile' command: profiling of the script callbacks.
+*****************************************************************************/
+static bool lua_profile_command(struct connection *caller, char *arg,
+                                bool check)
+{
+  struct astring report = ASTRING_INIT;
+  char *tokens[2];
+  char tilde_filename[4096];
+  int ntokens, ind, msec = 0;
+  FILE *dump_file;
+  bool ret = TRUE;
+
+  ntokens = get_tokens(arg, tokens, 2, TOKEN_DELIMITERS);
+
+  if (0 == ntokens) {
+    /* use 'show' as default */
+    ind = LUA_PROFILE_SHOW;
+  } else {
+    switch (match_prefix(lua_profile_accessor, lua_profile_args_max() + 1,
+                         0, fc_strncasecmp, NULL, tokens[0], &ind)) {
+    case M_PRE_EXACT:
+    case M_PRE_ONLY:
+      /* we have a match */
+      break;
+    case M_PRE_EMPTY:
+      ind = LUA_PROFILE_SHOW;
+      break;
+    case M_PRE_AMBIGUOUS:
+    case M_PRE_LONG:
+    case M_PRE_FAIL:
+    case M_PRE_LAST:
+      cmd_reply(CMD_LUA, caller, C_SYNTAX,
+                _("The valid arguments are: 'budget', 'dump', 'off', 'on', "
+                  "'reset' and 'show'."));
+      ret = FALSE;
+      goto cleanup;
+    }
+  }
+
+  /* Check the arguments. */
+  switch (ind) {
+  case LUA_PROFILE_BUDGET:
+    if (ntokens < 2 || !str_to_int(tokens[1], &msec) || 0 > msec) {
+      cmd_reply(CMD_LUA, caller, C_SYNTAX,
+                _("Usage: lua profile budget <milliseconds>"));
+      ret = FALSE;
+      goto cleanup;
+    }
+    break;
+  case LUA_PROFILE_DUMP:
+    if (ntokens < 2) {
+      cmd_reply(CMD_LUA, caller, C_SYNTAX,
+                _("Usage: lua profile dump <file>"));
+      ret = FALSE;
+      goto cleanup;
+    }
+    if (is_restricted(caller)) {
+      if (!is_safe_filename(tokens[1])) {
+        cmd_reply(CMD_LUA, caller, C_FAIL,
+                  _("Name \"%s\" disallowed for security reasons."),
+                  tokens[1]);
+        ret = FALSE;
+        goto cleanup;
+      }
+      sz_strlcpy(tilde_filename, tokens[1]);
+    } else {
+      interpret_tilde(tilde_filename, sizeof(tilde_filename), tokens[1]);
+    }
+    break;
+  case LUA_PROFILE_OFF:
+  case LUA_PROFILE_ON:
+  case LUA_PROFILE_RESET:
+  case LUA_PROFILE_SHOW:
+    break;
+  }
+
+  if (check) {
+    goto cleanup;
+  }
+
+  switch (ind) {
+  case LUA_PROFILE_BUDGET:
+    script_server_profile_budget_set(msec);
+    if (0 < msec) {
+      cmd_reply(CMD_LUA, caller, C_OK,
+                _("Callbacks taking more than %d ms per turn will be "
+                  "logged while profiling."), msec);
+    } else {
+      cmd_reply(CMD_LUA, caller, C_OK,
+                _("Callbacks will not be checked against a time budget."));
+    }
+    break;
+  case LUA_PROFILE_OFF:
+    script_server_profile_set(FALSE);
+    cmd_reply(CMD_LUA, caller, C_OK, _("Script profiling stopped."));
+    break;
+  case LUA_PROFILE_ON:
+    script_server_profile_set(TRUE);
+    cmd_reply(CMD_LUA, caller, C_OK, _("Script profiling started."));
+    break;
+  case LUA_PROFILE_RESET:
+    script_server_profile_reset();
+    cmd_reply(CMD_LUA, caller, C_OK, _("Script profiling data cleared."));
+    break;
+  case LUA_PROFILE_DUMP:
+    dump_file = fc_fopen(tilde_filename, "w");
+    if (NULL == dump_file) {
+      cmd_reply(CMD_LUA, caller, C_FAIL,
+                _("Cannot write the profile to '%s'."), tilde_filename);
+      ret = FALSE;
+      break;
+    }
+    script_server_profile_report(&report);
+    fprintf(dump_file, "%s\n", astr_str(&report));
+    fclose(dump_file);
+    cmd_reply(CMD_LUA, caller, C_OK,
+              _("Script profile written to '%s'."), tilde_filename);
+    break;
+  case LUA_PROFILE_SHOW:
+    {
+      const char *line;
+
+      cmd_reply(CMD_LUA, caller, C_COMMENT,
+                script_server_profile_get()
+                ? _("Script profiling is on.")
+                : _("Script profiling is off."));
+      script_server_profile_report(&report);
+      line = astr_str(&report);
+      while (NULL != line) {
+        const char *end = strchr(line, '\n');
+
+        cmd_reply(CMD_LUA, caller, C_COMMENT, "%.*s",
+                  (int) (NULL != end ? end - line : strlen(line)), line);
+        line = (NULL != end ? end + 1 : NULL);
+      }
+    }
+    break;
+  }
+
+ cleanup:
+  astr_free(&report);
+  free_tokens(tokens, ntokens);
+  return ret;
+}
+
 /* Define the possible arguments to the delegation command */
 #define SPECENUM_NAME delegate_args
 #define SPECENUM_VALUE0     DELEGATE_CANCEL
@@ -6887,6 +7146,7 @@ Commands that may be followed by a connection name
 static const int connection_cmd[] = {
   CMD_CUT,
   CMD_KICK,
+  CMD_NETCOMPRESS,
   -1
 };
 
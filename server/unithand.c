@@ -451,6 +451,8 @@ void unit_change_homecity_handling(struct unit *punit, struct city *new_pcity)
    * be used that way. */
   fc_assert_ret(new_pcity != old_pcity);
 
+  city_refresh_generation_bump();
+
   if (old_owner != new_owner) {
     struct city *pcity = tile_city(punit->tile);
 
@@ -1330,6 +1330,7 @@ void transform_unit(struct unit *punit, struct unit_type *to_unit,
   }
 
   punit->utype = to_unit;
+  city_refresh_generation_bump();
 
   /* New type may not have the same veteran system, and we may want to
    * knock some levels off. */
@@ -1474,6 +1475,8 @@ static void server_remove_unit(struct unit *punit, enum unit_loss_reason reason)
   } unit_list_iterate_end;
 #endif
 
+  city_refresh_generation_bump();
+
   CALL_PLR_AI_FUNC(unit_lost, pplayer, punit);
 
   /* Save transporter for updating below. */
@@ -2267,6 +2270,11 @@ void send_unit_info_to_onlookers(struct conn_list *dest, struct unit *punit,
   conn_list_iterate(dest, pconn) {
     struct player *pplayer = pconn->playing;
 
+    if (dest == game.est_connections && conn_delta_group_follower(pconn)) {
+      /* Gets what is sent to the first global observer. */
+      continue;
+    }
+
     /* Be careful to consider all cases where pplayer is NULL... */
     if ((!pplayer && pconn->observer) || pplayer == unit_owner(punit)) {
       /* If the unit is transported, go recursive up and send information
@@ -2627,14 +2635,13 @@ bool do_paradrop(struct unit *punit, struct tile *ptile)
 
   /* Safe terrain according to player map? */
   if (!is_native_terrain(unit_type(punit),
-                         plrtile->terrain,
+                         player_tile_terrain(plrtile),
                          plrtile->extras)
       && (ptransport == NULL
           || !can_player_see_unit_at(pplayer, ptransport, ptile))) {
     notify_player(pplayer, ptile, E_BAD_COMMAND, ftc_server,
                   _("This unit cannot paradrop into %s."),
-                  terrain_name_translation(
-                      map_get_player_tile(ptile, pplayer)->terrain));
+                  terrain_name_translation(player_tile_terrain(plrtile)));
     return FALSE;
   }
 
@@ -3862,12 +3869,15 @@ void unit_refresh_vision(struct unit *punit)
 
 /****************************************************************************
   Refresh the vision of all units in the list - see unit_refresh_vision.
+  The fog of war is updated once for the whole list.
 ****************************************************************************/
 void unit_list_refresh_vision(struct unit_list *punitlist)
 {
+  map_vision_freeze();
   unit_list_iterate(punitlist, punit) {
     unit_refresh_vision(punit);
   } unit_list_iterate_end;
+  map_vision_thaw();
 }
 
 /****************************************************************************
@@ -0,0 +1,595 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+/* utility */
+#include "log.h"
+#include "mem.h"
+#include "netintf.h"
+#include "shared.h"
+#include "support.h"
+
+#include "fcpoll.h"
+
+/* Internal interest flag: the descriptor can't be watched by epoll
+ * (e.g. stdin redirected from a regular file). Like select() does, such
+ * descriptors are always reported ready. */
+#define FC_POLL_ALWAYS  (1 << 8)
+
+struct fc_poll {
+  enum fc_poll_backend backend;
+
+  /* Indexed by file descriptor. */
+  int num_slots;
+  int *interest;
+  void **data;
+  int max_fd;
+
+  /* select() backend. */
+  fd_set master_in;
+  fd_set master_out;
+  fd_set master_except;
+
+#ifdef HAVE_SYS_EPOLL_H
+  /* epoll backend. Input and output interest live in separate instances
+   * so that a wait for output only doesn't wake up for pending input.
+   * 'ep_all' watches both of them. */
+  int ep_all;
+  int ep_in;
+  int ep_out;
+  struct epoll_event *ep_events;
+  int num_ep_events;
+
+  int *always;
+  int num_always;
+#endif /* HAVE_SYS_EPOLL_H */
+};
+
+/**********************************************************************
+  Make sure the per-descriptor arrays can be indexed with 'fd'.
+***********************************************************************/
+static void fc_poll_ensure_slot(struct fc_poll *ppoll, int fd)
+{
+  if (fd >= ppoll->num_slots) {
+    int old_slots = ppoll->num_slots;
+    int new_slots = MAX(fd + 1, 2 * old_slots);
+
+    ppoll->interest = fc_realloc(ppoll->interest,
+                                 new_slots * sizeof(*ppoll->interest));
+    ppoll->data = fc_realloc(ppoll->data, new_slots * sizeof(*ppoll->data));
+    memset(ppoll->interest + old_slots, 0,
+           (new_slots - old_slots) * sizeof(*ppoll->interest));
+    memset(ppoll->data + old_slots, 0,
+           (new_slots - old_slots) * sizeof(*ppoll->data));
+    ppoll->num_slots = new_slots;
+  }
+}
+
+/**********************************************************************
+  Fill a timeval from a timeout in milliseconds. Returns NULL for an
+  infinite (negative) timeout.
+***********************************************************************/
+static struct timeval *fc_poll_timeval(struct timeval *tv, int timeout_ms)
+{
+  if (0 > timeout_ms) {
+    return NULL;
+  }
+
+  tv->tv_sec = timeout_ms / 1000;
+  tv->tv_usec = (timeout_ms % 1000) * 1000;
+
+  return tv;
+}
+
+/**********************************************************************
+  Update the select() master sets for 'fd'.
+***********************************************************************/
+static bool select_set(struct fc_poll *ppoll, int fd, int events)
+{
+#ifndef HAVE_WINSOCK
+  if (fd >= FD_SETSIZE) {
+    log_error("fc_poll: descriptor %d is too big for select().", fd);
+    return FALSE;
+  }
+#endif /* HAVE_WINSOCK */
+
+  FD_CLR(fd, &ppoll->master_in);
+  FD_CLR(fd, &ppoll->master_out);
+  FD_CLR(fd, &ppoll->master_except);
+  if (events & FC_POLL_IN) {
+    FD_SET(fd, &ppoll->master_in);
+  }
+  if (events & FC_POLL_OUT) {
+    FD_SET(fd, &ppoll->master_out);
+  }
+  if (events & FC_POLL_EXCEPT) {
+    FD_SET(fd, &ppoll->master_except);
+  }
+  ppoll->interest[fd] = events;
+
+  return TRUE;
+}
+
+/**********************************************************************
+  Wait with select(). Scans the registered descriptor range once for
+  the ready ones.
+***********************************************************************/
+static int select_wait(struct fc_poll *ppoll, int events, int timeout_ms,
+                       struct fc_poll_event *ready, int max_ready)
+{
+  fd_set readfs, writefs, exceptfs;
+  struct timeval tv;
+  int fd, count, num = 0;
+
+  if (events & FC_POLL_IN) {
+    readfs = ppoll->master_in;
+  } else {
+    FC_FD_ZERO(&readfs);
+  }
+  if (events & FC_POLL_OUT) {
+    writefs = ppoll->master_out;
+  } else {
+    FC_FD_ZERO(&writefs);
+  }
+  if (events & FC_POLL_EXCEPT) {
+    exceptfs = ppoll->master_except;
+  } else {
+    FC_FD_ZERO(&exceptfs);
+  }
+
+  count = fc_select(ppoll->max_fd + 1, &readfs, &writefs, &exceptfs,
+                    fc_poll_timeval(&tv, timeout_ms));
+  if (0 >= count) {
+    return count;
+  }
+
+  for (fd = 0; fd <= ppoll->max_fd && num < max_ready; fd++) {
+    int revents = 0;
+
+    if (0 == ppoll->interest[fd]) {
+      continue;
+    }
+    if (FD_ISSET(fd, &readfs)) {
+      revents |= FC_POLL_IN;
+    }
+    if (FD_ISSET(fd, &writefs)) {
+      revents |= FC_POLL_OUT;
+    }
+    if (FD_ISSET(fd, &exceptfs)) {
+      revents |= FC_POLL_EXCEPT;
+    }
+    if (0 != revents) {
+      ready[num].fd = fd;
+      ready[num].events = revents;
+      ready[num].data = ppoll->data[fd];
+      num++;
+    }
+  }
+
+  return num;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/**********************************************************************
+  Change the registration of 'fd' in one of the epoll instances.
+  'old_mask' and 'new_mask' are the epoll event masks.
+***********************************************************************/
+static bool epoll_update(int epfd, int fd, unsigned int old_mask,
+                         unsigned int new_mask)
+{
+  struct epoll_event ev;
+
+  if (old_mask == new_mask) {
+    return TRUE;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = new_mask;
+  ev.data.fd = fd;
+
+  if (0 == new_mask) {
+    /* The descriptor may already be closed, which removed it. */
+    (void) epoll_ctl(epfd, EPOLL_CTL_DEL, fd, &ev);
+    return TRUE;
+  }
+
+  if (0 != old_mask) {
+    if (0 == epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev)) {
+      return TRUE;
+    }
+    if (ENOENT != errno) {
+      return FALSE;
+    }
+    /* Closed and reopened behind our back; register it again. */
+  }
+
+  return 0 == epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**********************************************************************
+  Add or remove 'fd' from the list of always ready descriptors.
+***********************************************************************/
+static void epoll_set_always(struct fc_poll *ppoll, int fd, bool always)
+{
+  int i;
+
+  for (i = 0; i < ppoll->num_always; i++) {
+    if (ppoll->always[i] == fd) {
+      if (!always) {
+        ppoll->always[i] = ppoll->always[--ppoll->num_always];
+      }
+      return;
+    }
+  }
+
+  if (always) {
+    ppoll->always = fc_realloc(ppoll->always, (ppoll->num_always + 1)
+                                              * sizeof(*ppoll->always));
+    ppoll->always[ppoll->num_always++] = fd;
+  }
+}
+
+/**********************************************************************
+  Update the epoll registration of 'fd'.
+***********************************************************************/
+static bool epoll_set(struct fc_poll *ppoll, int fd, int events)
+{
+  int old = ppoll->interest[fd];
+  unsigned int old_in = 0, old_out = 0, new_in = 0, new_out = 0;
+
+  if (old & FC_POLL_ALWAYS) {
+    if (0 == events) {
+      epoll_set_always(ppoll, fd, FALSE);
+      ppoll->interest[fd] = 0;
+    } else {
+      ppoll->interest[fd] = events | FC_POLL_ALWAYS;
+    }
+    return TRUE;
+  }
+
+  old_in = ((old & FC_POLL_IN) ? EPOLLIN : 0)
+           | ((old & FC_POLL_EXCEPT) ? EPOLLPRI : 0);
+  old_out = (old & FC_POLL_OUT) ? EPOLLOUT : 0;
+  new_in = ((events & FC_POLL_IN) ? EPOLLIN : 0)
+           | ((events & FC_POLL_EXCEPT) ? EPOLLPRI : 0);
+  new_out = (events & FC_POLL_OUT) ? EPOLLOUT : 0;
+
+  if (!epoll_update(ppoll->ep_in, fd, old_in, new_in)
+      || !epoll_update(ppoll->ep_out, fd, old_out, new_out)) {
+    if (EPERM == errno && 0 == old) {
+      /* Not pollable; select() would always report it ready. */
+      epoll_set_always(ppoll, fd, TRUE);
+      ppoll->interest[fd] = events | FC_POLL_ALWAYS;
+      return TRUE;
+    }
+    log_error("fc_poll: can't watch descriptor %d: %s",
+              fd, fc_strerror(fc_get_errno()));
+    return FALSE;
+  }
+  ppoll->interest[fd] = events;
+
+  return TRUE;
+}
+
+/**********************************************************************
+  Collect the events of one epoll instance into 'ready'.
+***********************************************************************/
+static int epoll_collect(struct fc_poll *ppoll, int epfd, int events,
+                         int timeout_ms, struct fc_poll_event *ready,
+                         int max_ready)
+{
+  int count, i, num = 0;
+
+  if (0 >= max_ready) {
+    return 0;
+  }
+
+  if (ppoll->num_ep_events < max_ready) {
+    ppoll->ep_events = fc_realloc(ppoll->ep_events,
+                                  max_ready * sizeof(*ppoll->ep_events));
+    ppoll->num_ep_events = max_ready;
+  }
+
+  count = epoll_wait(epfd, ppoll->ep_events, max_ready, timeout_ms);
+  if (0 >= count) {
+    return (0 > count && EINTR == errno) ? 0 : count;
+  }
+
+  for (i = 0; i < count; i++) {
+    int fd = ppoll->ep_events[i].data.fd;
+    unsigned int mask = ppoll->ep_events[i].events;
+    int revents = 0;
+
+    if (epfd == ppoll->ep_out) {
+      if (mask & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+        revents |= FC_POLL_OUT;
+      }
+    } else {
+      if (mask & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        /* Errors and hangups show up when the socket is read, as they
+         * do with select(). */
+        revents |= FC_POLL_IN;
+      }
+      if (mask & EPOLLPRI) {
+        revents |= FC_POLL_EXCEPT;
+      }
+    }
+
+    revents &= events & ppoll->interest[fd];
+    if (0 != revents) {
+      ready[num].fd = fd;
+      ready[num].events = revents;
+      ready[num].data = ppoll->data[fd];
+      num++;
+    }
+  }
+
+  return num;
+}
+
+/**********************************************************************
+  Wait with epoll.
+***********************************************************************/
+static int epoll_wait_ready(struct fc_poll *ppoll, int events,
+                            int timeout_ms, struct fc_poll_event *ready,
+                            int max_ready)
+{
+  bool want_in = (0 != (events & (FC_POLL_IN | FC_POLL_EXCEPT)));
+  bool want_out = (0 != (events & FC_POLL_OUT));
+  int i, num = 0, always = 0;
+
+  for (i = 0; i < ppoll->num_always; i++) {
+    if (0 != (ppoll->interest[ppoll->always[i]] & events)) {
+      always++;
+    }
+  }
+  if (0 < always) {
+    timeout_ms = 0;
+  }
+
+  if (want_in && want_out) {
+    struct epoll_event ev[2];
+    int count = epoll_wait(ppoll->ep_all, ev, ARRAY_SIZE(ev), timeout_ms);
+
+    if (0 > count && EINTR != errno) {
+      return -1;
+    }
+    if (0 < count) {
+      num = epoll_collect(ppoll, ppoll->ep_in, events, 0, ready, max_ready);
+      if (0 <= num) {
+        int out = epoll_collect(ppoll, ppoll->ep_out, events, 0,
+                                ready + num, max_ready - num);
+
+        num = (0 > out ? out : num + out);
+      }
+    }
+  } else if (want_in) {
+    num = epoll_collect(ppoll, ppoll->ep_in, events, timeout_ms,
+                        ready, max_ready);
+  } else if (want_out) {
+    num = epoll_collect(ppoll, ppoll->ep_out, events, timeout_ms,
+                        ready, max_ready);
+  }
+
+  if (0 > num) {
+    return num;
+  }
+
+  for (i = 0; i < ppoll->num_always && num < max_ready; i++) {
+    int fd = ppoll->always[i];
+    int revents = ppoll->interest[fd] & events & FC_POLL_ALL;
+
+    if (0 != revents) {
+      ready[num].fd = fd;
+      ready[num].events = revents;
+      ready[num].data = ppoll->data[fd];
+      num++;
+    }
+  }
+
+  return num;
+}
+
+/**********************************************************************
+  Create the epoll instances. Returns FALSE if epoll isn't usable.
+***********************************************************************/
+static bool epoll_init(struct fc_poll *ppoll)
+{
+  struct epoll_event ev;
+
+  ppoll->ep_all = epoll_create1(EPOLL_CLOEXEC);
+  ppoll->ep_in = epoll_create1(EPOLL_CLOEXEC);
+  ppoll->ep_out = epoll_create1(EPOLL_CLOEXEC);
+
+  if (0 <= ppoll->ep_all && 0 <= ppoll->ep_in && 0 <= ppoll->ep_out) {
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = ppoll->ep_in;
+    if (0 == epoll_ctl(ppoll->ep_all, EPOLL_CTL_ADD, ppoll->ep_in, &ev)) {
+      ev.data.fd = ppoll->ep_out;
+      if (0 == epoll_ctl(ppoll->ep_all, EPOLL_CTL_ADD, ppoll->ep_out,
+                         &ev)) {
+        return TRUE;
+      }
+    }
+  }
+
+  log_verbose("fc_poll: epoll not available: %s",
+              fc_strerror(fc_get_errno()));
+  if (0 <= ppoll->ep_all) {
+    close(ppoll->ep_all);
+  }
+  if (0 <= ppoll->ep_in) {
+    close(ppoll->ep_in);
+  }
+  if (0 <= ppoll->ep_out) {
+    close(ppoll->ep_out);
+  }
+
+  return FALSE;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/**********************************************************************
+  Create a new, empty poll set. With FC_POLL_BACKEND_AUTO the best
+  available backend is used. If the requested backend isn't available
+  the set falls back to select().
+***********************************************************************/
+struct fc_poll *fc_poll_new(enum fc_poll_backend backend)
+{
+  struct fc_poll *ppoll = fc_calloc(1, sizeof(*ppoll));
+
+  ppoll->max_fd = -1;
+  FC_FD_ZERO(&ppoll->master_in);
+  FC_FD_ZERO(&ppoll->master_out);
+  FC_FD_ZERO(&ppoll->master_except);
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (FC_POLL_BACKEND_SELECT != backend && epoll_init(ppoll)) {
+    ppoll->backend = FC_POLL_BACKEND_EPOLL;
+  } else {
+    ppoll->backend = FC_POLL_BACKEND_SELECT;
+  }
+#else  /* HAVE_SYS_EPOLL_H */
+  ppoll->backend = FC_POLL_BACKEND_SELECT;
+#endif /* HAVE_SYS_EPOLL_H */
+
+  return ppoll;
+}
+
+/**********************************************************************
+  Free a poll set. Registered descriptors are not closed.
+***********************************************************************/
+void fc_poll_destroy(struct fc_poll *ppoll)
+{
+  fc_assert_ret(NULL != ppoll);
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (FC_POLL_BACKEND_EPOLL == ppoll->backend) {
+    close(ppoll->ep_all);
+    close(ppoll->ep_in);
+    close(ppoll->ep_out);
+    free(ppoll->ep_events);
+    free(ppoll->always);
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  free(ppoll->interest);
+  free(ppoll->data);
+  free(ppoll);
+}
+
+/**********************************************************************
+  Name of the backend the poll set uses.
+***********************************************************************/
+const char *fc_poll_backend_name(const struct fc_poll *ppoll)
+{
+  switch (ppoll->backend) {
+  case FC_POLL_BACKEND_EPOLL:
+    return "epoll";
+  case FC_POLL_BACKEND_SELECT:
+  case FC_POLL_BACKEND_AUTO:
+    break;
+  }
+
+  return "select";
+}
+
+/**********************************************************************
+  Set the FC_POLL_* events 'fd' is watched for, and the user data
+  reported with them. Registers the descriptor when it wasn't yet;
+  'events' == 0 unregisters it. Setting the current interest again is
+  cheap, no system call is made then.
+***********************************************************************/
+bool fc_poll_set(struct fc_poll *ppoll, int fd, int events, void *data)
+{
+  bool ok;
+
+  fc_assert_ret_val(NULL != ppoll, FALSE);
+  fc_assert_ret_val(0 <= fd, FALSE);
+
+  events &= FC_POLL_ALL;
+  if (fd >= ppoll->num_slots) {
+    if (0 == events) {
+      return TRUE;
+    }
+    fc_poll_ensure_slot(ppoll, fd);
+  }
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (FC_POLL_BACKEND_EPOLL == ppoll->backend) {
+    ok = epoll_set(ppoll, fd, events);
+  } else
+#endif /* HAVE_SYS_EPOLL_H */
+  {
+    ok = select_set(ppoll, fd, events);
+  }
+
+  if (!ok) {
+    return FALSE;
+  }
+
+  ppoll->data[fd] = (0 == events ? NULL : data);
+  if (0 != events) {
+    ppoll->max_fd = MAX(ppoll->max_fd, fd);
+  } else {
+    while (0 <= ppoll->max_fd && 0 == ppoll->interest[ppoll->max_fd]) {
+      ppoll->max_fd--;
+    }
+  }
+
+  return TRUE;
+}
+
+/**********************************************************************
+  Return the FC_POLL_* events 'fd' is currently watched for.
+***********************************************************************/
+int fc_poll_get(const struct fc_poll *ppoll, int fd)
+{
+  if (0 > fd || fd >= ppoll->num_slots) {
+    return 0;
+  }
+
+  return ppoll->interest[fd] & FC_POLL_ALL;
+}
+
+/**********************************************************************
+  Wait up to 'timeout_ms' milliseconds (forever if negative) for any of
+  the 'events' on the registered descriptors. Fills at most 'max_ready'
+  entries of 'ready' and returns their number, 0 on timeout or -1 on
+  error. A descriptor may be reported in more than one entry. Readiness
+  is level triggered: events not handled are reported again.
+***********************************************************************/
+int fc_poll_wait(struct fc_poll *ppoll, int events, int timeout_ms,
+                 struct fc_poll_event *ready, int max_ready)
+{
+  fc_assert_ret_val(NULL != ppoll, -1);
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (FC_POLL_BACKEND_EPOLL == ppoll->backend) {
+    return epoll_wait_ready(ppoll, events, timeout_ms, ready, max_ready);
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  return select_wait(ppoll, events, timeout_ms, ready, max_ready);
+}
@@ -0,0 +1,66 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifndef FC__FCPOLL_H
+#define FC__FCPOLL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**********************************************************************
+  Socket readiness notification.
+
+  A poll set keeps the registered descriptors and their interest
+  persistently between waits, so callers only have to tell it about
+  changes. fc_poll_wait() reports just the descriptors that are ready.
+  On systems providing epoll(7) it is used; otherwise the set falls
+  back to select().
+***********************************************************************/
+
+#include "support.h"            /* bool type */
+
+/* Interest and readiness flags. */
+#define FC_POLL_IN      (1 << 0)
+#define FC_POLL_OUT     (1 << 1)
+#define FC_POLL_EXCEPT  (1 << 2)
+#define FC_POLL_ALL     (FC_POLL_IN | FC_POLL_OUT | FC_POLL_EXCEPT)
+
+enum fc_poll_backend {
+  FC_POLL_BACKEND_AUTO,         /* Best one available. */
+  FC_POLL_BACKEND_SELECT,
+  FC_POLL_BACKEND_EPOLL
+};
+
+struct fc_poll_event {
+  int fd;
+  int events;                   /* FC_POLL_* flags that are ready. */
+  void *data;                   /* As given to fc_poll_set(). */
+};
+
+struct fc_poll;
+
+struct fc_poll *fc_poll_new(enum fc_poll_backend backend);
+void fc_poll_destroy(struct fc_poll *ppoll);
+const char *fc_poll_backend_name(const struct fc_poll *ppoll);
+
+bool fc_poll_set(struct fc_poll *ppoll, int fd, int events, void *data);
+int fc_poll_get(const struct fc_poll *ppoll, int fd);
+int fc_poll_wait(struct fc_poll *ppoll, int events, int timeout_ms,
+                 struct fc_poll_event *ready, int max_ready);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif  /* FC__FCPOLL_H */
@@ -152,6 +152,14 @@ void fc_thread_cond_signal(fc_thread_cond *cond)
   pthread_cond_signal(cond);
 }
 
+/**********************************************************************
+  Signal all threads waiting on the condition to continue
+***********************************************************************/
+void fc_thread_cond_broadcast(fc_thread_cond *cond)
+{
+  pthread_cond_broadcast(cond);
+}
+
 #elif defined(HAVE_WINTHREADS)
 
 struct fc_thread_wrap_data {
@@ -282,6 +290,12 @@ void fc_thread_cond_wait(fc_thread_cond *cond, fc_mutex *mutex)
 void fc_thread_cond_signal(fc_thread_cond *cond)
 {}
 
+/**********************************************************************
+  Dummy fc_thread_cond_broadcast()
+***********************************************************************/
+void fc_thread_cond_broadcast(fc_thread_cond *cond)
+{}
+
 #endif /* !HAVE_THREAD_COND */
 
 /**********************************************************************
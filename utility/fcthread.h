@@ -57,6 +57,7 @@ void fc_thread_cond_init(fc_thread_cond *cond);
 void fc_thread_cond_destroy(fc_thread_cond *cond);
 void fc_thread_cond_wait(fc_thread_cond *cond, fc_mutex *mutex);
 void fc_thread_cond_signal(fc_thread_cond *cond);
+void fc_thread_cond_broadcast(fc_thread_cond *cond);
 
 bool has_thread_cond_impl(void);
 
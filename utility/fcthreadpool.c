@@ -0,0 +1,191 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+/* utility */
+#include "fcthread.h"
+#include "log.h"
+#include "mem.h"
+
+#include "fcthreadpool.h"
+
+struct fc_threadpool {
+  int num_threads;
+  fc_thread *threads;
+
+  fc_mutex mutex;
+  fc_thread_cond work_cond;     /* A new job was posted, or quit. */
+  fc_thread_cond done_cond;     /* The last worker finished the job. */
+
+  /* Protected by 'mutex'. */
+  bool quit;
+  unsigned int generation;      /* Bumped for every job. */
+  fc_threadpool_func func;
+  void *data;
+  int count;
+  int next;                     /* Next index to hand out. */
+  int busy;                     /* Workers still on the current job. */
+};
+
+/**********************************************************************
+  Hand out indices of the current job until there are none left.
+  Called with the pool mutex held, returns with it held.
+***********************************************************************/
+static void fc_threadpool_work(struct fc_threadpool *pool)
+{
+  while (pool->next < pool->count) {
+    int idx = pool->next++;
+
+    fc_release_mutex(&pool->mutex);
+    pool->func(idx, pool->data);
+    fc_allocate_mutex(&pool->mutex);
+  }
+}
+
+/**********************************************************************
+  Main function of the worker threads.
+***********************************************************************/
+static void fc_threadpool_worker(void *arg)
+{
+  struct fc_threadpool *pool = (struct fc_threadpool *) arg;
+  /* Not read from the pool: a job may already have been posted before
+   * this thread got to run. */
+  unsigned int seen = 0;
+
+  fc_allocate_mutex(&pool->mutex);
+
+  while (TRUE) {
+    while (!pool->quit && pool->generation == seen) {
+      fc_thread_cond_wait(&pool->work_cond, &pool->mutex);
+    }
+    if (pool->quit) {
+      break;
+    }
+    seen = pool->generation;
+
+    fc_threadpool_work(pool);
+
+    if (--pool->busy == 0) {
+      fc_thread_cond_signal(&pool->done_cond);
+    }
+  }
+
+  fc_release_mutex(&pool->mutex);
+}
+
+/**********************************************************************
+  Create a pool with 'num_threads' worker threads in addition to the
+  calling thread. Without condition variable support no workers are
+  started and fc_threadpool_run() works serially.
+***********************************************************************/
+struct fc_threadpool *fc_threadpool_new(int num_threads)
+{
+  struct fc_threadpool *pool = fc_calloc(1, sizeof(*pool));
+  int i;
+
+  fc_init_mutex(&pool->mutex);
+  fc_thread_cond_init(&pool->work_cond);
+  fc_thread_cond_init(&pool->done_cond);
+
+  if (num_threads <= 0 || !has_thread_cond_impl()) {
+    return pool;
+  }
+
+  pool->threads = fc_calloc(num_threads, sizeof(*pool->threads));
+  for (i = 0; i < num_threads; i++) {
+    if (fc_thread_start(&pool->threads[i], fc_threadpool_worker, pool)
+        != 0) {
+      log_error("Failed to start worker thread %d of %d.",
+                i + 1, num_threads);
+      break;
+    }
+    pool->num_threads++;
+  }
+
+  return pool;
+}
+
+/**********************************************************************
+  Stop the worker threads and free the pool.
+***********************************************************************/
+void fc_threadpool_destroy(struct fc_threadpool *pool)
+{
+  int i;
+
+  fc_allocate_mutex(&pool->mutex);
+  pool->quit = TRUE;
+  fc_thread_cond_broadcast(&pool->work_cond);
+  fc_release_mutex(&pool->mutex);
+
+  for (i = 0; i < pool->num_threads; i++) {
+    fc_thread_wait(&pool->threads[i]);
+  }
+
+  fc_thread_cond_destroy(&pool->done_cond);
+  fc_thread_cond_destroy(&pool->work_cond);
+  fc_destroy_mutex(&pool->mutex);
+  free(pool->threads);
+  free(pool);
+}
+
+/**********************************************************************
+  Return the number of worker threads, not counting the caller.
+***********************************************************************/
+int fc_threadpool_num_threads(const struct fc_threadpool *pool)
+{
+  return pool->num_threads;
+}
+
+/**********************************************************************
+  Call func(i, data) for every i in [0, count), spread over the worker
+  threads and the calling thread. Returns once all calls are done.
+  Must not be called from inside a job of the same pool.
+***********************************************************************/
+void fc_threadpool_run(struct fc_threadpool *pool, int count,
+                       fc_threadpool_func func, void *data)
+{
+  int i;
+
+  if (count <= 0) {
+    return;
+  }
+
+  if (pool->num_threads == 0 || count == 1) {
+    for (i = 0; i < count; i++) {
+      func(i, data);
+    }
+    return;
+  }
+
+  fc_allocate_mutex(&pool->mutex);
+  fc_assert(pool->busy == 0);
+  pool->func = func;
+  pool->data = data;
+  pool->count = count;
+  pool->next = 0;
+  pool->busy = pool->num_threads;
+  pool->generation++;
+  fc_thread_cond_broadcast(&pool->work_cond);
+
+  fc_threadpool_work(pool);
+
+  while (pool->busy > 0) {
+    fc_thread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+  pool->func = NULL;
+  pool->data = NULL;
+  fc_release_mutex(&pool->mutex);
+}
@@ -0,0 +1,49 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifndef FC__FCTHREADPOOL_H
+#define FC__FCTHREADPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**********************************************************************
+  A fixed set of worker threads for data parallel loops.
+
+  fc_threadpool_run() calls 'func' once for every index in
+  [0, count) and returns when all the calls have finished. The calling
+  thread takes part in the work, so a pool without worker threads
+  simply runs the loop serially. The order in which the indices are
+  handled is unspecified; 'func' must only touch data owned by its
+  index, or data nobody writes during the run.
+***********************************************************************/
+
+#include "support.h"            /* bool type */
+
+typedef void (*fc_threadpool_func)(int index, void *data);
+
+struct fc_threadpool;
+
+struct fc_threadpool *fc_threadpool_new(int num_threads);
+void fc_threadpool_destroy(struct fc_threadpool *pool);
+int fc_threadpool_num_threads(const struct fc_threadpool *pool);
+
+void fc_threadpool_run(struct fc_threadpool *pool, int count,
+                       fc_threadpool_func func, void *data);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif  /* FC__FCTHREADPOOL_H */
@@ -26,6 +26,12 @@
   The data pointed to should not be modified.  The retuned pointer
   is valid _only_ until another inputfile is performed.  (So should
   be used immediately, or fc_strdup-ed etc.)
+
+  The whole file is read into memory when it is opened; uncompressed
+  files are mapped rather than read where possible. Lines are '\0'
+  terminated in place, and most tokens are returned as pointers into
+  the line, '\0' terminated in place until the next inputfile call,
+  so reading a file copies hardly any data.
   
   The tokens recognised are as follows:
   (Single quotes are delimiters used here, but are not part of the
@@ -71,6 +77,14 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 /* utility */
 #include "astring.h"
 #include "ioz.h"
@@ -89,12 +103,24 @@
 struct inputfile {
   unsigned int magic;		/* memory check */
   char *filename;		/* filename as passed to fopen */
-  fz_FILE *fp;			/* read from this */
+  fz_FILE *fp;			/* read from this; NULL when mapped */
+  char *data;			/* contents of the whole file, with room
+				   for a trailing '\0' */
+  size_t data_len;		/* length of the file contents */
+  size_t data_pos;		/* start of the next line in data */
+  bool mapped;			/* data is mapped rather than allocated */
   bool at_eof;			/* flag for end-of-file */
-  struct astring cur_line;	/* data from current line */
+  char *cur_line;		/* current line, within data; NULL or
+				   empty if there is none */
+  int cur_line_len;		/* length of current line */
   int cur_line_pos;		/* position in current line */
   int line_num;			/* line number from file in cur_line */
-  struct astring token;		/* data returned to user */
+  char *token_end;		/* where the token last returned to the
+				   user has been '\0' terminated within
+				   cur_line, or NULL */
+  char token_end_char;		/* character overwritten at token_end */
+  struct astring token;		/* data returned to user, for tokens
+				   which are not within cur_line */
   struct astring partial;	/* used in accumulating multi-line strings;
 				   used only in get_token_value, but put
 				   here so it gets freed when file closed */
@@ -165,12 +191,18 @@ static void init_zeros(struct inputfile *inf)
   inf->magic = INF_MAGIC;
   inf->filename = NULL;
   inf->fp = NULL;
+  inf->data = NULL;
+  inf->data_len = inf->data_pos = 0;
+  inf->mapped = FALSE;
   inf->datafn = NULL;
   inf->included_from = NULL;
+  inf->cur_line = NULL;
+  inf->cur_line_len = 0;
   inf->line_num = inf->cur_line_pos = 0;
+  inf->token_end = NULL;
+  inf->token_end_char = '\0';
   inf->at_eof = inf->in_string = FALSE;
   inf->string_start_line = 0;
-  astr_init(&inf->cur_line);
   astr_init(&inf->token);
   astr_init(&inf->partial);
 }
@@ -182,7 +214,8 @@ static bool inf_sanity_check(struct inputfile *inf)
 {
   fc_assert_ret_val(NULL != inf, FALSE);
   fc_assert_ret_val(INF_MAGIC == inf->magic, FALSE);
-  fc_assert_ret_val(NULL != inf->fp, FALSE);
+  fc_assert_ret_val(NULL != inf->data, FALSE);
+  fc_assert_ret_val(inf->data_pos <= inf->data_len, FALSE);
   fc_assert_ret_val(0 <= inf->line_num, FALSE);
   fc_assert_ret_val(0 <= inf->cur_line_pos, FALSE);
   fc_assert_ret_val(FALSE == inf->at_eof
@@ -211,6 +244,74 @@ static const char *inf_filename(struct inputfile *inf)
   }
 }
 
+/**********************************************************************
+  Map an uncompressed file into memory, as inf->data. Returns FALSE if
+  this is not possible, e.g. because the file is compressed.
+***********************************************************************/
+static bool inf_map_file(struct inputfile *inf, const char *filename)
+{
+#ifdef HAVE_SYS_MMAN_H
+  FILE *plain = fc_fopen(filename, "rb");
+  unsigned char header[6];
+  struct stat st;
+  size_t len;
+  char *map;
+
+  if (NULL == plain) {
+    return FALSE;
+  }
+  len = fread(header, 1, sizeof(header), plain);
+  if (fz_header_is_compressed(header, len)
+      || 0 != fstat(fileno(plain), &st) || 0 >= st.st_size) {
+    fclose(plain);
+    return FALSE;
+  }
+
+  /* Private and writable: lines and tokens are '\0' terminated in
+   * place, which only copies the pages touched. */
+  map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+             fileno(plain), 0);
+  fclose(plain);
+  if (MAP_FAILED == map) {
+    return FALSE;
+  }
+
+  /* The '\0' after the last line goes over its newline, or into the
+   * zero filled rest of the last page. */
+  if ('\n' != map[st.st_size - 1]
+      && 0 == st.st_size % sysconf(_SC_PAGESIZE)) {
+    munmap(map, st.st_size);
+    return FALSE;
+  }
+
+  inf->data = map;
+  inf->data_len = st.st_size;
+  inf->mapped = TRUE;
+  return TRUE;
+#else  /* HAVE_SYS_MMAN_H */
+  return FALSE;
+#endif /* HAVE_SYS_MMAN_H */
+}
+
+/**********************************************************************
+  Read the whole stream, uncompressing it if needed, into inf->data.
+***********************************************************************/
+static void inf_read_stream(struct inputfile *inf)
+{
+  size_t alloc = 0;
+
+  do {
+    if (inf->data_len + 1 >= alloc) {
+      alloc = MAX(2 * alloc, 64 * 1024);
+      inf->data = fc_realloc(inf->data, alloc);
+    }
+    inf->data_len += fz_fread(inf->data + inf->data_len,
+                              alloc - inf->data_len - 1, inf->fp);
+  } while (inf->data_len + 1 == alloc);
+
+  inf->data[inf->data_len] = '\0';
+}
+
 /********************************************************************** 
   Open the file, and return an allocated, initialized structure.
   Returns NULL if the file could not be opened.
@@ -223,13 +324,23 @@ struct inputfile *inf_from_file(const char *filename,
 
   fc_assert_ret_val(NULL != filename, NULL);
   fc_assert_ret_val(0 < strlen(filename), NULL);
-  fp = fz_from_file(filename, "r", -1, 0);
-  if (!fp) {
-    return NULL;
+
+  inf = fc_malloc(sizeof(*inf));
+  init_zeros(inf);
+  inf->datafn = datafn;
+
+  if (!inf_map_file(inf, filename)) {
+    fp = fz_from_file(filename, "r", -1, 0);
+    if (!fp) {
+      free(inf);
+      return NULL;
+    }
+    inf->fp = fp;
+    inf_read_stream(inf);
   }
-  log_debug("inputfile: opened \"%s\" ok", filename);
-  inf = inf_from_stream(fp, datafn);
+
   inf->filename = fc_strdup(filename);
+  log_debug("inputfile: opened \"%s\" ok", filename);
   return inf;
 }
 
@@ -248,6 +359,7 @@ struct inputfile *inf_from_stream(fz_FILE * stream, datafilename_fn_t datafn)
   inf->filename = NULL;
   inf->fp = stream;
   inf->datafn = datafn;
+  inf_read_stream(inf);
 
   log_debug("inputfile: opened \"%s\" ok", inf_filename(inf));
   return inf;
@@ -266,7 +378,9 @@ static void inf_close_partial(struct inputfile *inf)
 
   log_debug("inputfile: sub-closing \"%s\"", inf_filename(inf));
 
-  if (fz_ferror(inf->fp) != 0) {
+  if (NULL == inf->fp) {
+    /* Mapped file. */
+  } else if (fz_ferror(inf->fp) != 0) {
     log_error("Error before closing %s: %s", inf_filename(inf),
               fz_strerror(inf->fp));
     fz_fclose(inf->fp);
@@ -275,11 +389,18 @@ static void inf_close_partial(struct inputfile *inf)
   else if (fz_fclose(inf->fp) != 0) {
     log_error("Error closing %s", inf_filename(inf));
   }
+#ifdef HAVE_SYS_MMAN_H
+  if (inf->mapped) {
+    munmap(inf->data, inf->data_len);
+  } else
+#endif /* HAVE_SYS_MMAN_H */
+  {
+    free(inf->data);
+  }
   if (inf->filename) {
     free(inf->filename);
   }
   inf->filename = NULL;
-  astr_free(&inf->cur_line);
   astr_free(&inf->token);
   astr_free(&inf->partial);
 
@@ -315,7 +436,7 @@ void inf_close(struct inputfile *inf)
 static bool have_line(struct inputfile *inf)
 {
   fc_assert_ret_val(inf_sanity_check(inf), FALSE);
-  return !astr_empty(&inf->cur_line);
+  return 0 < inf->cur_line_len;
 }
 
 /********************************************************************** 
@@ -324,8 +445,8 @@ static bool have_line(struct inputfile *inf)
 static bool at_eol(struct inputfile *inf)
 {
   fc_assert_ret_val(inf_sanity_check(inf), TRUE);
-  fc_assert_ret_val(inf->cur_line_pos <= astr_len(&inf->cur_line), TRUE);
-  return (inf->cur_line_pos >= astr_len(&inf->cur_line));
+  fc_assert_ret_val(inf->cur_line_pos <= inf->cur_line_len, TRUE);
+  return (inf->cur_line_pos >= inf->cur_line_len);
 }
 
 /********************************************************************** 
@@ -358,11 +479,11 @@ static bool check_include(struct inputfile *inf)
     len = strlen(include_prefix);
   }
   fc_assert_ret_val(inf_sanity_check(inf), FALSE);
-  if (inf->in_string || astr_len(&inf->cur_line) <= len
+  if (inf->in_string || inf->cur_line_len <= len
       || inf->cur_line_pos > 0) {
     return FALSE;
   }
-  if (strncmp(astr_str(&inf->cur_line), include_prefix, len) != 0) {
+  if (strncmp(inf->cur_line, include_prefix, len) != 0) {
     return FALSE;
   }
   /* from here, the include-line must be well formed */
@@ -370,7 +491,7 @@ static bool check_include(struct inputfile *inf)
 
   /* skip any whitespace: */
   inf->cur_line_pos = len;
-  c = astr_str(&inf->cur_line) + len;
+  c = inf->cur_line + len;
   while (*c != '\0' && fc_isspace(*c)){
     c++;
   }
@@ -381,7 +502,7 @@ static bool check_include(struct inputfile *inf)
     return FALSE;
   }
   c++;
-  inf->cur_line_pos = c - astr_str(&inf->cur_line);
+  inf->cur_line_pos = c - inf->cur_line;
 
   bare_name_start = c;
   while (*c != '\0' && *c != '\"') c++;
@@ -395,7 +516,7 @@ static bool check_include(struct inputfile *inf)
   bare_name = fc_malloc(bare_name_len);
   strncpy(bare_name, bare_name_start, bare_name_len - 1);
   bare_name[bare_name_len - 1] = '\0';
-  inf->cur_line_pos = c - astr_str(&inf->cur_line);
+  inf->cur_line_pos = c - inf->cur_line;
 
   /* check rest of line is well-formed: */
   while (*c != '\0' && fc_isspace(*c) && !is_comment(*c)) {
@@ -405,7 +526,7 @@ static bool check_include(struct inputfile *inf)
     inf_log(inf, LOG_ERROR, "Junk after filename for '*include' line");
     return FALSE;
   }
-  inf->cur_line_pos = astr_len(&inf->cur_line) - 1;
+  inf->cur_line_pos = inf->cur_line_len - 1;
 
   full_name = inf->datafn(bare_name);
   if (!full_name) {
@@ -441,7 +562,7 @@ static bool check_include(struct inputfile *inf)
   return TRUE;
 }
 
-/********************************************************************** 
+/**********************************************************************
   Read a new line into cur_line.
   Increments line_num and cur_line_pos.
   Returns 0 if didn't read or other problem: treat as EOF.
@@ -449,9 +570,7 @@ static bool check_include(struct inputfile *inf)
 ***********************************************************************/
 static bool read_a_line(struct inputfile *inf)
 {
-  struct astring *line;
-  char *ret;
-  int pos;
+  char *line, *end;
 
   fc_assert_ret_val(inf_sanity_check(inf), FALSE);
 
@@ -459,67 +578,17 @@ static bool read_a_line(struct inputfile *inf)
     return FALSE;
   }
 
-  /* abbreviation: */
-  line = &inf->cur_line;
-
-  /* minimum initial line length: */
-  astr_reserve(line, 80);
-  astr_clear(line);
-  pos = 0;
-
-  /* Read until we get a full line:
-   * At start of this loop, pos is index to trailing null
-   * (or first position) in line.
-   */
-  for(;;) {
-    ret = fz_fgets((char *) astr_str(line) + pos,
-                   astr_capacity(line) - pos, inf->fp);
-
-    if (!ret) {
-      /* fgets failed */
-      inf->at_eof = TRUE;
-      if (inf->in_string) {
-        /* Note: Don't allow multi-line strings to cross "include"
-         * boundaries */
-        inf_log(inf, LOG_ERROR, "Multi-line string went to end-of-file");
-        return FALSE;
-      }
-      break;
+  if (inf->data_pos >= inf->data_len) {
+    inf->at_eof = TRUE;
+    inf->cur_line = NULL;
+    inf->cur_line_len = 0;
+    if (inf->in_string) {
+      /* Note: Don't allow multi-line strings to cross "include"
+       * boundaries */
+      inf_log(inf, LOG_ERROR, "Multi-line string went to end-of-file");
+      return FALSE;
     }
 
-    /* Cope with \n\r line endings if not caught by library:
-     * strip off any leading \r */
-    if (0 == pos && 0 < astr_len(line) && astr_str(line)[0] == '\r') {
-      memmove((char *)astr_str(line), astr_str(line)+1, astr_len(line));
-    }
-
-    pos = astr_len(line);
-
-    if (0 < pos && astr_str(line)[pos - 1] == '\n') {
-      int end;
-      /* Cope with \r\n line endings if not caught by library:
-       * strip off any trailing \r */
-      if (1 < pos && astr_str(line)[pos - 2] == '\r') {
-        end = pos - 2;
-      } else {
-        end = pos - 1;
-      }
-      *((char *) astr_str(line) + end) = '\0';
-      break;
-    }
-    astr_reserve(line, pos * 2);
-  }
-
-  if (!inf->at_eof) {
-    inf->line_num++;
-    inf->cur_line_pos = 0;
-
-    if (check_include(inf)) {
-      return read_a_line(inf);
-    }
-    return TRUE;
-  } else {
-    astr_clear(line);
     if (inf->included_from) {
       /* Pop the include, and get next line from file above instead. */
       struct inputfile *inc = inf->included_from;
@@ -531,6 +600,65 @@ static bool read_a_line(struct inputfile *inf)
     }
     return FALSE;
   }
+
+  line = inf->data + inf->data_pos;
+  end = memchr(line, '\n', inf->data_len - inf->data_pos);
+  if (NULL != end) {
+    inf->data_pos = end + 1 - inf->data;
+  } else {
+    end = inf->data + inf->data_len;
+    inf->data_pos = inf->data_len;
+  }
+
+  /* Cope with \n\r line endings if not caught by library:
+   * strip off any leading \r */
+  if (line < end && '\r' == *line) {
+    line++;
+  }
+  /* Cope with \r\n line endings if not caught by library:
+   * strip off any trailing \r */
+  if (line < end && '\r' == end[-1]) {
+    end--;
+  }
+  *end = '\0';
+
+  inf->cur_line = line;
+  inf->cur_line_len = end - line;
+  inf->line_num++;
+  inf->cur_line_pos = 0;
+
+  if (check_include(inf)) {
+    return read_a_line(inf);
+  }
+  return TRUE;
+}
+
+/**********************************************************************
+  Return the part of the current line from 'start' to 'end' as token,
+  without copying it: it is '\0' terminated in place, until the next
+  call of inf_token_release().
+***********************************************************************/
+static const char *inf_token_view(struct inputfile *inf,
+                                  const char *start, const char *end)
+{
+  fc_assert(NULL == inf->token_end);
+
+  inf->token_end = (char *) end;
+  inf->token_end_char = *end;
+  *inf->token_end = '\0';
+  return start;
+}
+
+/**********************************************************************
+  Restore the character overwritten to terminate the last token
+  returned by inf_token_view(), if any.
+***********************************************************************/
+static void inf_token_release(struct inputfile *inf)
+{
+  if (NULL != inf->token_end) {
+    *inf->token_end = inf->token_end_char;
+    inf->token_end = NULL;
+  }
 }
 
 /**********************************************************************
@@ -558,9 +686,17 @@ char *inf_log_str(struct inputfile *inf, const char *message, ...)
                inf_filename(inf), inf->line_num, inf->cur_line_pos,
                (inf->at_eof ? ", EOF" : ""));
 
-  if (!astr_empty(&inf->cur_line)) {
+  if (0 < inf->cur_line_len) {
+    /* Show the line as it is, even if the last token is still '\0'
+     * terminated within it. */
+    if (NULL != inf->token_end) {
+      *inf->token_end = inf->token_end_char;
+    }
     cat_snprintf(str, sizeof(str), "\n  looking at: '%s'",
-                 astr_str(&inf->cur_line) + inf->cur_line_pos);
+                 inf->cur_line + inf->cur_line_pos);
+    if (NULL != inf->token_end) {
+      *inf->token_end = '\0';
+    }
   }
   if (inf->in_string) {
     cat_snprintf(str, sizeof(str),
@@ -587,6 +723,8 @@ const char *inf_token(struct inputfile *inf, enum inf_token_type type)
   fc_assert_ret_val(inf_sanity_check(inf), NULL);
   fc_assert_ret_val(INF_TOK_FIRST <= type && INF_TOK_LAST > type, NULL);
 
+  inf_token_release(inf);
+
   name = tok_tab[type].name ? tok_tab[type].name : "(unnamed)";
   func = tok_tab[type].func;
 
@@ -604,7 +742,7 @@ const char *inf_token(struct inputfile *inf, enum inf_token_type type)
     }
   }
   if (c && INF_DEBUG_FOUND) {
-    log_debug("inputfile: found %s '%s'", name, astr_str(&inf->token));
+    log_debug("inputfile: found %s '%s'", name, c);
   }
   return c;
 }
@@ -633,7 +771,7 @@ static const char *get_token_section_name(struct inputfile *inf)
 
   fc_assert_ret_val(have_line(inf), NULL);
 
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
+  c = inf->cur_line + inf->cur_line_pos;
   if (*c++ != '[') {
     return NULL;
   }
@@ -644,11 +782,8 @@ static const char *get_token_section_name(struct inputfile *inf)
   if (*c != ']') {
     return NULL;
   }
-  *((char *) c) = '\0'; /* Tricky. */
-  astr_set(&inf->token, "%s", start);
-  *((char *) c) = ']';  /* Revert. */
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  return astr_str(&inf->token);
+  inf->cur_line_pos = c + 1 - inf->cur_line;
+  return inf_token_view(inf, start, c);
 }
 
 /********************************************************************** 
@@ -658,11 +793,10 @@ static const char *get_token_section_name(struct inputfile *inf)
 static const char *get_token_entry_name(struct inputfile *inf)
 {
   const char *c, *start, *end;
-  char trailing;
 
   fc_assert_ret_val(have_line(inf), NULL);
 
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
+  c = inf->cur_line + inf->cur_line_pos;
   while (*c != '\0' && fc_isspace(*c)) {
     c++;
   }
@@ -683,12 +817,8 @@ static const char *get_token_entry_name(struct inputfile *inf)
   if (*c != '=') {
     return NULL;
   }
-  trailing = *end;
-  *((char *) end) = '\0';       /* Tricky. */
-  astr_set(&inf->token, "%s", start);
-  *((char *) end) = trailing;   /* Revert. */
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  return astr_str(&inf->token);
+  inf->cur_line_pos = c + 1 - inf->cur_line;
+  return inf_token_view(inf, start, end);
 }
 
 /********************************************************************** 
@@ -702,7 +832,7 @@ static const char *get_token_eol(struct inputfile *inf)
   fc_assert_ret_val(have_line(inf), NULL);
 
   if (!at_eol(inf)) {
-    c = astr_str(&inf->cur_line) + inf->cur_line_pos;
+    c = inf->cur_line + inf->cur_line_pos;
     while (*c != '\0' && fc_isspace(*c)) {
       c++;
     }
@@ -712,11 +842,11 @@ static const char *get_token_eol(struct inputfile *inf)
   }
 
   /* finished with this line: say that we don't have it any more: */
-  astr_clear(&inf->cur_line);
+  inf->cur_line = NULL;
+  inf->cur_line_len = 0;
   inf->cur_line_pos = 0;
 
-  astr_set(&inf->token, " ");
-  return astr_str(&inf->token);
+  return " ";
 }
 
 /********************************************************************** 
@@ -730,16 +860,15 @@ static const char *get_token_white_char(struct inputfile *inf,
 
   fc_assert_ret_val(have_line(inf), NULL);
 
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
+  c = inf->cur_line + inf->cur_line_pos;
   while (*c != '\0' && fc_isspace(*c)) {
     c++;
   }
   if (*c != target) {
     return NULL;
   }
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  astr_set(&inf->token, "%c", target);
-  return astr_str(&inf->token);
+  inf->cur_line_pos = c + 1 - inf->cur_line;
+  return inf_token_view(inf, c, c + 1);
 }
 
 /********************************************************************** 
@@ -773,13 +902,12 @@ static const char *get_token_value(struct inputfile *inf)
 {
   struct astring *partial;
   const char *c, *start;
-  char trailing;
   bool has_i18n_marking = FALSE;
   char border_character = '\"';
 
   fc_assert_ret_val(have_line(inf), NULL);
 
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
+  c = inf->cur_line + inf->cur_line_pos;
   while (*c != '\0' && fc_isspace(*c)) {
     c++;
   }
@@ -797,16 +925,9 @@ static const char *get_token_value(struct inputfile *inf)
     if (!(*c == '\0' || *c == ',' || fc_isspace(*c) || is_comment(*c))) {
       return NULL;
     }
-    /* If its a comma, we don't want to obliterate it permanently,
-     * so rememeber it: */
-    trailing = *c;
-    *((char *) c) = '\0';       /* Tricky. */
-
-    inf->cur_line_pos = c - astr_str(&inf->cur_line);
-    astr_set(&inf->token, "%s", start);
 
-    *((char *) c) = trailing;   /* Revert. */
-    return astr_str(&inf->token);
+    inf->cur_line_pos = c - inf->cur_line;
+    return inf_token_view(inf, start, c);
   }
 
   /* allow gettext marker: */
@@ -835,16 +956,9 @@ static const char *get_token_value(struct inputfile *inf)
     if (!(*c == '\0' || *c == ',' || fc_isspace(*c) || is_comment(*c))) {
       return NULL;
     }
-    /* If its a comma, we don't want to obliterate it permanently,
-     * so rememeber it: */
-    trailing = *c;
-    *((char *) c) = '\0';       /* Tricky. */
 
-    inf->cur_line_pos = c - astr_str(&inf->cur_line);
-    astr_set(&inf->token, "%s", start);
-
-    *((char *) c) = trailing;   /* Revert. */
-    return astr_str(&inf->token);
+    inf->cur_line_pos = c - inf->cur_line;
+    return inf_token_view(inf, start, c);
   }
 
   /* From here, we know we have a string, we just have to find the
@@ -892,26 +1006,26 @@ static const char *get_token_value(struct inputfile *inf)
               "Bad return for multi-line string from read_a_line");
       return NULL;
     }
-    c = start = astr_str(&inf->cur_line);
+    c = start = inf->cur_line;
   }
 
   /* found end of string */
-  trailing = *c;
-  *((char *) c) = '\0';         /* Tricky. */
-
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  astr_set(&inf->token, "%s%s", astr_str(partial), start);
-
-  *((char *) c) = trailing;     /* Revert. */
+  inf->cur_line_pos = c + 1 - inf->cur_line;
 
   /* check gettext tag at end: */
   if (has_i18n_marking) {
-    if (*++c == ')') {
+    if (*(c + 1) == ')') {
       inf->cur_line_pos++;
     } else {
       inf_warn(inf, "Missing end of i18n string marking");
     }
   }
   inf->in_string = FALSE;
+
+  if (astr_empty(partial)) {
+    return inf_token_view(inf, start, c);
+  }
+  astr_set(&inf->token, "%s%.*s", astr_str(partial), (int) (c - start),
+           start);
   return astr_str(&inf->token);
 }
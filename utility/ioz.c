@@ -34,6 +34,7 @@
 #endif
 
 #include <errno.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -151,6 +152,22 @@ static inline bool fz_method_is_valid(enum fz_method method)
                       "Unsupported compress method %d, reverting to plain.",\
                       method), FZ_PLAIN))
 
+/***************************************************************
+  Returns whether data starting with the given bytes looks like
+  the start of a gzip, bzip2 or xz file. 'len' is the number of
+  bytes available, at least 6 are needed to recognize xz.
+  Anything else is read by fz_from_file() as plain data, so it can
+  also be read directly.
+***************************************************************/
+bool fz_header_is_compressed(const void *header, size_t len)
+{
+  const unsigned char *data = header;
+
+  return ((len >= 2 && 0x1f == data[0] && 0x8b == data[1])
+          || (len >= 3 && 0 == memcmp(data, "BZh", 3))
+          || (len >= 6 && 0 == memcmp(data, "\xfd" "7zXZ\0", 6)));
+}
+
 /***************************************************************
   Open file for reading/writing, like fopen.
   Parameters compress_method and compress_level only apply
@@ -429,6 +446,7 @@ int fz_fclose(fz_FILE *fp)
     free(fp->u.xz.in_buf);
     free(fp->u.xz.out_buf);
     fclose(fp->u.xz.plain);
+    free(fp);
     return error;
 #endif /* HAVE_LIBLZMA */
 #ifdef HAVE_LIBBZ2
@@ -462,6 +480,62 @@ int fz_fclose(fz_FILE *fp)
   return 1;
 }
 
+#ifdef HAVE_LIBLZMA
+/***************************************************************
+  Decompress more data into the output buffer of an xz file
+  opened for reading. Returns FALSE on error, or when the end of
+  the stream has been reached and no more data became available;
+  fp->u.xz.error tells which.
+***************************************************************/
+static bool xz_read_more(fz_FILE *fp)
+{
+  ssize_t len = 0;
+
+  if (fp->u.xz.hack_byte_used) {
+    ssize_t hblen = 0;
+
+    fp->u.xz.in_buf[0] = fp->u.xz.hack_byte;
+    len = fread(fp->u.xz.in_buf + 1, 1, PLAIN_FILE_BUF_SIZE - 1,
+                fp->u.xz.plain);
+    len++;
+
+    if (len <= 1) {
+      hblen = fread(&fp->u.xz.hack_byte, 1, 1, fp->u.xz.plain);
+    }
+    if (hblen <= 0) {
+      fp->u.xz.hack_byte_used = FALSE;
+    }
+  }
+  if (len <= 0) {
+    if (fp->u.xz.error == LZMA_STREAM_END) {
+      return FALSE;
+    }
+    fp->u.xz.stream.next_out = fp->u.xz.out_buf;
+    fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
+    fp->u.xz.error = lzma_code(&fp->u.xz.stream, LZMA_FINISH);
+    fp->u.xz.out_index = 0;
+    fp->u.xz.out_avail = fp->u.xz.stream.total_out - fp->u.xz.total_read;
+  } else {
+    lzma_action action;
+
+    fp->u.xz.stream.next_in = fp->u.xz.in_buf;
+    fp->u.xz.stream.avail_in = len;
+    fp->u.xz.stream.next_out = fp->u.xz.out_buf;
+    fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
+    if (fp->u.xz.hack_byte_used) {
+      action = LZMA_RUN;
+    } else {
+      action = LZMA_FINISH;
+    }
+    fp->u.xz.error = lzma_code(&fp->u.xz.stream, action);
+    fp->u.xz.out_avail = fp->u.xz.stream.total_out - fp->u.xz.total_read;
+    fp->u.xz.out_index = 0;
+  }
+
+  return (fp->u.xz.error == LZMA_OK || fp->u.xz.error == LZMA_STREAM_END);
+}
+#endif /* HAVE_LIBLZMA */
+
 /***************************************************************
   Get a line, like fgets.
   Returns NULL in case of error, or when end-of-file reached
@@ -478,7 +552,6 @@ char *fz_fgets(char *buffer, int size, fz_FILE *fp)
       int i, j;
 
       for (i = 0; i < size - 1; i += j) {
-        ssize_t len = 0;
         bool line_end;
 
         for (j = 0, line_end = FALSE; fp->u.xz.out_avail > 0
@@ -497,22 +570,7 @@ char *fz_fgets(char *buffer, int size, fz_FILE *fp)
           return buffer;
         }
 
-        if (fp->u.xz.hack_byte_used) {
-          ssize_t hblen = 0;
-
-          fp->u.xz.in_buf[0] = fp->u.xz.hack_byte;
-          len = fread(fp->u.xz.in_buf + 1, 1, PLAIN_FILE_BUF_SIZE - 1,
-                      fp->u.xz.plain);
-          len++;
-
-          if (len <= 1) {
-            hblen = fread(&fp->u.xz.hack_byte, 1, 1, fp->u.xz.plain);
-          }
-          if (hblen <= 0) {
-            fp->u.xz.hack_byte_used = FALSE;
-          }
-        }
-        if (len <= 0) {
+        if (!xz_read_more(fp)) {
           if (fp->u.xz.error == LZMA_STREAM_END) {
             if (i + j == 0) {
               /* Plain file read complete, and there was nothing in xz buffers
@@ -521,37 +579,8 @@ char *fz_fgets(char *buffer, int size, fz_FILE *fp)
             }
             buffer[i + j] = '\0';
             return buffer;
-          } else {
-            fp->u.xz.stream.next_out = fp->u.xz.out_buf;
-            fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
-            fp->u.xz.error = lzma_code(&fp->u.xz.stream, LZMA_FINISH);
-            fp->u.xz.out_index = 0;
-            fp->u.xz.out_avail =
-              fp->u.xz.stream.total_out - fp->u.xz.total_read;
-            if (fp->u.xz.error != LZMA_OK
-                && fp->u.xz.error != LZMA_STREAM_END) {
-              return NULL;
-            }
-          }
-        } else {
-          lzma_action action;
-
-          fp->u.xz.stream.next_in = fp->u.xz.in_buf;
-          fp->u.xz.stream.avail_in = len;
-          fp->u.xz.stream.next_out = fp->u.xz.out_buf;
-          fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
-          if (fp->u.xz.hack_byte_used) {
-            action = LZMA_RUN;
-          } else {
-            action = LZMA_FINISH;
-          }
-          fp->u.xz.error = lzma_code(&fp->u.xz.stream, action);
-          fp->u.xz.out_avail =
-            fp->u.xz.stream.total_out - fp->u.xz.total_read;
-          fp->u.xz.out_index = 0;
-          if (fp->u.xz.error != LZMA_OK && fp->u.xz.error != LZMA_STREAM_END) {
-            return NULL;
           }
+          return NULL;
         }
       }
 
@@ -743,6 +772,165 @@ int fz_fprintf(fz_FILE *fp, const char *format, ...)
   return 0;
 }
 
+/***************************************************************
+  Read up to 'size' bytes, like fread. Unlike fz_fgets(), this is
+  safe for binary data. Returns the number of (uncompressed) bytes
+  read, which is less than 'size' only at end-of-file or on error.
+***************************************************************/
+size_t fz_fread(void *buffer, size_t size, fz_FILE *fp)
+{
+  fc_assert_ret_val(NULL != fp, 0);
+
+  switch (fz_method_validate(fp->method)) {
+#ifdef HAVE_LIBLZMA
+  case FZ_XZ:
+    {
+      size_t done = 0;
+
+      while (done < size) {
+        if (fp->u.xz.out_avail > 0) {
+          size_t len = MIN((size_t) fp->u.xz.out_avail, size - done);
+
+          memcpy((char *) buffer + done,
+                 fp->u.xz.out_buf + fp->u.xz.out_index, len);
+          fp->u.xz.out_index += len;
+          fp->u.xz.out_avail -= len;
+          fp->u.xz.total_read += len;
+          done += len;
+        } else if (!xz_read_more(fp)) {
+          break;
+        }
+      }
+      return done;
+    }
+#endif /* HAVE_LIBLZMA */
+#ifdef HAVE_LIBBZ2
+  case FZ_BZIP2:
+    {
+      size_t done = 0;
+
+      if (size > 0 && fp->u.bz2.firstbyte >= 0) {
+        ((char *) buffer)[0] = fp->u.bz2.firstbyte;
+        fp->u.bz2.firstbyte = -1;
+        done++;
+      }
+      while (done < size && !fp->u.bz2.eof) {
+        int len = BZ2_bzRead(&fp->u.bz2.error, fp->u.bz2.file,
+                             (char *) buffer + done,
+                             MIN(size - done, (size_t) INT_MAX));
+
+        if (fp->u.bz2.error == BZ_STREAM_END) {
+          fp->u.bz2.eof = TRUE;
+        } else if (fp->u.bz2.error != BZ_OK) {
+          break;
+        }
+        done += MAX(len, 0);
+      }
+      return done;
+    }
+#endif /* HAVE_LIBBZ2 */
+#ifdef HAVE_LIBZ
+  case FZ_ZLIB:
+    {
+      size_t done = 0;
+
+      while (done < size) {
+        int len = gzread(fp->u.zlib, (char *) buffer + done,
+                         MIN(size - done, (size_t) INT_MAX));
+
+        if (len <= 0) {
+          break;
+        }
+        done += len;
+      }
+      return done;
+    }
+#endif /* HAVE_LIBZ */
+  case FZ_PLAIN:
+    return fread(buffer, 1, size, fp->u.plain);
+  }
+
+  /* Should never happen */
+  fc_assert_msg(FALSE, "Internal error in %s() (method = %d)",
+                __FUNCTION__, fp->method);
+  return 0;
+}
+
+/***************************************************************
+  Write 'size' bytes, like fwrite. Unlike fz_fprintf(), this is
+  safe for binary data and has no length limit. Returns the number
+  of (uncompressed) bytes written, which is less than 'size' only
+  on error.
+***************************************************************/
+size_t fz_fwrite(const void *buffer, size_t size, fz_FILE *fp)
+{
+  fc_assert_ret_val(NULL != fp, 0);
+
+  switch (fz_method_validate(fp->method)) {
+#ifdef HAVE_LIBLZMA
+  case FZ_XZ:
+    {
+      size_t done = 0;
+
+      while (done < size) {
+        size_t len = MIN(size - done, PLAIN_FILE_BUF_SIZE);
+
+        memcpy(fp->u.xz.in_buf, (const char *) buffer + done, len);
+        fp->u.xz.stream.next_in = fp->u.xz.in_buf;
+        fp->u.xz.stream.avail_in = len;
+        if (!xz_outbuffer_to_file(fp, LZMA_RUN)) {
+          break;
+        }
+        done += len;
+      }
+      return done;
+    }
+#endif /* HAVE_LIBLZMA */
+#ifdef HAVE_LIBBZ2
+  case FZ_BZIP2:
+    {
+      size_t done = 0;
+
+      while (done < size) {
+        int len = MIN(size - done, (size_t) INT_MAX);
+
+        BZ2_bzWrite(&fp->u.bz2.error, fp->u.bz2.file,
+                    (char *) buffer + done, len);
+        if (fp->u.bz2.error != BZ_OK) {
+          break;
+        }
+        done += len;
+      }
+      return done;
+    }
+#endif /* HAVE_LIBBZ2 */
+#ifdef HAVE_LIBZ
+  case FZ_ZLIB:
+    {
+      size_t done = 0;
+
+      while (done < size) {
+        int len = gzwrite(fp->u.zlib, (const char *) buffer + done,
+                          MIN(size - done, (size_t) INT_MAX));
+
+        if (len <= 0) {
+          break;
+        }
+        done += len;
+      }
+      return done;
+    }
+#endif /* HAVE_LIBZ */
+  case FZ_PLAIN:
+    return fwrite(buffer, 1, size, fp->u.plain);
+  }
+
+  /* Should never happen */
+  fc_assert_msg(FALSE, "Internal error in %s() (method = %d)",
+                __FUNCTION__, fp->method);
+  return 0;
+}
+
 /***************************************************************
   Return non-zero if there is an error status associated with
   this stream.  Check fz_strerror for details.
@@ -44,11 +44,14 @@ enum fz_method {
 #endif
 };
 
+bool fz_header_is_compressed(const void *header, size_t len);
 fz_FILE *fz_from_file(const char *filename, const char *in_mode,
 		      enum fz_method method, int compress_level);
 fz_FILE *fz_from_stream(FILE *stream);
 int fz_fclose(fz_FILE *fp);
 char *fz_fgets(char *buffer, int size, fz_FILE *fp);
+size_t fz_fread(void *buffer, size_t size, fz_FILE *fp);
+size_t fz_fwrite(const void *buffer, size_t size, fz_FILE *fp);
 int fz_fprintf(fz_FILE *fp, const char *format, ...)
      fc__attribute((__format__ (__printf__, 2, 3)));
 
@@ -176,6 +176,44 @@ int fc_writesocket(int sock, const void *buf, size_t size)
   return result;
 }
 
+/***************************************************************
+  Write the pieces in 'iov' to a socket in order, like writev(2).
+  At most FC_IOV_MAX pieces are looked at. Where gathering writes
+  are not available only the first piece is written; the return
+  value tells how much was written in any case.
+***************************************************************/
+int fc_writevsocket(int sock, const struct fc_iovec *iov, int iovcnt)
+{
+#if defined(HAVE_SYS_UIO_H) && !defined(HAVE_WINSOCK)
+  struct iovec vec[FC_IOV_MAX];
+  struct msghdr msg;
+  int i;
+
+  if (iovcnt > FC_IOV_MAX) {
+    iovcnt = FC_IOV_MAX;
+  }
+  for (i = 0; i < iovcnt; i++) {
+    vec[i].iov_base = (void *) iov[i].base;
+    vec[i].iov_len = iov[i].len;
+  }
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = vec;
+  msg.msg_iovlen = iovcnt;
+
+#  ifdef MSG_NOSIGNAL
+  return sendmsg(sock, &msg, MSG_NOSIGNAL);
+#  else  /* MSG_NOSIGNAL */
+  return sendmsg(sock, &msg, 0);
+#  endif /* MSG_NOSIGNAL */
+#else  /* HAVE_SYS_UIO_H && !HAVE_WINSOCK */
+  if (iovcnt <= 0) {
+    return 0;
+  }
+  return fc_writesocket(sock, iov[0].base, iov[0].len);
+#endif /* HAVE_SYS_UIO_H && !HAVE_WINSOCK */
+}
+
 /***************************************************************
   Close a socket.
 ***************************************************************/
@@ -37,6 +37,9 @@ extern "C" {
 #ifdef HAVE_SYS_TYPES_H
 #include <sys/types.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -89,6 +92,15 @@ union fc_sockaddr {
 #endif
 };
 
+/* One piece of the data given to fc_writevsocket(). */
+struct fc_iovec {
+  const void *base;
+  size_t len;
+};
+
+/* Most pieces fc_writevsocket() looks at in one call. */
+#define FC_IOV_MAX 64
+
 /* get 'struct sockaddr_list' and related functions: */
 #define SPECLIST_TAG fc_sockaddr
 #define SPECLIST_TYPE union fc_sockaddr
@@ -118,6 +130,7 @@ int fc_select(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
               struct timeval *timeout);
 int fc_readsocket(int sock, void *buf, size_t size);
 int fc_writesocket(int sock, const void *buf, size_t size);
+int fc_writevsocket(int sock, const struct fc_iovec *iov, int iovcnt);
 void fc_closesocket(int sock);
 void fc_init_network(void);
 void fc_shutdown_network(void);
@@ -0,0 +1,111 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/**********************************************************************
+  Times the loading of section files, e.g. the rulesets and scenarios
+  shipped in data/. Each file given on the command line is loaded with
+  secfile_load(); the best time of several rounds over all of them is
+  printed. Run it through 'make parse-bench' in this directory.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* utility */
+#include "fciconv.h"
+#include "log.h"
+#include "registry.h"
+#include "shared.h"
+#include "timing.h"
+
+#define DEFAULT_ROUNDS 5
+
+/**************************************************************************
+  Load all files once. Returns the number of files that failed to load;
+  their errors are logged the first time only.
+**************************************************************************/
+static int load_files(int count, char **filenames, bool report)
+{
+  int failed = 0;
+  int i;
+
+  for (i = 0; i < count; i++) {
+    struct section_file *file = secfile_load(filenames[i], TRUE);
+
+    if (NULL == file) {
+      if (report) {
+        log_error("%s", secfile_error());
+      }
+      failed++;
+    } else {
+      secfile_destroy(file);
+    }
+  }
+
+  return failed;
+}
+
+/**************************************************************************
+  Entry point: parsebench [-r rounds] file...
+**************************************************************************/
+int main(int argc, char **argv)
+{
+  struct timer *timer;
+  int rounds = DEFAULT_ROUNDS;
+  int first = 1;
+  int failed = 0;
+  double best = -1.0;
+  int i;
+
+  log_init(NULL, LOG_NORMAL, NULL, NULL, -1);
+  init_character_encodings(FC_DEFAULT_DATA_ENCODING, FALSE);
+
+  if (3 <= argc && 0 == strcmp(argv[1], "-r")) {
+    if (!str_to_int(argv[2], &rounds) || 0 >= rounds) {
+      log_error("Invalid number of rounds: %s", argv[2]);
+      return EXIT_FAILURE;
+    }
+    first = 3;
+  }
+  if (first >= argc) {
+    fc_fprintf(stderr, "Usage: %s [-r rounds] file...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  timer = timer_new(TIMER_USER, TIMER_ACTIVE);
+  for (i = 0; i < rounds; i++) {
+    double seconds;
+
+    timer_clear(timer);
+    timer_start(timer);
+    failed = load_files(argc - first, argv + first, 0 == i);
+    timer_stop(timer);
+
+    seconds = timer_read_seconds(timer);
+    if (0.0 > best || seconds < best) {
+      best = seconds;
+    }
+  }
+  timer_destroy(timer);
+
+  fc_printf("%d files (%d failed), best of %d rounds: %.1f ms\n",
+            argc - first, failed, rounds, best * 1000.0);
+  log_close();
+
+  return 0 < failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -15,6 +15,11 @@
   Implementation of a priority queue aka heap.
 
   Currently only one value-type is supported.
+
+  An indexed queue also knows where each datum is in the heap, so the
+  priority of a queued datum can be changed in place with pq_update()
+  instead of inserting it again. The data of such a queue must be in
+  the range given to pq_create_indexed().
 ***********************************************************************/
 
 #ifdef HAVE_CONFIG_H
@@ -33,8 +38,57 @@ struct pqueue {
   int step;			/* additional memory allocation step */
   pq_data_t *cells;		/* array containing data */
   int *priorities;		/* backup priorities (in case data is changed) */
+  int *positions;               /* cell of each datum, 0 if not queued;
+                                 * NULL if the queue is not indexed */
+  int max_data;                 /* data are in [0, max_data) if indexed */
 };
 
+/**********************************************************************
+  Put the item into the cell i.
+***********************************************************************/
+static inline void pq_set_cell(struct pqueue *q, int i, pq_data_t datum,
+                               int datum_priority)
+{
+  q->cells[i] = datum;
+  q->priorities[i] = datum_priority;
+  if (NULL != q->positions) {
+    q->positions[datum] = i;
+  }
+}
+
+/**********************************************************************
+  Move the item up from the cell i until its parent ranks higher.
+***********************************************************************/
+static void pq_sift_up(struct pqueue *q, int i, pq_data_t datum,
+                       int datum_priority)
+{
+  while (i > 1 && q->priorities[i / 2] < datum_priority) {
+    pq_set_cell(q, i, q->cells[i / 2], q->priorities[i / 2]);
+    i /= 2;
+  }
+  pq_set_cell(q, i, datum, datum_priority);
+}
+
+/**********************************************************************
+  Move the item down from the cell i until no child ranks higher.
+***********************************************************************/
+static void pq_sift_down(struct pqueue *q, int i, pq_data_t datum,
+                         int datum_priority)
+{
+  while (2 * i < q->size) {
+    int j = 2 * i;
+    if (j + 1 < q->size && q->priorities[j] < q->priorities[j + 1]) {
+      j++;
+    }
+    if (q->priorities[j] <= datum_priority) {
+      break;
+    }
+    pq_set_cell(q, i, q->cells[j], q->priorities[j]);
+    i = j;
+  }
+  pq_set_cell(q, i, datum, datum_priority);
+}
+
 /**********************************************************************
   Initialize the queue.
  
@@ -52,6 +106,21 @@ struct pqueue *pq_create(int initial_size)
   q->avail = initial_size;
   q->step = initial_size;
   q->size = 1;
+  q->positions = NULL;
+  q->max_data = 0;
+  return q;
+}
+
+/**********************************************************************
+  Initialize an indexed queue for data in the range [0, max_data).
+  See pq_update().
+***********************************************************************/
+struct pqueue *pq_create_indexed(int initial_size, int max_data)
+{
+  struct pqueue *q = pq_create(initial_size);
+
+  q->positions = fc_calloc(max_data, sizeof(*q->positions));
+  q->max_data = max_data;
   return q;
 }
 
@@ -63,17 +132,35 @@ void pq_destroy(struct pqueue *q)
   fc_assert_ret(NULL != q);
   free(q->cells);
   free(q->priorities);
+  free(q->positions);
   free(q);
 }
 
+/********************************************************************
+  Remove all items from the queue.
+********************************************************************/
+void pq_clear(struct pqueue *q)
+{
+  int i;
+
+  fc_assert_ret(NULL != q);
+
+  if (NULL != q->positions) {
+    for (i = 1; i < q->size; i++) {
+      q->positions[q->cells[i]] = 0;
+    }
+  }
+  q->size = 1;
+}
+
 /********************************************************************
   Insert an item into the queue.
 *********************************************************************/
 void pq_insert(struct pqueue *q, pq_data_t datum, int datum_priority)
 {
-  int i;
-
   fc_assert_ret(NULL != q);
+  /* An indexed queue can hold each datum once only. */
+  fc_assert_ret(NULL == q->positions || 0 == q->positions[datum]);
 
   /* allocate more memory if necessary */
   if (q->size >= q->avail) {
@@ -85,14 +172,29 @@ void pq_insert(struct pqueue *q, pq_data_t datum, int datum_priority)
   }
 
   /* insert item */
-  i = q->size++;
-  while (i > 1 && q->priorities[i / 2] < datum_priority) {
-    q->cells[i] = q->cells[i / 2];
-    q->priorities[i] = q->priorities[i / 2];
-    i /= 2;
+  pq_sift_up(q, q->size++, datum, datum_priority);
+}
+
+/********************************************************************
+  Insert an item into an indexed queue, or change its priority if it
+  is queued already.
+*********************************************************************/
+void pq_update(struct pqueue *q, pq_data_t datum, int datum_priority)
+{
+  int i;
+
+  fc_assert_ret(NULL != q);
+  fc_assert_ret(NULL != q->positions);
+  fc_assert_ret(0 <= datum && datum < q->max_data);
+
+  i = q->positions[datum];
+  if (0 == i) {
+    pq_insert(q, datum, datum_priority);
+  } else if (datum_priority > q->priorities[i]) {
+    pq_sift_up(q, i, datum, datum_priority);
+  } else {
+    pq_sift_down(q, i, datum, datum_priority);
   }
-  q->cells[i] = datum;
-  q->priorities[i] = datum_priority;
 }
 
 /*******************************************************************
@@ -105,10 +207,7 @@ void pq_insert(struct pqueue *q, pq_data_t datum, int datum_priority)
 *******************************************************************/
 bool pq_remove(struct pqueue * q, pq_data_t *dest)
 {
-  pq_data_t tmp;
-  int tmp_priority;
   pq_data_t top;
-  int i = 1;
 
   fc_assert_ret_val(NULL != q, FALSE);
 
@@ -119,22 +218,10 @@ bool pq_remove(struct pqueue * q, pq_data_t *dest)
   fc_assert_ret_val(q->size <= q->avail, FALSE);
   top = q->cells[1];
   q->size--;
-  tmp = q->cells[q->size];
-  tmp_priority = q->priorities[q->size];
-  while (i <= q->size / 2) {
-    int j = 2 * i;
-    if (j < q->size && q->priorities[j] < q->priorities[j + 1]) {
-      j++;
-    }
-    if (q->priorities[j] <= tmp_priority) {
-      break;
-    }
-    q->cells[i] = q->cells[j];
-    q->priorities[i] = q->priorities[j];
-    i = j;
+  pq_sift_down(q, 1, q->cells[q->size], q->priorities[q->size]);
+  if (NULL != q->positions) {
+    q->positions[top] = 0;
   }
-  q->cells[i] = tmp;
-  q->priorities[i] = tmp_priority;
   if(dest) {
       *dest = top;
   }
@@ -23,8 +23,11 @@ typedef int pq_data_t;
 struct pqueue;
 
 struct pqueue *pq_create(int initial_size);
+struct pqueue *pq_create_indexed(int initial_size, int max_data);
 void pq_destroy(struct pqueue *q);
+void pq_clear(struct pqueue *q);
 void pq_insert(struct pqueue *q, const pq_data_t datum, int datum_priority);
+void pq_update(struct pqueue *q, const pq_data_t datum, int datum_priority);
 bool pq_remove(struct pqueue *q, pq_data_t *dest);
 bool pq_peek(struct pqueue *q, pq_data_t *dest);
 
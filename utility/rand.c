@@ -79,11 +79,22 @@ static RANDOM_STATE rand_state;
 *************************************************************************/
 RANDOM_TYPE fc_rand_debug(RANDOM_TYPE size, const char *called_as,
                           int line, const char *file) 
+{
+  return fc_rand_stream_debug(&rand_state, size, called_as, line, file);
+}
+
+/*************************************************************************
+  Like fc_rand_debug(), but draws from the given random state instead of
+  the global one. Different threads can so use their own streams.
+*************************************************************************/
+RANDOM_TYPE fc_rand_stream_debug(RANDOM_STATE *state, RANDOM_TYPE size,
+                                 const char *called_as,
+                                 int line, const char *file)
 {
   RANDOM_TYPE new_rand, divisor, max;
   int bailout = 0;
 
-  fc_assert_ret_val(rand_state.is_init, 0);
+  fc_assert_ret_val(state->is_init, 0);
 
   if (size > 1) {
     divisor = MAX_UINT32 / size;
@@ -100,13 +111,12 @@ RANDOM_TYPE fc_rand_debug(RANDOM_TYPE size, const char *called_as,
   }
 
   do {
-    new_rand = (rand_state.v[rand_state.j]
-		+ rand_state.v[rand_state.k]) & MAX_UINT32;
+    new_rand = (state->v[state->j] + state->v[state->k]) & MAX_UINT32;
 
-    rand_state.x = (rand_state.x +1) % 56;
-    rand_state.j = (rand_state.j +1) % 56;
-    rand_state.k = (rand_state.k +1) % 56;
-    rand_state.v[rand_state.x] = new_rand;
+    state->x = (state->x + 1) % 56;
+    state->j = (state->j + 1) % 56;
+    state->k = (state->k + 1) % 56;
+    state->v[state->x] = new_rand;
 
     if (++bailout > 10000) {
       log_error("%s(%lu) = %lu bailout at %s:%d", 
@@ -135,20 +145,29 @@ RANDOM_TYPE fc_rand_debug(RANDOM_TYPE size, const char *called_as,
   Initialize the generator; see comment at top of file.
 *************************************************************************/
 void fc_srand(RANDOM_TYPE seed) 
-{ 
+{
+  fc_srand_stream(&rand_state, seed);
+}
+
+/*************************************************************************
+  Initialize the given random state, as fc_srand() does for the global
+  one.
+*************************************************************************/
+void fc_srand_stream(RANDOM_STATE *state, RANDOM_TYPE seed)
+{
     int  i; 
 
-    rand_state.v[0]=(seed & MAX_UINT32);
+    state->v[0]=(seed & MAX_UINT32);
 
     for(i=1; i<56; i++) {
-       rand_state.v[i] = (3 * rand_state.v[i-1] + 257) & MAX_UINT32;
+       state->v[i] = (3 * state->v[i-1] + 257) & MAX_UINT32;
     }
 
-    rand_state.j = (55-55);
-    rand_state.k = (55-24);
-    rand_state.x = (55-0);
+    state->j = (55-55);
+    state->k = (55-24);
+    state->x = (55-0);
 
-    rand_state.is_init = TRUE;
+    state->is_init = TRUE;
 
     /* Heat it up a bit:
      * Using modulus in fc_rand() this was important to pass
@@ -158,7 +177,7 @@ void fc_srand(RANDOM_TYPE seed)
      * problems even using divisor.
      */
     for (i=0; i<10000; i++) {
-      (void) fc_rand(MAX_UINT32);
+      (void) fc_rand_stream(state, MAX_UINT32);
     }
 } 
 
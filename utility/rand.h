@@ -42,6 +42,16 @@ RANDOM_TYPE fc_rand_debug(RANDOM_TYPE size, const char *called_as,
 
 void fc_srand(RANDOM_TYPE seed);
 
+/* Independent random streams, for work split over threads. */
+#define fc_rand_stream(_state, _size) \
+  fc_rand_stream_debug((_state), (_size), "fc_rand_stream", \
+                       __FC_LINE__, __FILE__)
+
+RANDOM_TYPE fc_rand_stream_debug(RANDOM_STATE *state, RANDOM_TYPE size,
+                                 const char *called_as,
+                                 int line, const char *file);
+void fc_srand_stream(RANDOM_STATE *state, RANDOM_TYPE seed);
+
 bool fc_rand_is_init(void);
 RANDOM_STATE fc_rand_state(void);
 void fc_rand_set_state(RANDOM_STATE state);
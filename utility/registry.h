@@ -26,6 +26,7 @@ void registry_module_close(void);
 
 struct section_file *secfile_new(bool allow_duplicates);
 void secfile_destroy(struct section_file *secfile);
+size_t secfile_memory_usage(const struct section_file *secfile);
 struct section_file *secfile_load(const char *filename,
                                   bool allow_duplicates);
 
@@ -35,6 +36,13 @@ void secfile_allow_digital_boolean(struct section_file *secfile,
 const char *secfile_error(void);
 const char *section_name(const struct section *psection);
 
+/* Formats section files can be saved in. */
+enum secfile_format {
+  SECFILE_FORMAT_TEXT = 0,      /* registry_ini.c */
+  SECFILE_FORMAT_BINARY         /* registry_bin.c */
+};
+
+#include "registry_bin.h"
 #include "registry_ini.h"
 
 #ifdef __cplusplus
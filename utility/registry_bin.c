@@ -0,0 +1,746 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/**************************************************************************
+  A binary representation of section files.
+
+  It holds exactly the same data as the text format of registry_ini.c:
+  sections, and entries with their type, value, comment and, for
+  strings, whether they are escaped. Loading it needs no tokenizing,
+  and strings used several times, such as entry names repeated in
+  every section, are stored only once.
+
+  All numbers are little endian; counts, lengths and string ids are
+  32 bit unsigned, integer values 32 bit signed. The layout is:
+
+    "FCSECBIN", version
+    number of strings, then for each: length, bytes (no '\0')
+    number of sections, then for each:
+      name id, flags, number of records, then for each record:
+        type (8 bits, with flags), name id, value, [comment id]
+
+  A record is one entry, except for BIN_INT_VEC records, which hold a
+  whole vector of integers "name", "name,1", ..., "name,n-1" as a count
+  followed by the values.
+
+  The file may be compressed as a whole by ioz.c. Uncompressed files
+  are mapped into memory for loading where possible.
+**************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* utility */
+#include "genhash.h"
+#include "log.h"
+#include "mem.h"
+#include "registry.h"
+#include "section_file.h"
+#include "shared.h"
+#include "support.h"
+
+#include "registry_bin.h"
+
+#define BIN_MAGIC "FCSECBIN"
+#define BIN_MAGIC_LEN 8
+#define BIN_VERSION 1
+
+/* Record types. */
+enum bin_record_type {
+  BIN_BOOL = 0,
+  BIN_INT = 1,
+  BIN_STR = 2,
+  BIN_INT_VEC = 3
+};
+
+/* Flags stored along with the record type. */
+#define BIN_TYPE_MASK     0x07
+#define BIN_STR_ESCAPED   0x08
+#define BIN_HAS_COMMENT   0x10
+
+/* Section flags. */
+#define BIN_SECTION_INCLUDE 0x01
+
+/* Maps the strings of the file being written to their ids. */
+#define SPECHASH_TAG bin_string
+#define SPECHASH_KEY_TYPE char *
+#define SPECHASH_DATA_TYPE int
+#define SPECHASH_KEY_VAL genhash_str_val_func
+#define SPECHASH_KEY_COMP genhash_str_comp_func
+#define SPECHASH_DATA_TO_PTR FC_INT_TO_PTR
+#define SPECHASH_PTR_TO_DATA FC_PTR_TO_INT
+#include "spechash.h"
+
+struct bin_buf {
+  unsigned char *data;
+  size_t size;
+  size_t alloc;
+};
+
+struct bin_writer {
+  struct bin_buf body;
+  struct bin_string_hash *ids;
+  const char **strings;         /* By id. Owned by the section file. */
+  int num_strings;
+  int alloc_strings;
+};
+
+struct bin_reader {
+  const unsigned char *data;
+  size_t size;
+  size_t pos;
+  bool error;                   /* Tried to read past the end. */
+  char **strings;               /* By id. */
+  uint32_t num_strings;
+};
+
+/**************************************************************************
+  Make room for 'len' more bytes in the buffer.
+**************************************************************************/
+static void bin_reserve(struct bin_buf *buf, size_t len)
+{
+  if (buf->size + len > buf->alloc) {
+    buf->alloc = MAX(2 * buf->alloc, buf->size + len);
+    buf->data = fc_realloc(buf->data, buf->alloc);
+  }
+}
+
+/**************************************************************************
+  Append a byte to the buffer.
+**************************************************************************/
+static void bin_put_u8(struct bin_buf *buf, unsigned char value)
+{
+  bin_reserve(buf, 1);
+  buf->data[buf->size++] = value;
+}
+
+/**************************************************************************
+  Store a 32 bit number at the given position of the buffer.
+**************************************************************************/
+static void bin_set_u32(struct bin_buf *buf, size_t pos, uint32_t value)
+{
+  buf->data[pos] = value & 0xff;
+  buf->data[pos + 1] = (value >> 8) & 0xff;
+  buf->data[pos + 2] = (value >> 16) & 0xff;
+  buf->data[pos + 3] = (value >> 24) & 0xff;
+}
+
+/**************************************************************************
+  Append a 32 bit number to the buffer.
+**************************************************************************/
+static void bin_put_u32(struct bin_buf *buf, uint32_t value)
+{
+  bin_reserve(buf, 4);
+  bin_set_u32(buf, buf->size, value);
+  buf->size += 4;
+}
+
+/**************************************************************************
+  Append raw bytes to the buffer.
+**************************************************************************/
+static void bin_put_bytes(struct bin_buf *buf, const void *data, size_t len)
+{
+  bin_reserve(buf, len);
+  memcpy(buf->data + buf->size, data, len);
+  buf->size += len;
+}
+
+/**************************************************************************
+  Append the id of the string to the body, adding it to the string
+  table if needed.
+**************************************************************************/
+static void bin_put_string(struct bin_writer *writer, const char *str)
+{
+  int id;
+
+  if (!bin_string_hash_lookup(writer->ids, (char *) str, &id)) {
+    if (writer->num_strings == writer->alloc_strings) {
+      writer->alloc_strings = MAX(2 * writer->alloc_strings, 256);
+      writer->strings = fc_realloc(writer->strings, writer->alloc_strings
+                                   * sizeof(*writer->strings));
+    }
+    id = writer->num_strings++;
+    writer->strings[id] = str;
+    bin_string_hash_insert(writer->ids, (char *) str, id);
+  }
+  bin_put_u32(&writer->body, id);
+}
+
+/**************************************************************************
+  Returns the number of entries starting at 'link' which form a vector
+  of integers without comments: "name", "name,1", ... "name,n-1".
+  The entry at 'link' must be such an integer.
+**************************************************************************/
+static int bin_int_vec_len(const struct entry_list_link *link)
+{
+  const char *name = entry_name(entry_list_link_data(link));
+  char expect[256];
+  int len = 1;
+
+  for (link = entry_list_link_next(link); NULL != link;
+       link = entry_list_link_next(link)) {
+    const struct entry *pentry = entry_list_link_data(link);
+
+    if (ENTRY_INT != entry_type(pentry) || NULL != entry_comment(pentry)) {
+      break;
+    }
+    fc_snprintf(expect, sizeof(expect), "%s,%d", name, len);
+    if (0 != strcmp(entry_name(pentry), expect)) {
+      break;
+    }
+    len++;
+  }
+
+  return len;
+}
+
+/**************************************************************************
+  Append the records of the section to the body.
+**************************************************************************/
+static void bin_put_section(struct bin_writer *writer,
+                            const struct section *psection)
+{
+  const struct entry_list_link *link;
+  size_t count_pos;
+  int count = 0;
+
+  bin_put_string(writer, section_name(psection));
+  bin_put_u8(&writer->body, psection->include ? BIN_SECTION_INCLUDE : 0);
+  count_pos = writer->body.size;
+  bin_put_u32(&writer->body, 0);
+
+  for (link = entry_list_head(section_entries(psection)); NULL != link;
+       link = entry_list_link_next(link)) {
+    const struct entry *pentry = entry_list_link_data(link);
+    const char *comment = entry_comment(pentry);
+    unsigned char flags = (NULL != comment ? BIN_HAS_COMMENT : 0);
+    bool bvalue;
+    int ivalue;
+    const char *svalue;
+
+    switch (entry_type(pentry)) {
+    case ENTRY_BOOL:
+      entry_bool_get(pentry, &bvalue);
+      bin_put_u8(&writer->body, BIN_BOOL | flags);
+      bin_put_string(writer, entry_name(pentry));
+      bin_put_u8(&writer->body, bvalue ? 1 : 0);
+      break;
+    case ENTRY_INT:
+      if (NULL == comment) {
+        int len = bin_int_vec_len(link);
+
+        if (len > 1) {
+          int i;
+
+          bin_put_u8(&writer->body, BIN_INT_VEC);
+          bin_put_string(writer, entry_name(pentry));
+          bin_put_u32(&writer->body, len);
+          for (i = 0; i < len; i++) {
+            if (0 < i) {
+              link = entry_list_link_next(link);
+            }
+            entry_int_get(entry_list_link_data(link), &ivalue);
+            bin_put_u32(&writer->body, (uint32_t) ivalue);
+          }
+          break;
+        }
+      }
+      entry_int_get(pentry, &ivalue);
+      bin_put_u8(&writer->body, BIN_INT | flags);
+      bin_put_string(writer, entry_name(pentry));
+      bin_put_u32(&writer->body, (uint32_t) ivalue);
+      break;
+    case ENTRY_STR:
+      entry_str_get(pentry, &svalue);
+      if (entry_str_escaped(pentry)) {
+        flags |= BIN_STR_ESCAPED;
+      }
+      bin_put_u8(&writer->body, BIN_STR | flags);
+      bin_put_string(writer, entry_name(pentry));
+      bin_put_string(writer, svalue);
+      break;
+    }
+
+    if (NULL != comment) {
+      bin_put_string(writer, comment);
+    }
+    count++;
+  }
+
+  bin_set_u32(&writer->body, count_pos, count);
+}
+
+/**************************************************************************
+  Save the section file to disk in the binary format. The compression
+  arguments work like for secfile_save().
+**************************************************************************/
+bool secfile_save_bin(const struct section_file *secfile,
+                      const char *filename, int compression_level,
+                      enum fz_method compression_method)
+{
+  char real_filename[1024];
+  struct bin_writer writer;
+  struct bin_buf head;
+  fz_FILE *fs;
+  bool success;
+  int i;
+
+  SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile, FALSE);
+
+  if (NULL == filename) {
+    filename = secfile->name;
+  }
+
+  memset(&writer, 0, sizeof(writer));
+  writer.ids = bin_string_hash_new();
+
+  bin_put_u32(&writer.body, section_list_size(secfile->sections));
+  section_list_iterate(secfile->sections, psection) {
+    bin_put_section(&writer, psection);
+  } section_list_iterate_end;
+
+  /* The string table comes first, so that loading can resolve the ids
+   * in one pass. */
+  memset(&head, 0, sizeof(head));
+  bin_put_bytes(&head, BIN_MAGIC, BIN_MAGIC_LEN);
+  bin_put_u32(&head, BIN_VERSION);
+  bin_put_u32(&head, writer.num_strings);
+  for (i = 0; i < writer.num_strings; i++) {
+    size_t len = strlen(writer.strings[i]);
+
+    bin_put_u32(&head, len);
+    bin_put_bytes(&head, writer.strings[i], len);
+  }
+
+  interpret_tilde(real_filename, sizeof(real_filename), filename);
+  fs = fz_from_file(real_filename, "w",
+                    compression_method, compression_level);
+
+  if (NULL != fs) {
+    success = (fz_fwrite(head.data, head.size, fs) == head.size
+               && fz_fwrite(writer.body.data, writer.body.size, fs)
+                  == writer.body.size);
+    if (0 != fz_fclose(fs)) {
+      success = FALSE;
+    }
+    if (!success) {
+      SECFILE_LOG(secfile, NULL, "Error writing %s", real_filename);
+    }
+  } else {
+    success = FALSE;
+  }
+
+  bin_string_hash_destroy(writer.ids);
+  free(writer.strings);
+  free(writer.body.data);
+  free(head.data);
+
+  return success;
+}
+
+/**************************************************************************
+  Read a byte.
+**************************************************************************/
+static unsigned char bin_get_u8(struct bin_reader *reader)
+{
+  if (reader->pos + 1 > reader->size) {
+    reader->error = TRUE;
+    return 0;
+  }
+
+  return reader->data[reader->pos++];
+}
+
+/**************************************************************************
+  Read a 32 bit number.
+**************************************************************************/
+static uint32_t bin_get_u32(struct bin_reader *reader)
+{
+  const unsigned char *p;
+
+  if (reader->pos + 4 > reader->size) {
+    reader->error = TRUE;
+    return 0;
+  }
+
+  p = reader->data + reader->pos;
+  reader->pos += 4;
+
+  return ((uint32_t) p[0] | ((uint32_t) p[1] << 8)
+          | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24));
+}
+
+/**************************************************************************
+  Read a string id and return the string.
+**************************************************************************/
+static const char *bin_get_string(struct bin_reader *reader)
+{
+  uint32_t id = bin_get_u32(reader);
+
+  if (id >= reader->num_strings) {
+    reader->error = TRUE;
+    return "";
+  }
+
+  return reader->strings[id];
+}
+
+/**************************************************************************
+  Read the string table. All the strings go to a single allocation,
+  stored in reader->strings[0].
+**************************************************************************/
+static bool bin_get_string_table(struct bin_reader *reader)
+{
+  size_t start, total = 0;
+  char *arena;
+  uint32_t i;
+
+  reader->num_strings = bin_get_u32(reader);
+  start = reader->pos;
+
+  /* First pass: check the lengths. */
+  for (i = 0; i < reader->num_strings && !reader->error; i++) {
+    uint32_t len = bin_get_u32(reader);
+
+    if (len > reader->size - reader->pos) {
+      reader->error = TRUE;
+    } else {
+      reader->pos += len;
+      total += len + 1;
+    }
+  }
+  if (reader->error) {
+    reader->num_strings = 0;
+    return FALSE;
+  }
+
+  reader->strings = fc_malloc(MAX(reader->num_strings, 1)
+                              * sizeof(*reader->strings));
+  arena = fc_malloc(MAX(total, 1));
+  reader->strings[0] = arena;
+  reader->pos = start;
+  for (i = 0; i < reader->num_strings; i++) {
+    uint32_t len = bin_get_u32(reader);
+
+    memcpy(arena, reader->data + reader->pos, len);
+    arena[len] = '\0';
+    reader->strings[i] = arena;
+    reader->pos += len;
+    arena += len + 1;
+  }
+
+  return TRUE;
+}
+
+/**************************************************************************
+  Read the sections and their entries into the section file. If
+  'section' is not NULL, only that section is kept.
+**************************************************************************/
+static bool bin_get_sections(struct bin_reader *reader,
+                             struct section_file *secfile,
+                             const char *section)
+{
+  uint32_t num_sections = bin_get_u32(reader);
+  uint32_t s;
+
+  for (s = 0; s < num_sections && !reader->error; s++) {
+    const char *name = bin_get_string(reader);
+    unsigned char flags = bin_get_u8(reader);
+    uint32_t num_records = bin_get_u32(reader);
+    struct section *psection = NULL;
+    uint32_t r;
+
+    if (reader->error) {
+      break;
+    }
+    if (NULL == section || 0 == strcmp(section, name)) {
+      psection = secfile_section_new(secfile, name);
+      if (NULL == psection) {
+        return FALSE;
+      }
+      if (flags & BIN_SECTION_INCLUDE) {
+        psection->include = TRUE;
+        secfile->num_includes++;
+      }
+    }
+
+    for (r = 0; r < num_records && !reader->error; r++) {
+      unsigned char type = bin_get_u8(reader);
+      const char *ename = bin_get_string(reader);
+      struct entry *pentry = NULL;
+
+      switch (type & BIN_TYPE_MASK) {
+      case BIN_BOOL:
+        {
+          bool value = (0 != bin_get_u8(reader));
+
+          if (NULL != psection && !reader->error) {
+            pentry = section_entry_bool_new(psection, ename, value);
+          }
+        }
+        break;
+      case BIN_INT:
+        {
+          int value = (int) bin_get_u32(reader);
+
+          if (NULL != psection && !reader->error) {
+            pentry = section_entry_int_new(psection, ename, value);
+          }
+        }
+        break;
+      case BIN_STR:
+        {
+          const char *value = bin_get_string(reader);
+
+          if (NULL != psection && !reader->error) {
+            pentry = section_entry_str_new(psection, ename, value,
+                                           type & BIN_STR_ESCAPED);
+          }
+        }
+        break;
+      case BIN_INT_VEC:
+        {
+          uint32_t len = bin_get_u32(reader);
+          char vname[256];
+          uint32_t i;
+
+          if ((type & BIN_HAS_COMMENT) || len > reader->size) {
+            reader->error = TRUE;
+          }
+          for (i = 0; i < len && !reader->error; i++) {
+            int value = (int) bin_get_u32(reader);
+
+            if (NULL == psection || reader->error) {
+              continue;
+            }
+            if (0 == i) {
+              pentry = section_entry_int_new(psection, ename, value);
+            } else {
+              fc_snprintf(vname, sizeof(vname), "%s,%d", ename, (int) i);
+              pentry = section_entry_int_new(psection, vname, value);
+            }
+            if (NULL == pentry) {
+              return FALSE;
+            }
+          }
+        }
+        break;
+      default:
+        reader->error = TRUE;
+        break;
+      }
+
+      if (type & BIN_HAS_COMMENT) {
+        const char *comment = bin_get_string(reader);
+
+        if (NULL != pentry && !reader->error) {
+          entry_set_comment(pentry, comment);
+        }
+      }
+
+      if (NULL != psection && NULL == pentry && !reader->error) {
+        return FALSE;
+      }
+    }
+  }
+
+  return !reader->error;
+}
+
+/**************************************************************************
+  Read the whole file into memory; compressed files are uncompressed.
+  Sets 'mapped' if the returned data is a memory mapping rather than
+  allocated. Returns NULL on error.
+**************************************************************************/
+static unsigned char *bin_file_read(const char *filename, size_t *size,
+                                    bool *mapped)
+{
+  unsigned char *data = NULL;
+  size_t alloc = 0;
+  fz_FILE *fp;
+
+  *size = 0;
+  *mapped = FALSE;
+
+#ifdef HAVE_SYS_MMAN_H
+  {
+    FILE *plain = fc_fopen(filename, "rb");
+    char magic[BIN_MAGIC_LEN];
+    struct stat st;
+
+    if (NULL == plain) {
+      return NULL;
+    }
+    if (BIN_MAGIC_LEN == fread(magic, 1, BIN_MAGIC_LEN, plain)
+        && 0 == memcmp(magic, BIN_MAGIC, BIN_MAGIC_LEN)
+        && 0 == fstat(fileno(plain), &st)) {
+      void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                       fileno(plain), 0);
+
+      if (MAP_FAILED != map) {
+        fclose(plain);
+        *size = st.st_size;
+        *mapped = TRUE;
+        return map;
+      }
+    }
+    fclose(plain);
+  }
+#endif /* HAVE_SYS_MMAN_H */
+
+  fp = fz_from_file(filename, "r", FZ_PLAIN, 0);
+  if (NULL == fp) {
+    return NULL;
+  }
+
+  do {
+    if (*size == alloc) {
+      alloc = MAX(2 * alloc, 64 * 1024);
+      data = fc_realloc(data, alloc);
+    }
+    *size += fz_fread(data + *size, alloc - *size, fp);
+  } while (*size == alloc);
+
+  fz_fclose(fp);
+
+  return data;
+}
+
+/**************************************************************************
+  Free the data returned by bin_file_read().
+**************************************************************************/
+static void bin_file_free(unsigned char *data, size_t size, bool mapped)
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (mapped) {
+    munmap(data, size);
+    return;
+  }
+#endif /* HAVE_SYS_MMAN_H */
+
+  free(data);
+}
+
+/**************************************************************************
+  Returns whether the file, possibly compressed, is in the binary
+  format. Plain text files are recognized without uncompressing.
+**************************************************************************/
+bool secfile_is_bin(const char *filename)
+{
+  char real_filename[1024];
+  unsigned char magic[BIN_MAGIC_LEN];
+  size_t len;
+  FILE *plain;
+  fz_FILE *fp;
+
+  interpret_tilde(real_filename, sizeof(real_filename), filename);
+  plain = fc_fopen(real_filename, "rb");
+  if (NULL == plain) {
+    return FALSE;
+  }
+  len = fread(magic, 1, sizeof(magic), plain);
+  fclose(plain);
+
+  if (BIN_MAGIC_LEN == len && 0 == memcmp(magic, BIN_MAGIC, BIN_MAGIC_LEN)) {
+    return TRUE;
+  }
+
+  if (!fz_header_is_compressed(magic, len)) {
+    return FALSE;
+  }
+
+  fp = fz_from_file(real_filename, "r", FZ_PLAIN, 0);
+  if (NULL == fp) {
+    return FALSE;
+  }
+  len = fz_fread(magic, sizeof(magic), fp);
+  fz_fclose(fp);
+
+  return (BIN_MAGIC_LEN == len
+          && 0 == memcmp(magic, BIN_MAGIC, BIN_MAGIC_LEN));
+}
+
+/**************************************************************************
+  Create a section file from a file in the binary format. If 'section'
+  is not NULL, read only that section. Returns NULL on error.
+**************************************************************************/
+struct section_file *secfile_load_bin(const char *filename,
+                                      const char *section,
+                                      bool allow_duplicates)
+{
+  char real_filename[1024];
+  struct bin_reader reader;
+  struct section_file *secfile;
+  unsigned char *data;
+  size_t size;
+  bool mapped;
+  bool success;
+
+  interpret_tilde(real_filename, sizeof(real_filename), filename);
+  data = bin_file_read(real_filename, &size, &mapped);
+  if (NULL == data) {
+    return NULL;
+  }
+
+  memset(&reader, 0, sizeof(reader));
+  reader.data = data;
+  reader.size = size;
+
+  secfile = secfile_new(TRUE);
+  secfile->name = fc_strdup(filename);
+
+  if (size < BIN_MAGIC_LEN
+      || 0 != memcmp(data, BIN_MAGIC, BIN_MAGIC_LEN)) {
+    SECFILE_LOG(secfile, NULL, "Not a binary section file.");
+    success = FALSE;
+  } else {
+    uint32_t version;
+
+    reader.pos = BIN_MAGIC_LEN;
+    version = bin_get_u32(&reader);
+    if (BIN_VERSION != version) {
+      SECFILE_LOG(secfile, NULL, "Unsupported binary format version %u.",
+                  (unsigned) version);
+      success = FALSE;
+    } else {
+      success = (bin_get_string_table(&reader)
+                 && bin_get_sections(&reader, secfile, section)
+                 && secfile_hash_build(secfile, allow_duplicates));
+      if (reader.error) {
+        SECFILE_LOG(secfile, NULL, "Truncated or corrupt binary data.");
+      }
+    }
+  }
+
+  if (NULL != reader.strings) {
+    free(reader.strings[0]);
+    free(reader.strings);
+  }
+  bin_file_free(data, size, mapped);
+
+  if (!success) {
+    secfile_destroy(secfile);
+    return NULL;
+  }
+
+  return secfile;
+}
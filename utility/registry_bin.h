@@ -0,0 +1,37 @@
+/**********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+#ifndef FC__REGISTRY_BIN_H
+#define FC__REGISTRY_BIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "ioz.h"
+#include "support.h"            /* bool type */
+
+struct section_file;
+
+bool secfile_is_bin(const char *filename);
+struct section_file *secfile_load_bin(const char *filename,
+                                      const char *section,
+                                      bool allow_duplicates);
+bool secfile_save_bin(const struct section_file *secfile,
+                      const char *filename, int compression_level,
+                      enum fz_method compression_method);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif  /* FC__REGISTRY_BIN_H */
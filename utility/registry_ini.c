@@ -255,7 +255,8 @@ static bool secfile_hash_insert(struct section_file *secfile,
   }
 
   entry_path(pentry, buf, sizeof(buf));
-  if (entry_hash_replace_full(secfile->hash.entries, buf, pentry,
+  if (entry_hash_replace_full(secfile->hash.entries,
+                              secfile_strdup(secfile, buf), pentry,
                               NULL, &hentry)) {
     entry_use(hentry);
     if (!secfile->allow_duplicates) {
@@ -286,6 +287,28 @@ static bool secfile_hash_delete(struct section_file *secfile,
   return entry_hash_remove(secfile->hash.entries, buf);
 }
 
+/**************************************************************************
+  Build the entry hash table of a section file which has been loaded
+  with duplicates allowed and without hash table. Returns FALSE if
+  'allow_duplicates' is not set and there are duplicate entries.
+**************************************************************************/
+bool secfile_hash_build(struct section_file *secfile,
+                        bool allow_duplicates)
+{
+  secfile->allow_duplicates = allow_duplicates;
+  secfile->hash.entries = entry_hash_new_nentries(secfile->num_entries);
+
+  section_list_iterate(secfile->sections, psection) {
+    entry_list_iterate(section_entries(psection), pentry) {
+      if (!secfile_hash_insert(secfile, pentry)) {
+        return FALSE;
+      }
+    } entry_list_iterate_end;
+  } section_list_iterate_end;
+
+  return TRUE;
+}
+
 /**************************************************************************
   Base function to load a section file.  Note it closes the inputfile.
 **************************************************************************/
@@ -521,22 +544,8 @@ END:
   }
   astring_vector_free(&columns);
 
-  if (!error) {
-    /* Build the entry hash table. */
-    secfile->allow_duplicates = allow_duplicates;
-    secfile->hash.entries = entry_hash_new_nentries(secfile->num_entries);
-
-    section_list_iterate(secfile->sections, psection) {
-      entry_list_iterate(section_entries(psection), pentry) {
-        if (!secfile_hash_insert(secfile, pentry)) {
-          error = TRUE;
-          break;
-        }
-      } entry_list_iterate_end;
-      if (error) {
-        break;
-      }
-    } section_list_iterate_end;
+  if (!error && !secfile_hash_build(secfile, allow_duplicates)) {
+    error = TRUE;
   }
   if (error) {
     secfile_destroy(secfile);
@@ -556,6 +565,10 @@ struct section_file *secfile_load_section(const char *filename,
 {
   char real_filename[1024];
 
+  if (secfile_is_bin(filename)) {
+    return secfile_load_bin(filename, section, allow_duplicates);
+  }
+
   interpret_tilde(real_filename, sizeof(real_filename), filename);
   return secfile_from_input_file(inf_from_file(real_filename, datafilename),
                                  filename, section, allow_duplicates);
@@ -2616,10 +2629,10 @@ struct section *secfile_section_new(struct section_file *secfile,
     return NULL;
   }
 
-  psection = fc_malloc(sizeof(struct section));
+  psection = secfile_alloc(secfile, sizeof(struct section));
   psection->include = FALSE;
-  psection->name = fc_strdup(name);
-  psection->entries = entry_list_new_full(entry_destroy);
+  psection->name = secfile_name_intern(secfile, name);
+  psection->entries = entry_list_new();
 
   /* Append to secfile. */
   psection->secfile = secfile;
@@ -2645,18 +2658,16 @@ void section_destroy(struct section *psection)
 
   if ((secfile = psection->secfile)) {
     /* Detach from secfile. */
-    if (section_list_remove(secfile->sections, psection)) {
-      /* This has called section_destroy() already then. */
-      return;
-    }
+    section_list_remove(secfile->sections, psection);
     if (NULL != secfile->hash.sections) {
       section_hash_remove(secfile->hash.sections, psection->name);
     }
   }
 
   entry_list_destroy(psection->entries);
-  free(psection->name);
-  free(psection);
+  /* The section itself is released with the arena of the secfile. */
+  psection->entries = NULL;
+  psection->secfile = NULL;
 }
 
 /**************************************************************************
@@ -2667,7 +2678,9 @@ void section_clear_all(struct section *psection)
   SECFILE_RETURN_IF_FAIL(NULL, psection, NULL != psection);
 
   /* This include the removing of the hash datas. */
-  entry_list_clear(psection->entries);
+  while (0 < entry_list_size(psection->entries)) {
+    entry_destroy(entry_list_front(psection->entries));
+  }
 
   if (0 < entry_list_size(psection->entries)) {
     SECFILE_LOG(psection->secfile, psection,
@@ -2719,8 +2732,7 @@ bool section_set_name(struct section *psection, const char *name)
   }
 
   /* Really rename. */
-  free(psection->name);
-  psection->name = fc_strdup(name);
+  psection->name = secfile_name_intern(secfile, name);
 
   /* Reinsert new references into the hash tables. */
   if (NULL != secfile->hash.sections) {
@@ -2752,8 +2764,15 @@ struct entry *section_entry_by_name(const struct section *psection,
 {
   SECFILE_RETURN_VAL_IF_FAIL(NULL, psection, NULL != psection, NULL);
 
+  /* Names are interned: an unknown name matches no entry, and a known
+   * one can be compared by pointer. */
+  name = secfile_name_lookup(psection->secfile, name);
+  if (NULL == name) {
+    return NULL;
+  }
+
   entry_list_iterate(psection->entries, pentry) {
-    if (0 == strcmp(entry_name(pentry), name)) {
+    if (entry_name(pentry) == name) {
       entry_use(pentry);
       return pentry;
     }
@@ -2798,7 +2817,8 @@ struct entry *section_entry_lookup(const struct section *psection,
  */
 struct entry {
   struct section *psection;     /* Parent section. */
-  char *name;                   /* Name, not including section prefix. */
+  const char *name;             /* Name, not including section prefix,
+                                 * interned. */
   enum entry_type type;         /* The type of the entry. */
   int used;                     /* Number of times entry looked up. */
   char *comment;                /* Comment, may be NULL. */
@@ -2814,7 +2834,7 @@ struct entry {
     } integer;
     /* ENTRY_STR */
     struct {
-      char *value;              /* Malloced string. */
+      char *value;              /* String in the secfile arena. */
       bool escaped;             /* " or $. Usually TRUE */
     } string;
   };
@@ -2848,8 +2868,8 @@ static struct entry *entry_new(struct section *psection, const char *name)
     return NULL;
   }
 
-  pentry = fc_malloc(sizeof(struct entry));
-  pentry->name = fc_strdup(name);
+  pentry = secfile_alloc(secfile, sizeof(struct entry));
+  pentry->name = secfile_name_intern(secfile, name);
   pentry->type = -1;    /* Invalid case. */
   pentry->used = 0;
   pentry->comment = NULL;
@@ -2908,7 +2928,8 @@ struct entry *section_entry_str_new(struct section *psection,
 
   if (NULL != pentry) {
     pentry->type = ENTRY_STR;
-    pentry->string.value = fc_strdup(NULL != value ? value : "");
+    pentry->string.value = secfile_strdup(psection->secfile,
+                                          NULL != value ? value : "");
     pentry->string.escaped = escaped;
   }
 
@@ -2929,10 +2950,7 @@ void entry_destroy(struct entry *pentry)
 
   if ((psection = pentry->psection)) {
     /* Detach from section. */
-    if (entry_list_remove(psection->entries, pentry)) {
-      /* This has called entry_destroy() already then. */
-      return;
-    }
+    entry_list_remove(psection->entries, pentry);
     if ((secfile = psection->secfile)) {
       /* Detach from secfile. */
       secfile->num_entries--;
@@ -2940,23 +2958,9 @@ void entry_destroy(struct entry *pentry)
     }
   }
 
-  /* Specific type free. */
-  switch (pentry->type) {
-  case ENTRY_BOOL:
-  case ENTRY_INT:
-    break;
-
-  case ENTRY_STR:
-    free(pentry->string.value);
-    break;
-  }
-
-  /* Common free. */
-  free(pentry->name);
-  if (NULL != pentry->comment) {
-    free(pentry->comment);
-  }
-  free(pentry);
+  /* The entry and its strings are released with the arena of the
+   * secfile. */
+  pentry->psection = NULL;
 }
 
 /**************************************************************************
@@ -3033,8 +3037,7 @@ bool entry_set_name(struct entry *pentry, const char *name)
   secfile_hash_delete(secfile, pentry);
 
   /* Really rename the entry. */
-  free(pentry->name);
-  pentry->name = fc_strdup(name);
+  pentry->name = secfile_name_intern(secfile, name);
 
   /* Insert into hash table the new path. */
   secfile_hash_insert(secfile, pentry);
@@ -3058,11 +3061,9 @@ void entry_set_comment(struct entry *pentry, const char *comment)
     return;
   }
 
-  if (NULL != pentry->comment) {
-    free(pentry->comment);
-  }
-
-  pentry->comment = (NULL != comment ? fc_strdup(comment) : NULL);
+  pentry->comment = (NULL != comment
+                     ? secfile_strdup(pentry->psection->secfile, comment)
+                     : NULL);
 }
 
 /**************************************************************************
@@ -3173,8 +3174,16 @@ bool entry_str_set(struct entry *pentry, const char *value)
   SECFILE_RETURN_VAL_IF_FAIL(pentry->psection->secfile, pentry->psection,
                              ENTRY_STR == pentry->type, FALSE);
 
-  free(pentry->string.value);
-  pentry->string.value = fc_strdup(NULL != value ? value : "");
+  if (NULL == value) {
+    value = "";
+  }
+  if (strlen(value) <= strlen(pentry->string.value)) {
+    /* Reuse the arena space of the old value. */
+    memmove(pentry->string.value, value, strlen(value) + 1);
+  } else {
+    pentry->string.value = secfile_strdup(pentry->psection->secfile,
+                                          value);
+  }
   return TRUE;
 }
 
@@ -3208,7 +3217,8 @@ bool entry_str_set_escaped(struct entry *pentry, bool escaped)
 **************************************************************************/
 static void entry_to_file(const struct entry *pentry, fz_FILE *fs)
 {
-  static char buf[8192];
+  /* Not static: secfile_save() may run in a background thread. */
+  char buf[8192];
 
   switch (pentry->type) {
   case ENTRY_BOOL:
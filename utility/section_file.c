@@ -16,6 +16,7 @@
 #endif
 
 #include <stdarg.h>
+#include <string.h>
 
 /* utility */
 #include "mem.h"
@@ -25,6 +26,19 @@
 
 #define MAX_LEN_ERRORBUF 1024
 
+/* Sizes of the arena blocks: the first block is small, as many section
+ * files are small, then every new block doubles up to the maximum. */
+#define SECFILE_BLOCK_MIN_SIZE (4 * 1024)
+#define SECFILE_BLOCK_MAX_SIZE (256 * 1024)
+/* Alignment of non-string arena allocations. */
+#define SECFILE_ALIGN 8
+
+struct secfile_block {
+  struct secfile_block *next;
+  size_t size;                  /* Usable bytes after the header. */
+  size_t used;
+};
+
 static char error_buffer[MAX_LEN_ERRORBUF] = "\0";
 
 /* Debug function for every new entry. */
@@ -67,6 +81,110 @@ const char *section_name(const struct section *psection)
   return (NULL != psection ? psection->name : NULL);
 }
 
+/**************************************************************************
+  Hash function for the names and paths of the section files. Unlike
+  genhash_str_val_func(), it spreads well the many similar keys of the
+  tables ("u0.x", "u1.x", ...) which otherwise gather into long probing
+  sequences. This is the FNV-1a hash.
+**************************************************************************/
+genhash_val_t secfile_str_val_func(const void *vkey, size_t num_buckets)
+{
+  const unsigned char *key = vkey;
+  genhash_val_t result = 2166136261U;
+
+  for (; '\0' != *key; key++) {
+    result ^= *key;
+    result *= 16777619U;
+  }
+
+  return result % num_buckets;
+}
+
+/**************************************************************************
+  Allocate 'size' bytes aligned on 'align' from the arena of the section
+  file.
+**************************************************************************/
+static void *secfile_alloc_aligned(struct section_file *secfile,
+                                   size_t size, size_t align)
+{
+  struct secfile_block *block = secfile->arena.blocks;
+  size_t start;
+
+  if (NULL != block) {
+    start = (block->used + align - 1) & ~(align - 1);
+    if (start + size <= block->size) {
+      block->used = start + size;
+      return (char *) (block + 1) + start;
+    }
+  }
+
+  /* Need a new block. */
+  {
+    size_t block_size = (NULL != block
+                         ? MIN(2 * block->size, SECFILE_BLOCK_MAX_SIZE)
+                         : SECFILE_BLOCK_MIN_SIZE);
+
+    block_size = MAX(block_size, size);
+    block = fc_malloc(sizeof(*block) + block_size);
+    block->size = block_size;
+    block->used = size;
+    block->next = secfile->arena.blocks;
+    secfile->arena.blocks = block;
+    secfile->arena.size += sizeof(*block) + block_size;
+  }
+
+  return block + 1;
+}
+
+/**************************************************************************
+  Allocate memory for a section file structure. It is released by
+  secfile_destroy() only.
+**************************************************************************/
+void *secfile_alloc(struct section_file *secfile, size_t size)
+{
+  return secfile_alloc_aligned(secfile, size, SECFILE_ALIGN);
+}
+
+/**************************************************************************
+  Copy a string into the arena of the section file.
+**************************************************************************/
+char *secfile_strdup(struct section_file *secfile, const char *str)
+{
+  size_t size = strlen(str) + 1;
+
+  return memcpy(secfile_alloc_aligned(secfile, size, 1), str, size);
+}
+
+/**************************************************************************
+  Returns the unique copy of the section or entry name 'name' for this
+  section file, adding it if needed.
+**************************************************************************/
+const char *secfile_name_intern(struct section_file *secfile,
+                                const char *name)
+{
+  char *interned;
+
+  if (!name_hash_lookup(secfile->names, name, &interned)) {
+    interned = secfile_strdup(secfile, name);
+    name_hash_insert(secfile->names, interned, interned);
+  }
+
+  return interned;
+}
+
+/**************************************************************************
+  Returns the unique copy of the section or entry name 'name' for this
+  section file, or NULL if no section nor entry use this name.
+**************************************************************************/
+const char *secfile_name_lookup(const struct section_file *secfile,
+                                const char *name)
+{
+  char *interned;
+
+  return (name_hash_lookup(secfile->names, name, &interned)
+          ? interned : NULL);
+}
+
 /**************************************************************************
   Create a new empty section file.
 **************************************************************************/
@@ -77,7 +195,7 @@ struct section_file *secfile_new(bool allow_duplicates)
   secfile->name = NULL;
   secfile->num_entries = 0;
   secfile->num_includes = 0;
-  secfile->sections = section_list_new_full(section_destroy);
+  secfile->sections = section_list_new();
   secfile->allow_duplicates = allow_duplicates;
   secfile->allow_digital_boolean = FALSE; /* Default */
 
@@ -85,6 +203,10 @@ struct section_file *secfile_new(bool allow_duplicates)
   /* Maybe allocated later. */
   secfile->hash.entries = NULL;
 
+  secfile->arena.blocks = NULL;
+  secfile->arena.size = 0;
+  secfile->names = name_hash_new();
+
   return secfile;
 }
 
@@ -93,21 +215,27 @@ struct section_file *secfile_new(bool allow_duplicates)
 **************************************************************************/
 void secfile_destroy(struct section_file *secfile)
 {
+  struct secfile_block *block;
+
   SECFILE_RETURN_IF_FAIL(secfile, NULL, secfile != NULL);
 
   section_hash_destroy(secfile->hash.sections);
-  /* Mark it NULL to be sure to don't try to make operations when
-   * deleting the entries. */
-  secfile->hash.sections = NULL;
   if (NULL != secfile->hash.entries) {
     entry_hash_destroy(secfile->hash.entries);
-    /* Mark it NULL to be sure to don't try to make operations when
-     * deleting the entries. */
-    secfile->hash.entries = NULL;
   }
+  name_hash_destroy(secfile->names);
 
+  /* The sections and the entries themselves live in the arena. */
+  section_list_iterate(secfile->sections, psection) {
+    entry_list_destroy(psection->entries);
+  } section_list_iterate_end;
   section_list_destroy(secfile->sections);
 
+  while (NULL != (block = secfile->arena.blocks)) {
+    secfile->arena.blocks = block->next;
+    free(block);
+  }
+
   if (NULL != secfile->name) {
     free(secfile->name);
   }
@@ -115,6 +243,34 @@ void secfile_destroy(struct section_file *secfile)
   free(secfile);
 }
 
+/**************************************************************************
+  Returns an estimation of the memory used by the section file, in bytes:
+  its arena, plus the lists and hash tables indexing it.
+**************************************************************************/
+size_t secfile_memory_usage(const struct section_file *secfile)
+{
+  /* Approximate size of a list link and of a hash bucket. */
+  const size_t link_size = 3 * sizeof(void *);
+  const size_t bucket_size = 4 * sizeof(void *);
+  size_t usage;
+
+  fc_assert_ret_val(NULL != secfile, 0);
+
+  usage = sizeof(*secfile) + secfile->arena.size;
+  usage += (section_list_size(secfile->sections)
+            + secfile->num_entries) * link_size;
+  usage += section_hash_capacity(secfile->hash.sections) * sizeof(void *)
+           + section_hash_size(secfile->hash.sections) * bucket_size;
+  usage += name_hash_capacity(secfile->names) * sizeof(void *)
+           + name_hash_size(secfile->names) * bucket_size;
+  if (NULL != secfile->hash.entries) {
+    usage += entry_hash_capacity(secfile->hash.entries) * sizeof(void *)
+             + entry_hash_size(secfile->hash.entries) * bucket_size;
+  }
+
+  return usage;
+}
+
 /****************************************************************************
   Set if we could consider values 0 and 1 as boolean. By default, this is
   not allowed, but we need to keep compatibility with old Freeciv version
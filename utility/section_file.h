@@ -21,14 +21,20 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/* utility */
+#include "genhash.h"
+
 /* Section structure. */
 struct section {
   struct section_file *secfile; /* Parent structure. */
   bool include;
-  char *name;                   /* Name of the section. */
+  const char *name;             /* Name of the section, interned. */
   struct entry_list *entries;   /* The list of the children. */
 };
 
+/* A block of the memory arena of a section file. */
+struct secfile_block;
+
 /* The section file struct itself. */
 struct section_file {
   char *name;                           /* Can be NULL. */
@@ -41,6 +47,16 @@ struct section_file {
     struct section_hash *sections;
     struct entry_hash *entries;
   } hash;
+
+  /* Sections, entries and their strings are allocated from an arena
+   * which is only released by secfile_destroy(). Section and entry names
+   * are interned, so the same name is stored only once and names can be
+   * compared by pointer. */
+  struct {
+    struct secfile_block *blocks;       /* Current block first. */
+    size_t size;                        /* Sum of the block sizes. */
+  } arena;
+  struct name_hash *names;
 };
 
 void secfile_log(const struct section_file *secfile,
@@ -63,24 +79,42 @@ void secfile_log(const struct section_file *secfile,
     return value;                                                           \
   }
 
+genhash_val_t secfile_str_val_func(const void *vkey, size_t num_buckets);
+
 #define SPECHASH_TAG section
 #define SPECHASH_KEY_TYPE char *
 #define SPECHASH_DATA_TYPE struct section *
-#define SPECHASH_KEY_VAL genhash_str_val_func
+#define SPECHASH_KEY_VAL secfile_str_val_func
 #define SPECHASH_KEY_COMP genhash_str_comp_func
 #include "spechash.h"
 
+/* The keys are entry paths allocated in the arena of the secfile. */
 #define SPECHASH_TAG entry
 #define SPECHASH_KEY_TYPE char *
 #define SPECHASH_DATA_TYPE struct entry *
-#define SPECHASH_KEY_VAL genhash_str_val_func
+#define SPECHASH_KEY_VAL secfile_str_val_func
 #define SPECHASH_KEY_COMP genhash_str_comp_func
-#define SPECHASH_KEY_COPY genhash_str_copy_func
-#define SPECHASH_KEY_FREE genhash_str_free_func
 #include "spechash.h"
 
+/* Interned names, both key and data are the same arena string. */
+#define SPECHASH_TAG name
+#define SPECHASH_KEY_TYPE char *
+#define SPECHASH_DATA_TYPE char *
+#define SPECHASH_KEY_VAL secfile_str_val_func
+#define SPECHASH_KEY_COMP genhash_str_comp_func
+#include "spechash.h"
+
+void *secfile_alloc(struct section_file *secfile, size_t size);
+char *secfile_strdup(struct section_file *secfile, const char *str);
+const char *secfile_name_intern(struct section_file *secfile,
+                                const char *name);
+const char *secfile_name_lookup(const struct section_file *secfile,
+                                const char *name);
+
 bool entry_from_token(struct section *psection, const char *name,
                       const char *tok);
+bool secfile_hash_build(struct section_file *secfile,
+                        bool allow_duplicates);
 
 #ifdef __cplusplus
 }